@@ -19,6 +19,10 @@ else()
     )
 endif()
 
+if(ENABLE_TRACING)
+    add_definitions(-DWITH_TRACING)
+endif()
+
 include(TrackCapRevisionNumber)
 
 include(CMakePackageConfigHelpers)
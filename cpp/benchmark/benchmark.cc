@@ -0,0 +1,377 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include "benchmark.h"
+#include <cap/version.h>
+#include <boost/assert.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace cap
+{
+namespace benchmark
+{
+State::State(std::vector<int> const &arguments,
+             std::size_t const max_iterations,
+             boost::mpi::communicator const &communicator)
+    : _arguments(arguments), _max_iterations(max_iterations), _iterations(0),
+      _communicator(communicator), _running(false), _wall_time(0.),
+      _cpu_time(0.), _manual_time(0.), _items_processed(0)
+{
+}
+
+bool State::keep_running()
+{
+  if (_iterations == 0)
+    resume_timing();
+  if (_iterations < _max_iterations)
+  {
+    ++_iterations;
+    return true;
+  }
+  pause_timing();
+  return false;
+}
+
+void State::pause_timing()
+{
+  if (!_running)
+    return;
+  std::chrono::steady_clock::time_point const wall_end =
+      std::chrono::steady_clock::now();
+  boost::chrono::process_cpu_clock::time_point const cpu_end =
+      boost::chrono::process_cpu_clock::now();
+  _wall_time +=
+      std::chrono::duration<double>(wall_end - _wall_start).count();
+  // The ticks of the process_cpu_clock are nanoseconds.
+  boost::chrono::process_cpu_clock::duration const cpu_duration =
+      cpu_end - _cpu_start;
+  _cpu_time +=
+      1e-9 * (cpu_duration.count().user + cpu_duration.count().system);
+  _running = false;
+}
+
+void State::resume_timing()
+{
+  if (_running)
+    return;
+  _running = true;
+  _cpu_start = boost::chrono::process_cpu_clock::now();
+  _wall_start = std::chrono::steady_clock::now();
+}
+
+void State::set_iteration_time(double const seconds)
+{
+  _manual_time += seconds;
+}
+
+int State::range(unsigned int const i) const
+{
+  BOOST_ASSERT_MSG(i < _arguments.size(), "The argument does not exist.");
+  return _arguments[i];
+}
+
+std::size_t State::iterations() const { return _iterations; }
+
+void State::set_items_processed(std::size_t const n_items)
+{
+  _items_processed = n_items;
+}
+
+void State::set_counter(std::string const &name, double const value)
+{
+  _counters[name] = value;
+}
+
+boost::mpi::communicator const &State::get_communicator() const
+{
+  return _communicator;
+}
+
+double State::get_wall_time() const { return _wall_time; }
+
+double State::get_cpu_time() const { return _cpu_time; }
+
+double State::get_manual_time() const { return _manual_time; }
+
+std::size_t State::get_items_processed() const { return _items_processed; }
+
+std::map<std::string, double> const &State::get_counters() const
+{
+  return _counters;
+}
+
+Benchmark::Benchmark(std::string const &name,
+                     std::function<void(State &)> function)
+    : _name(name), _function(function), _arguments(), _use_manual_time(false)
+{
+}
+
+Benchmark *Benchmark::arg(int const argument)
+{
+  _arguments.push_back(std::vector<int>(1, argument));
+  return this;
+}
+
+Benchmark *Benchmark::args(std::vector<int> const &arguments)
+{
+  _arguments.push_back(arguments);
+  return this;
+}
+
+Benchmark *Benchmark::use_manual_time()
+{
+  _use_manual_time = true;
+  return this;
+}
+
+std::string const &Benchmark::get_name() const { return _name; }
+
+std::function<void(State &)> const &Benchmark::get_function() const
+{
+  return _function;
+}
+
+std::vector<std::vector<int>> Benchmark::get_arguments() const
+{
+  if (_arguments.empty())
+    return std::vector<std::vector<int>>(1);
+  return _arguments;
+}
+
+bool Benchmark::get_use_manual_time() const { return _use_manual_time; }
+
+namespace
+{
+std::vector<std::unique_ptr<Benchmark>> &get_registry()
+{
+  static std::vector<std::unique_ptr<Benchmark>> registry;
+  return registry;
+}
+
+struct Result
+{
+  std::string name;
+  std::size_t iterations;
+  // Times per iteration in nanoseconds.
+  double real_time;
+  double cpu_time;
+  double items_per_second;
+  std::map<std::string, double> counters;
+};
+
+std::string get_run_name(Benchmark const &benchmark,
+                         std::vector<int> const &arguments)
+{
+  std::string name = benchmark.get_name();
+  for (int const argument : arguments)
+    name += "/" + std::to_string(argument);
+  if (benchmark.get_use_manual_time())
+    name += "/manual_time";
+  return name;
+}
+
+// Increase the number of iterations until the run lasts at least min_time on
+// the slowest processor. All the processors take the same decisions.
+Result run_benchmark(Benchmark const &benchmark,
+                     std::vector<int> const &arguments, double const min_time,
+                     boost::mpi::communicator const &communicator)
+{
+  std::size_t const max_iterations = 1000000000;
+  std::size_t n_iterations = 1;
+  while (true)
+  {
+    State state(arguments, n_iterations, communicator);
+    benchmark.get_function()(state);
+    BOOST_ASSERT_MSG(state.iterations() == n_iterations,
+                     "The benchmark did not run all its iterations.");
+    double const local_time = benchmark.get_use_manual_time()
+                                  ? state.get_manual_time()
+                                  : state.get_wall_time();
+    double const time = boost::mpi::all_reduce(communicator, local_time,
+                                               boost::mpi::maximum<double>());
+    if ((time >= min_time) || (n_iterations >= max_iterations))
+    {
+      double const cpu_time = boost::mpi::all_reduce(
+          communicator, state.get_cpu_time(), boost::mpi::maximum<double>());
+      Result result;
+      result.name = get_run_name(benchmark, arguments);
+      result.iterations = n_iterations;
+      result.real_time = 1e9 * time / n_iterations;
+      result.cpu_time = 1e9 * cpu_time / n_iterations;
+      result.items_per_second =
+          (time > 0.) ? state.get_items_processed() / time : 0.;
+      result.counters = state.get_counters();
+      return result;
+    }
+    // Aim for 40% more than the minimum time but do not grow by more than a
+    // factor ten at once.
+    double const factor =
+        (time > 0.) ? std::min(10., 1.4 * min_time / time) : 10.;
+    n_iterations = std::min(
+        max_iterations,
+        std::max(n_iterations + 1,
+                 static_cast<std::size_t>(factor * n_iterations)));
+  }
+}
+
+std::string get_date()
+{
+  std::time_t const now = std::time(nullptr);
+  char buffer[64];
+  std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S%z",
+                std::localtime(&now));
+  return buffer;
+}
+
+void write_json(std::ostream &os, std::string const &executable,
+                std::vector<Result> const &results,
+                boost::mpi::communicator const &communicator)
+{
+#ifdef BOOST_DISABLE_ASSERTS
+  std::string const build_type = "release";
+#else
+  std::string const build_type = "debug";
+#endif
+  os << "{\n  \"context\": {\n";
+  os << "    \"date\": \"" << get_date() << "\",\n";
+  os << "    \"executable\": \"" << executable << "\",\n";
+  os << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+  os << "    \"mpi_processes\": " << communicator.size() << ",\n";
+  os << "    \"library_build_type\": \"" << build_type << "\",\n";
+  os << "    \"cap_version\": \"" << version() << "\",\n";
+  os << "    \"git_commit_hash\": \"" << git_commit_hash() << "\"\n";
+  os << "  },\n  \"benchmarks\": [";
+  for (unsigned int i = 0; i < results.size(); ++i)
+  {
+    Result const &result = results[i];
+    os << (i == 0 ? "\n" : ",\n");
+    os << "    {\n";
+    os << "      \"name\": \"" << result.name << "\",\n";
+    os << "      \"run_name\": \"" << result.name << "\",\n";
+    os << "      \"run_type\": \"iteration\",\n";
+    os << "      \"iterations\": " << result.iterations << ",\n";
+    os << boost::format("      \"real_time\": %.9e,\n") % result.real_time;
+    os << boost::format("      \"cpu_time\": %.9e,\n") % result.cpu_time;
+    for (auto const &counter : result.counters)
+      os << boost::format("      \"%s\": %.9e,\n") % counter.first %
+                counter.second;
+    if (result.items_per_second > 0.)
+      os << boost::format("      \"items_per_second\": %.9e,\n") %
+                result.items_per_second;
+    os << "      \"time_unit\": \"ns\"\n";
+    os << "    }";
+  }
+  os << "\n  ]\n}\n";
+}
+
+void write_console(std::ostream &os, std::vector<Result> const &results)
+{
+  os << boost::format("%-64s %15s %15s %12s\n") % "Benchmark" % "Time (ns)" %
+            "CPU (ns)" % "Iterations";
+  for (auto const &result : results)
+  {
+    os << boost::format("%-64s %15.0f %15.0f %12d") % result.name %
+              result.real_time % result.cpu_time % result.iterations;
+    if (result.items_per_second > 0.)
+      os << boost::format(" items_per_second=%.4g") % result.items_per_second;
+    for (auto const &counter : result.counters)
+      os << boost::format(" %s=%.4g") % counter.first % counter.second;
+    os << "\n";
+  }
+}
+}
+
+Benchmark *register_benchmark(std::string const &name,
+                              std::function<void(State &)> function)
+{
+  get_registry().push_back(std::make_unique<Benchmark>(name, function));
+  return get_registry().back().get();
+}
+
+int run_benchmarks(int argc, char *argv[],
+                   boost::mpi::communicator const &communicator)
+{
+  std::string filter = ".*";
+  double min_time = 0.5;
+  std::string format = "console";
+  std::string out_file;
+  bool list_only = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string const option = argv[i];
+    std::size_t const equal = option.find('=');
+    std::string const key = option.substr(0, equal);
+    std::string const value =
+        (equal == std::string::npos) ? "" : option.substr(equal + 1);
+    if (key == "--benchmark_filter")
+      filter = value;
+    else if (key == "--benchmark_min_time")
+      min_time = std::stod(value);
+    else if (key == "--benchmark_format")
+      format = value;
+    else if (key == "--benchmark_out")
+      out_file = value;
+    else if (key == "--benchmark_list_tests")
+      list_only = true;
+    else
+      throw std::runtime_error("Unknown option " + option);
+  }
+  if ((format != "console") && (format != "json"))
+    throw std::runtime_error("Unknown format " + format);
+
+  std::regex const filter_regex(filter);
+  std::vector<Result> results;
+  for (auto const &benchmark : get_registry())
+    for (auto const &arguments : benchmark->get_arguments())
+    {
+      std::string const name = get_run_name(*benchmark, arguments);
+      if (!std::regex_search(name, filter_regex))
+        continue;
+      if (list_only)
+      {
+        if (communicator.rank() == 0)
+          std::cout << name << std::endl;
+        continue;
+      }
+      results.push_back(
+          run_benchmark(*benchmark, arguments, min_time, communicator));
+    }
+  if (list_only || (communicator.rank() != 0))
+    return 0;
+
+  if (format == "json")
+    write_json(std::cout, argv[0], results, communicator);
+  else
+    write_console(std::cout, results);
+  if (!out_file.empty())
+  {
+    std::ofstream fout(out_file);
+    if (!fout)
+      throw std::runtime_error("Cannot open " + out_file);
+    write_json(fout, argv[0], results, communicator);
+  }
+
+  return 0;
+}
+}
+}
+
+int main(int argc, char *argv[])
+{
+  boost::mpi::environment env(argc, argv);
+  boost::mpi::communicator world;
+  return cap::benchmark::run_benchmarks(argc, argv, world);
+}
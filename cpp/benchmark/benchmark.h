@@ -0,0 +1,191 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_BENCHMARK_H
+#define CAP_BENCHMARK_H
+
+#include <boost/chrono/include.hpp>
+#include <boost/mpi.hpp>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cap
+{
+namespace benchmark
+{
+/**
+ * State of a run of a benchmark. The body of a benchmark repeats the timed
+ * operation while keep_running() returns true:
+ * @code
+ * void benchmark_foo(cap::benchmark::State &state)
+ * {
+ *   // setup, not timed
+ *   while (state.keep_running())
+ *     foo(state.range(0));
+ *   state.set_items_processed(state.iterations() * state.range(0));
+ * }
+ * CAP_BENCHMARK(benchmark_foo)->arg(8)->arg(64);
+ * @endcode
+ * The number of iterations is chosen by the runner so that the run lasts at
+ * least the minimum time. It is the same on all the processors, so the timed
+ * operation can be collective.
+ */
+class State
+{
+public:
+  State(std::vector<int> const &arguments, std::size_t max_iterations,
+        boost::mpi::communicator const &communicator);
+
+  /**
+   * Start the timer on the first call. Return false and stop the timer when
+   * the requested number of iterations has been run.
+   */
+  bool keep_running();
+
+  /**
+   * Stop the timer, e.g. to exclude the reset of the data between two
+   * iterations.
+   */
+  void pause_timing();
+
+  void resume_timing();
+
+  /**
+   * Add @p seconds to the time of the run. Only used by benchmarks
+   * registered with use_manual_time(), which measure the time of the
+   * operation themselves.
+   */
+  void set_iteration_time(double const seconds);
+
+  /**
+   * Return the argument @p i of the run.
+   */
+  int range(unsigned int const i = 0) const;
+
+  std::size_t iterations() const;
+
+  /**
+   * Set the number of items, e.g. cells or degrees of freedom, processed
+   * during the whole run. The throughput is reported as items_per_second.
+   */
+  void set_items_processed(std::size_t const n_items);
+
+  /**
+   * Report an extra value with the results, e.g. the number of iterations of
+   * a solver.
+   */
+  void set_counter(std::string const &name, double const value);
+
+  boost::mpi::communicator const &get_communicator() const;
+
+  double get_wall_time() const;
+
+  double get_cpu_time() const;
+
+  double get_manual_time() const;
+
+  std::size_t get_items_processed() const;
+
+  std::map<std::string, double> const &get_counters() const;
+
+private:
+  std::vector<int> _arguments;
+  std::size_t _max_iterations;
+  std::size_t _iterations;
+  boost::mpi::communicator _communicator;
+  bool _running;
+  std::chrono::steady_clock::time_point _wall_start;
+  boost::chrono::process_cpu_clock::time_point _cpu_start;
+  double _wall_time;
+  double _cpu_time;
+  double _manual_time;
+  std::size_t _items_processed;
+  std::map<std::string, double> _counters;
+};
+
+/**
+ * A registered benchmark and the list of arguments it is run with.
+ */
+class Benchmark
+{
+public:
+  Benchmark(std::string const &name, std::function<void(State &)> function);
+
+  /**
+   * Run the benchmark with the single argument @p argument.
+   */
+  Benchmark *arg(int const argument);
+
+  /**
+   * Run the benchmark with the arguments @p arguments.
+   */
+  Benchmark *args(std::vector<int> const &arguments);
+
+  /**
+   * Report the time set with State::set_iteration_time() instead of the
+   * wall-clock time.
+   */
+  Benchmark *use_manual_time();
+
+  std::string const &get_name() const;
+
+  std::function<void(State &)> const &get_function() const;
+
+  /**
+   * Return the lists of arguments. A benchmark without argument is run once
+   * with an empty list.
+   */
+  std::vector<std::vector<int>> get_arguments() const;
+
+  bool get_use_manual_time() const;
+
+private:
+  std::string _name;
+  std::function<void(State &)> _function;
+  std::vector<std::vector<int>> _arguments;
+  bool _use_manual_time;
+};
+
+/**
+ * Register the benchmark @p name. The returned pointer is used to add
+ * arguments.
+ */
+Benchmark *register_benchmark(std::string const &name,
+                              std::function<void(State &)> function);
+
+/**
+ * Run the registered benchmarks and output the results. The command line
+ * options are:
+ *   --benchmark_filter=<regex>    only run the benchmarks whose name, e.g.
+ *                                 "benchmark_foo/64", matches the regex.
+ *   --benchmark_min_time=<s>      minimum time of each run (default 0.5).
+ *   --benchmark_format=<format>   "console" (default) or "json".
+ *   --benchmark_out=<file>        also write the results in JSON format.
+ *   --benchmark_list_tests        only print the names of the benchmarks.
+ * The JSON output follows the format of Google Benchmark. The times are
+ * the maximum over the processors. Only the rank 0 process outputs the
+ * results.
+ */
+int run_benchmarks(int argc, char *argv[],
+                   boost::mpi::communicator const &communicator);
+}
+}
+
+#define CAP_BENCHMARK_CONCATENATE_IMPL(a, b) a##b
+#define CAP_BENCHMARK_CONCATENATE(a, b) CAP_BENCHMARK_CONCATENATE_IMPL(a, b)
+/**
+ * Register the function @p function under its own name.
+ */
+#define CAP_BENCHMARK(function)                                                \
+  static ::cap::benchmark::Benchmark *CAP_BENCHMARK_CONCATENATE(               \
+      cap_benchmark_, __LINE__) =                                              \
+      ::cap::benchmark::register_benchmark(#function, function)
+
+#endif
@@ -0,0 +1,105 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include "benchmark.h"
+#include <cap/energy_storage_device.h>
+#include <boost/property_tree/info_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Return 1 if the device is below 2.1 volts and should be charged, -1
+// otherwise. Charging and discharging in turn keeps the state bounded however
+// many iterations are run. Because of the losses in the resistors, simply
+// alternating the sign of the power would drain the device.
+double get_sign(cap::EnergyStorageDevice const &device)
+{
+  double voltage;
+  device.get_voltage(voltage);
+  return voltage < 2.1 ? 1. : -1.;
+}
+
+// The linear power and linear load modes are not implemented by the RC
+// circuits.
+std::vector<std::pair<std::string,
+                      std::function<void(cap::EnergyStorageDevice &,
+                                         std::size_t const)>>> const modes = {
+    {"constant_current",
+     [](cap::EnergyStorageDevice &device, std::size_t const)
+     {
+       device.evolve_one_time_step_constant_current(0.1, 2. * get_sign(device));
+     }},
+    {"constant_voltage",
+     [](cap::EnergyStorageDevice &device, std::size_t const i)
+     {
+       device.evolve_one_time_step_constant_voltage(0.1, i % 2 ? 1.1 : 2.1);
+     }},
+    {"constant_power",
+     [](cap::EnergyStorageDevice &device, std::size_t const)
+     {
+       device.evolve_one_time_step_constant_power(0.1, get_sign(device));
+     }},
+    {"constant_load",
+     [](cap::EnergyStorageDevice &device, std::size_t const i)
+     {
+       // A constant load only discharges the device.
+       if (i % 2)
+         device.evolve_one_time_step_constant_load(0.1, 1.);
+       else
+         device.evolve_one_time_step_constant_voltage(0.1, 2.1);
+     }},
+    {"linear_current",
+     [](cap::EnergyStorageDevice &device, std::size_t const)
+     {
+       device.evolve_one_time_step_linear_current(0.1, 2. * get_sign(device));
+     }},
+    {"linear_voltage",
+     [](cap::EnergyStorageDevice &device, std::size_t const i)
+     {
+       device.evolve_one_time_step_linear_voltage(0.1, i % 2 ? 1.1 : 2.1);
+     }}};
+
+void benchmark_evolve(
+    cap::benchmark::State &state, std::string const &filename,
+    std::function<void(cap::EnergyStorageDevice &, std::size_t const)> const &
+        evolve)
+{
+  boost::property_tree::ptree ptree;
+  boost::property_tree::info_parser::read_info(filename, ptree);
+  ptree.put("initial_voltage", 2.1);
+  std::shared_ptr<cap::EnergyStorageDevice> device =
+      cap::EnergyStorageDevice::build(ptree, state.get_communicator());
+
+  std::size_t i = 0;
+  while (state.keep_running())
+    evolve(*device, i++);
+  state.set_items_processed(state.iterations());
+}
+
+bool register_benchmarks()
+{
+  for (std::string const type : {"series_rc", "parallel_rc"})
+    for (auto const &mode : modes)
+    {
+      std::string const filename = type + ".info";
+      auto const &evolve = mode.second;
+      cap::benchmark::register_benchmark(
+          "benchmark_evolve_" + type + "_" + mode.first,
+          [filename, evolve](cap::benchmark::State &state)
+          {
+            benchmark_evolve(state, filename, evolve);
+          });
+    }
+  return true;
+}
+
+bool const registered = register_benchmarks();
+}
@@ -0,0 +1,214 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include "benchmark.h"
+#include <cap/electrochemical_physics.h>
+#include <cap/geometry.h>
+#include <cap/mp_values.h>
+#include <cap/post_processor.h>
+#include <cap/supercapacitor.h>
+#include <boost/property_tree/info_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/fe_system.h>
+#include <deal.II/lac/solver_cg.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/trilinos_precondition.h>
+#include <deal.II/lac/trilinos_sparse_matrix.h>
+#include <deal.II/lac/trilinos_vector.h>
+#include <memory>
+#include <numeric>
+#include <string>
+
+namespace
+{
+// Return the database of a two-dimensional supercapacitor whose mesh is
+// generated with @p n_refinements global refinements.
+boost::property_tree::ptree get_database(int const n_refinements)
+{
+  boost::property_tree::ptree database;
+  boost::property_tree::info_parser::read_info("super_capacitor.info",
+                                               database);
+  boost::property_tree::ptree geometry_database;
+  boost::property_tree::info_parser::read_info("generate_mesh.info",
+                                               geometry_database);
+  geometry_database.put("n_refinements", n_refinements);
+  database.put_child("geometry", geometry_database);
+  return database;
+}
+
+// Build the electrochemical system of a constant current time step. The
+// assembly is done by the constructor of the physics.
+struct Fixture
+{
+  Fixture(int const n_refinements,
+          boost::mpi::communicator const &communicator)
+      : database(get_database(n_refinements)),
+        geometry(std::make_shared<cap::Geometry<2>>(
+            std::make_shared<boost::property_tree::ptree>(
+                database.get_child("geometry")),
+            communicator)),
+        fe(dealii::FE_Q<2>(1), 2),
+        dof_handler(
+            std::make_shared<dealii::DoFHandler<2>>(
+                *geometry->get_triangulation())),
+        parameters(
+            std::make_shared<cap::ElectrochemicalPhysicsParameters<2>>(
+                database))
+  {
+    dof_handler->distribute_dofs(fe);
+    cap::MPValuesParameters<2> mp_values_parameters(
+        std::make_shared<boost::property_tree::ptree>(
+            database.get_child("material_properties")));
+    mp_values_parameters.geometry = geometry;
+    mp_values = std::make_shared<cap::MPValues<2>>(mp_values_parameters);
+    parameters->geometry = geometry;
+    parameters->dof_handler = dof_handler;
+    parameters->mp_values = mp_values;
+    parameters->supercapacitor_state = cap::ConstantCurrent;
+    parameters->constant_current_density = 10.;
+    parameters->time_step = 0.1;
+  }
+
+  std::size_t n_locally_owned_cells() const
+  {
+    return geometry->get_triangulation()->n_locally_owned_active_cells();
+  }
+
+  boost::property_tree::ptree database;
+  std::shared_ptr<cap::Geometry<2>> geometry;
+  dealii::FESystem<2> fe;
+  std::shared_ptr<dealii::DoFHandler<2>> dof_handler;
+  std::shared_ptr<cap::MPValues<2> const> mp_values;
+  std::shared_ptr<cap::ElectrochemicalPhysicsParameters<2>> parameters;
+};
+
+void benchmark_mp_values_get_values(cap::benchmark::State &state)
+{
+  Fixture fixture(state.range(0), state.get_communicator());
+  std::vector<std::string> const keys = {
+      "solid_electrical_conductivity", "liquid_electrical_conductivity",
+      "specific_capacitance", "faradaic_reaction_coefficient"};
+  // One value per quadrature point of a bilinear element.
+  std::vector<double> values(4);
+  std::size_t n_calls = 0;
+  while (state.keep_running())
+    for (auto cell : fixture.dof_handler->active_cell_iterators())
+      if (cell->is_locally_owned())
+        for (auto const &key : keys)
+        {
+          fixture.mp_values->get_values(key, cell, values);
+          ++n_calls;
+        }
+  state.set_items_processed(n_calls);
+}
+CAP_BENCHMARK(benchmark_mp_values_get_values)->arg(2)->arg(4);
+
+// Only the loop over the cells is timed. The setup of the constraints and of
+// the sparsity pattern is excluded.
+void benchmark_assemble_system(cap::benchmark::State &state)
+{
+  Fixture fixture(state.range(0), state.get_communicator());
+  while (state.keep_running())
+  {
+    cap::ElectrochemicalPhysics<2> physics(fixture.parameters,
+                                           state.get_communicator());
+    std::vector<double> const &assembly_time = physics.get_assembly_time();
+    state.set_iteration_time(
+        std::accumulate(assembly_time.begin(), assembly_time.end(), 0.));
+  }
+  state.set_items_processed(state.iterations() *
+                            fixture.n_locally_owned_cells());
+}
+CAP_BENCHMARK(benchmark_assemble_system)->arg(2)->arg(4)->use_manual_time();
+
+void benchmark_sparse_matrix_vmult(cap::benchmark::State &state)
+{
+  Fixture fixture(state.range(0), state.get_communicator());
+  cap::ElectrochemicalPhysics<2> physics(fixture.parameters,
+                                         state.get_communicator());
+  dealii::Trilinos::SparseMatrix const &system_matrix =
+      physics.get_system_matrix();
+  dealii::Trilinos::MPI::Vector src(physics.get_system_rhs());
+  dealii::Trilinos::MPI::Vector dst(src);
+  src = 1.;
+  while (state.keep_running())
+    system_matrix.vmult(dst, src);
+  state.set_items_processed(state.iterations() *
+                            fixture.dof_handler->n_locally_owned_dofs());
+  state.set_counter("n_nonzero_elements",
+                    system_matrix.n_nonzero_elements());
+}
+CAP_BENCHMARK(benchmark_sparse_matrix_vmult)->arg(2)->arg(4);
+
+// The AMG preconditioner is built once. Each iteration solves the system from
+// a zero initial guess.
+void benchmark_cg_solve(cap::benchmark::State &state)
+{
+  Fixture fixture(state.range(0), state.get_communicator());
+  cap::ElectrochemicalPhysics<2> physics(fixture.parameters,
+                                         state.get_communicator());
+  dealii::Trilinos::SparseMatrix const &system_matrix =
+      physics.get_system_matrix();
+  dealii::Trilinos::MPI::Vector const &system_rhs = physics.get_system_rhs();
+  dealii::Trilinos::PreconditionAMG preconditioner;
+  preconditioner.initialize(system_matrix);
+  dealii::Trilinos::MPI::Vector solution(system_rhs);
+  unsigned int n_iterations = 0;
+  while (state.keep_running())
+  {
+    solution = 0.;
+    dealii::SolverControl solver_control(
+        1000, 1.0e-10 * system_rhs.l2_norm());
+    dealii::SolverCG<dealii::Trilinos::MPI::Vector> solver(solver_control);
+    solver.solve(system_matrix, solution, system_rhs, preconditioner);
+    n_iterations = solver_control.last_step();
+  }
+  state.set_items_processed(state.iterations() *
+                            fixture.dof_handler->n_locally_owned_dofs());
+  state.set_counter("n_iterations", n_iterations);
+}
+CAP_BENCHMARK(benchmark_cg_solve)->arg(2)->arg(4);
+
+void benchmark_postprocessor_reset(cap::benchmark::State &state)
+{
+  boost::property_tree::ptree const database = get_database(state.range(0));
+  cap::SuperCapacitor<2> device(database, state.get_communicator());
+  device.evolve_one_time_step_constant_current(0.1, 10.);
+  std::shared_ptr<cap::Postprocessor<2>> post_processor =
+      device.get_post_processor();
+  std::shared_ptr<cap::PostprocessorParameters<2>> post_processor_parameters =
+      device.get_post_processor_parameters();
+  std::size_t const n_cells = device.get_geometry()
+                                  ->get_triangulation()
+                                  ->n_locally_owned_active_cells();
+  while (state.keep_running())
+    post_processor->reset(post_processor_parameters);
+  state.set_items_processed(state.iterations() * n_cells);
+}
+CAP_BENCHMARK(benchmark_postprocessor_reset)->arg(2)->arg(4);
+
+void benchmark_geometry(cap::benchmark::State &state)
+{
+  boost::property_tree::ptree geometry_database;
+  boost::property_tree::info_parser::read_info("generate_mesh.info",
+                                               geometry_database);
+  geometry_database.put("n_repetitions", state.range(0));
+  std::size_t n_cells = 0;
+  while (state.keep_running())
+  {
+    cap::Geometry<2> geometry(
+        std::make_shared<boost::property_tree::ptree>(geometry_database),
+        state.get_communicator());
+    n_cells = geometry.get_triangulation()->n_global_active_cells();
+  }
+  state.set_items_processed(state.iterations() * n_cells);
+  state.set_counter("n_cells", n_cells);
+}
+CAP_BENCHMARK(benchmark_geometry)->arg(0)->arg(1)->arg(3)->arg(7);
+}
@@ -0,0 +1,38 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include "benchmark.h"
+#include <cap/utils.h>
+#include <boost/property_tree/ptree.hpp>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Parse a comma-separated list of state.range(0) values stored in a ptree, the
+// way the divisions of the geometry and the time steps of the tests are read.
+void benchmark_ptree_to_vector(cap::benchmark::State &state)
+{
+  int const n_values = state.range(0);
+  std::vector<double> values(n_values);
+  for (int i = 0; i < n_values; ++i)
+    values[i] = 1.0e-4 * (i + 1);
+  boost::property_tree::ptree ptree;
+  ptree.put("values", cap::to_string(values));
+
+  double sum = 0.;
+  while (state.keep_running())
+  {
+    std::vector<double> const parsed =
+        cap::to_vector<double>(ptree.get<std::string>("values"));
+    sum += parsed.back();
+  }
+  state.set_items_processed(state.iterations() * n_values);
+  state.set_counter("checksum", sum);
+}
+CAP_BENCHMARK(benchmark_ptree_to_vector)->arg(8)->arg(64)->arg(512);
+}
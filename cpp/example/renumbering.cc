@@ -0,0 +1,150 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+// Compare the renumbering strategies of the degrees of freedom. For each
+// strategy, the system of a constant current time step is assembled and we
+// report the effective memory bandwidth of the matrix-vector product and the
+// time spent in the conjugate gradient.
+
+#include <cap/dof_renumbering.h>
+#include <cap/electrochemical_physics.h>
+#include <cap/geometry.h>
+#include <cap/mp_values.h>
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/fe_system.h>
+#include <deal.II/lac/solver_cg.h>
+#include <deal.II/lac/trilinos_precondition.h>
+#include <boost/format.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/info_parser.hpp>
+#include <boost/mpi/environment.hpp>
+#include <boost/mpi/timer.hpp>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+template <int dim>
+void benchmark(boost::property_tree::ptree const &device_database,
+               std::string const &renumbering, bool const interleave_components,
+               boost::mpi::communicator const &comm)
+{
+  boost::property_tree::ptree database = device_database;
+  database.put("solver.renumbering", renumbering);
+  database.put("solver.interleave_components", interleave_components);
+
+  std::shared_ptr<cap::Geometry<dim>> geometry =
+      std::make_shared<cap::Geometry<dim>>(
+          std::make_shared<boost::property_tree::ptree>(
+              database.get_child("geometry")),
+          comm);
+  dealii::FESystem<dim> fe(
+      dealii::FE_Q<dim>(database.get("solver.polynomial_degree", 1u)), 2);
+  std::shared_ptr<dealii::DoFHandler<dim>> dof_handler =
+      std::make_shared<dealii::DoFHandler<dim>>(
+          *geometry->get_triangulation());
+  dof_handler->distribute_dofs(fe);
+  cap::renumber_dofs(*dof_handler, database.get_child("solver"));
+
+  cap::MPValuesParameters<dim> mp_values_params(
+      std::make_shared<boost::property_tree::ptree>(
+          database.get_child("material_properties")));
+  mp_values_params.geometry = geometry;
+  std::shared_ptr<cap::ElectrochemicalPhysicsParameters<dim>> params =
+      std::make_shared<cap::ElectrochemicalPhysicsParameters<dim>>(database);
+  params->geometry = geometry;
+  params->dof_handler = dof_handler;
+  params->mp_values = std::make_shared<cap::MPValues<dim>>(mp_values_params);
+  params->supercapacitor_state = cap::ConstantCurrent;
+  params->constant_current_density = 10.;
+  params->time_step = 0.1;
+  cap::ElectrochemicalPhysics<dim> physics(params, comm);
+  dealii::Trilinos::SparseMatrix const &system_matrix =
+      physics.get_system_matrix();
+  dealii::Trilinos::MPI::Vector const &system_rhs = physics.get_system_rhs();
+
+  // Matrix-vector product. Each product reads the values and the column
+  // indices of the matrix, the row pointers, the source vector and writes the
+  // destination vector.
+  unsigned int const n_vmults = 100;
+  dealii::Trilinos::MPI::Vector src(system_rhs);
+  dealii::Trilinos::MPI::Vector dst(system_rhs);
+  src = 1.;
+  comm.barrier();
+  boost::mpi::timer vmult_timer;
+  for (unsigned int i = 0; i < n_vmults; ++i)
+    system_matrix.vmult(dst, src);
+  comm.barrier();
+  double const vmult_time = vmult_timer.elapsed() / n_vmults;
+  double const n_bytes =
+      system_matrix.n_nonzero_elements() * (sizeof(double) + sizeof(int)) +
+      system_matrix.m() * (sizeof(int) + 2 * sizeof(double));
+
+  // Conjugate gradient preconditioned by AMG.
+  comm.barrier();
+  boost::mpi::timer setup_timer;
+  dealii::Trilinos::PreconditionAMG preconditioner;
+  preconditioner.initialize(system_matrix);
+  double const setup_time = setup_timer.elapsed();
+  dealii::Trilinos::MPI::Vector solution(system_rhs);
+  solution = 0.;
+  dealii::SolverControl solver_control(
+      database.get<unsigned int>("solver.max_iter", 1000),
+      database.get<double>("solver.rel_tolerance", 1e-12) *
+          system_rhs.l2_norm());
+  dealii::SolverCG<dealii::Trilinos::MPI::Vector> solver(solver_control);
+  comm.barrier();
+  boost::mpi::timer solve_timer;
+  solver.solve(system_matrix, solution, system_rhs, preconditioner);
+  double const solve_time = solve_timer.elapsed();
+
+  if (comm.rank() == 0)
+    std::cout << boost::format(
+                     "%-14s %-11s %12.3e %12.3f %12.3e %12.3e %6d\n") %
+                     renumbering %
+                     (interleave_components ? "interleaved" : "component") %
+                     vmult_time % (n_bytes / vmult_time * 1e-9) % setup_time %
+                     solve_time % solver_control.last_step();
+}
+
+template <int dim>
+void run(boost::property_tree::ptree const &device_database,
+         boost::mpi::communicator const &comm)
+{
+  if (comm.rank() == 0)
+    std::cout << boost::format("%-14s %-11s %12s %12s %12s %12s %6s\n") %
+                     "renumbering" % "components" % "SpMV [s]" %
+                     "SpMV [GB/s]" % "AMG [s]" % "CG [s]" % "iter";
+  for (std::string const renumbering : {"none", "cuthill_mckee", "downstream"})
+    for (bool const interleave_components : {false, true})
+      benchmark<dim>(device_database, renumbering, interleave_components, comm);
+}
+
+int main(int argc, char *argv[])
+{
+  boost::mpi::environment env(argc, argv);
+  boost::mpi::communicator comm;
+  if (comm.rank() == 0)
+    std::cout << "Number of processors: " << comm.size() << std::endl;
+
+  // Parse input file
+  boost::property_tree::ptree device_database;
+  boost::property_tree::info_parser::read_info(
+      argc > 1 ? argv[1] : "super_capacitor.info", device_database);
+  device_database.put("verbosity", 0);
+
+  int const dim = device_database.get<int>("dim");
+  if (dim == 2)
+    run<2>(device_database, comm);
+  else if (dim == 3)
+    run<3>(device_database, comm);
+  else
+    throw std::runtime_error("dim should be 2 or 3");
+
+  return 0;
+}
@@ -1,46 +1,326 @@
-#include <cap/energy_storage_device.h>
-#include <cap/mp_values.h>
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+// Strong and weak scaling study of the SuperCapacitor. The study is described
+// by an input file (scaling.info by default) that gives the base device
+// database, the scaling axis, and the numbers of processors:
+//
+//   device            super_capacitor.info ; base database of the device
+//   type              strong               ; strong or weak
+//   axis              n_refinements        ; n_refinements, n_repetitions,
+//                                          ; or divisions
+//   values            3,4                  ; values of the axis
+//   n_processes       1,2,4                ; default: powers of two up to
+//                                          ; the size of the communicator
+//   n_time_steps      10
+//   time_step         0.1                  ; [second]
+//   voltage           2.1                  ; [volt]
+//   hardware_counters false                ; read the hardware counters
+//   output            scaling              ; scaling.csv and scaling.json
+//
+// The divisions axis multiplies the number of divisions of every material of
+// the mesh generator by the value. For a weak scaling study, the axis is
+// ignored and the values are the number of units of the stack per processor:
+// n_repetitions is set so that the stack has value * n_processes units.
+//
+// Each run uses the first n_processes processors of MPI_COMM_WORLD. The time of
+// the setup, physics setup (dofs, sparsity pattern, constraints), assembly,
+// preconditioner, solve, and postprocess phases is recorded by the
+// TimerRegistry and reduced over the processors of the run.
+// When hardware_counters is true, the cycles, the instructions, and the misses
+// of the last-level cache, summed over the processors, are also reported. They
+// are nan if the counters are not available, e.g. in a container. The parallel
+// efficiency is computed from the maximum time over the processors, relative
+// to the run with the fewest processors of the same value:
+// t_ref * p_ref / (t * p) for strong scaling and t_ref / t for weak scaling.
+
 #include <cap/default_inspector.h>
-#include <cap/supercapacitor.h>
-#include <boost/property_tree/ptree.hpp>
+#include <cap/energy_storage_device.h>
+#include <cap/timer_registry.h>
+#include <cap/utils.h>
+#include <boost/format.hpp>
 #include <boost/property_tree/info_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/mpi/collectives.hpp>
 #include <boost/mpi/environment.hpp>
-#include <boost/mpi/timer.hpp>
+#include <cmath>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
-int main(int argc, char *argv[])
+// Phases of a run and the corresponding sections of the TimerRegistry.
+std::vector<std::pair<std::string, std::string>> const phases = {
+    {"setup", "run/setup"},
+    {"assembly", "run/time_step/physics"},
+    {"preconditioner", "run/time_step/preconditioner"},
+    {"solve", "run/time_step/solve"},
+    {"postprocess", "run/time_step/postprocess"},
+    {"total", "run"}};
+
+struct Run
 {
-  boost::mpi::environment env(argc, argv);
-  boost::mpi::communicator comm;
-  boost::mpi::timer timer;
-  if (comm.rank() == 0)
-    std::cout << "Number of processors: " << comm.size() << std::endl;
+  int value;
+  int n_processes;
+  double n_dofs;
+  std::vector<cap::TimerStatistics> statistics;
+  std::vector<double> efficiency;
+};
 
-  // Parse input file
-  boost::property_tree::ptree device_database;
-  boost::property_tree::info_parser::read_info("super_capacitor.info",
-                                               device_database);
+// Return the database of the device for the given value of the axis.
+boost::property_tree::ptree
+get_device_database(boost::property_tree::ptree const &base_database,
+                    std::string const &type, std::string const &axis,
+                    int const value, int const n_processes)
+{
+  boost::property_tree::ptree database = base_database;
+  database.put("verbosity", 0);
+  if (database.get<std::string>("geometry.type") != "mesh_generator")
+    throw std::runtime_error("The scaling study requires a geometry of type "
+                             "mesh_generator");
+  if (type == "weak")
+  {
+    database.put("geometry.n_repetitions", value * n_processes - 1);
+  }
+  else if ((axis == "n_refinements") || (axis == "n_repetitions"))
+  {
+    database.put("geometry." + axis, value);
+  }
+  else if (axis == "divisions")
+  {
+    for (std::string const material :
+         {"collector", "anode", "separator", "cathode"})
+    {
+      std::string const key = "geometry." + material + ".divisions";
+      std::vector<int> divisions =
+          cap::to_vector<int>(database.get<std::string>(key));
+      for (auto &division : divisions)
+        division *= value;
+      database.put(key, cap::to_string(divisions));
+    }
+  }
+  else
+    throw std::runtime_error("Invalid scaling axis " + axis);
 
-  std::shared_ptr<cap::EnergyStorageDevice> device =
-      cap::EnergyStorageDevice::build(device_database, comm);
+  return database;
+}
 
-  unsigned int const n_time_steps = 10;
-  double const time_step = 0.1;
-  double const charge_voltage = 2.1;
-  for (unsigned int i = 0; i < n_time_steps; ++i)
-    device->evolve_one_time_step_constant_voltage(time_step, charge_voltage);
+// Evolve the device and return the statistics of the phases on the processors
+// of @p comm. The number of degrees of freedom is only set on the rank 0
+// process.
+Run run(boost::property_tree::ptree const &database,
+        boost::property_tree::ptree const &scaling_database,
+        boost::mpi::communicator const &comm)
+{
+  unsigned int const n_time_steps =
+      scaling_database.get<unsigned int>("n_time_steps", 10);
+  double const time_step = scaling_database.get<double>("time_step", 0.1);
+  double const voltage = scaling_database.get<double>("voltage", 2.1);
 
-  if (comm.rank() == 0)
+  Run result;
+  cap::TimerRegistry::instance().reset();
   {
+    cap::ScopedTimer run_timer("run");
+    std::shared_ptr<cap::EnergyStorageDevice> device =
+        cap::EnergyStorageDevice::build(database, comm);
+    for (unsigned int i = 0; i < n_time_steps; ++i)
+      device->evolve_one_time_step_constant_voltage(time_step, voltage);
+    run_timer.stop();
+
     cap::DefaultInspector inspector;
     inspector.inspect(device.get());
-    auto data = inspector.get_data();
-    std::cout << "n dofs: " << data["n_dofs"] << std::endl;
-    std::cout << "Elapsed time: " << timer.elapsed() << std::endl;
+    result.n_dofs = inspector.get_data()["n_dofs"];
   }
 
-  cap::SuperCapacitorInspector<2> supercap_inspector;
-  supercap_inspector.inspect(device.get());
+  std::map<std::string, cap::TimerStatistics> const statistics =
+      cap::TimerRegistry::instance().gather(comm);
+  for (auto const &phase : phases)
+  {
+    auto const section = statistics.find(phase.second);
+    result.statistics.push_back(section != statistics.end()
+                                    ? section->second
+                                    : cap::TimerStatistics{0, 0., 0., 0., 0.,
+                                                           0., 0., {}});
+  }
+
+  return result;
+}
+
+void compute_efficiency(std::string const &type, std::vector<Run> &runs)
+{
+  for (auto &run : runs)
+  {
+    // The reference is the run with the fewest processors of the same value.
+    Run const *reference = &run;
+    for (auto const &other : runs)
+      if ((other.value == run.value) &&
+          (other.n_processes < reference->n_processes))
+        reference = &other;
+    for (unsigned int i = 0; i < phases.size(); ++i)
+    {
+      double const t_ref = reference->statistics[i].max_wall_time;
+      double const t = run.statistics[i].max_wall_time;
+      double efficiency = 0.;
+      if (t > 0.)
+        efficiency =
+            (type == "strong")
+                ? t_ref * reference->n_processes / (t * run.n_processes)
+                : t_ref / t;
+      run.efficiency.push_back(efficiency);
+    }
+  }
+}
+
+void write_csv(std::ostream &os, std::string const &type,
+               std::string const &axis, std::vector<Run> const &runs)
+{
+  os << "type,axis,value,n_processes,n_dofs,phase,n_calls,min_wall_time,"
+        "mean_wall_time,max_wall_time,efficiency,cycles,instructions,"
+        "llc_misses\n";
+  for (auto const &run : runs)
+    for (unsigned int i = 0; i < phases.size(); ++i)
+    {
+      cap::TimerStatistics const &statistics = run.statistics[i];
+      os << boost::format("%s,%s,%d,%d,%.0f,%s,%d,%.6e,%.6e,%.6e,%.4f,%.6e,"
+                          "%.6e,%.6e\n") %
+                type % axis % run.value % run.n_processes % run.n_dofs %
+                phases[i].first % statistics.n_calls %
+                statistics.min_wall_time % statistics.mean_wall_time %
+                statistics.max_wall_time % run.efficiency[i] %
+                statistics.counters[cap::HardwareCounters::cycles] %
+                statistics.counters[cap::HardwareCounters::instructions] %
+                statistics.counters[cap::HardwareCounters::llc_misses];
+    }
+}
+
+void write_json(std::ostream &os, std::string const &type,
+                std::string const &axis, std::vector<Run> const &runs)
+{
+  os << "{\n  \"type\": \"" << type << "\",\n  \"axis\": \"" << axis
+     << "\",\n  \"runs\": [";
+  for (unsigned int r = 0; r < runs.size(); ++r)
+  {
+    Run const &run = runs[r];
+    os << (r == 0 ? "\n" : ",\n");
+    os << boost::format("    {\n      \"value\": %d,\n      \"n_processes\": "
+                        "%d,\n      \"n_dofs\": %.0f,\n      \"phases\": {") %
+              run.value % run.n_processes % run.n_dofs;
+    for (unsigned int i = 0; i < phases.size(); ++i)
+    {
+      cap::TimerStatistics const &statistics = run.statistics[i];
+      os << (i == 0 ? "\n" : ",\n");
+      os << boost::format("        \"%s\": {\"n_calls\": %d, "
+                          "\"min_wall_time\": %.6e, \"mean_wall_time\": "
+                          "%.6e, \"max_wall_time\": %.6e, \"efficiency\": "
+                          "%.4f") %
+                phases[i].first % statistics.n_calls %
+                statistics.min_wall_time % statistics.mean_wall_time %
+                statistics.max_wall_time % run.efficiency[i];
+      // JSON does not have NaN.
+      for (unsigned int c = 0; c < cap::HardwareCounters::n_counters; ++c)
+      {
+        double const value = statistics.counters[c];
+        os << ", \""
+           << cap::HardwareCounters::get_name(
+                  static_cast<cap::HardwareCounters::Counter>(c))
+           << "\": "
+           << (std::isfinite(value) ? (boost::format("%.6e") % value).str()
+                                    : "null");
+      }
+      os << "}";
+    }
+    os << "\n      }\n    }";
+  }
+  os << "\n  ]\n}\n";
+}
+
+int main(int argc, char *argv[])
+{
+  boost::mpi::environment env(argc, argv);
+  boost::mpi::communicator world;
+
+  // Parse input files
+  boost::property_tree::ptree scaling_database;
+  boost::property_tree::info_parser::read_info(
+      argc > 1 ? argv[1] : "scaling.info", scaling_database);
+  boost::property_tree::ptree base_database;
+  boost::property_tree::info_parser::read_info(
+      scaling_database.get<std::string>("device", "super_capacitor.info"),
+      base_database);
+
+  std::string const type = scaling_database.get<std::string>("type", "strong");
+  if ((type != "strong") && (type != "weak"))
+    throw std::runtime_error("Invalid scaling type " + type);
+  std::string const axis =
+      (type == "weak")
+          ? "n_repetitions"
+          : scaling_database.get<std::string>("axis", "n_refinements");
+  std::vector<int> const values = cap::to_vector<int>(
+      scaling_database.get<std::string>("values", type == "weak" ? "1" : ""));
+  std::vector<int> n_processes;
+  if (scaling_database.count("n_processes") > 0)
+    n_processes =
+        cap::to_vector<int>(scaling_database.get<std::string>("n_processes"));
+  else
+    for (int p = 1; p <= world.size(); p *= 2)
+      n_processes.push_back(p);
+  if (values.empty())
+    throw std::runtime_error("The values of the axis are missing");
+  for (int const p : n_processes)
+    if ((p < 1) || (p > world.size()))
+      throw std::runtime_error("Cannot run on " + std::to_string(p) +
+                               " processors");
+
+  if (scaling_database.get("hardware_counters", false))
+  {
+    bool const available =
+        cap::TimerRegistry::instance().enable_hardware_counters();
+    if (!boost::mpi::all_reduce(world, available, std::logical_and<bool>()) &&
+        (world.rank() == 0))
+      std::cout << "The hardware counters are not available on every "
+                   "processor\n";
+  }
+
+  std::vector<Run> runs;
+  for (int const value : values)
+    for (int const p : n_processes)
+    {
+      // The processors that do not take part in the run wait for the others.
+      boost::mpi::communicator comm = world.split(world.rank() < p ? 0 : 1);
+      if (world.rank() < p)
+      {
+        Run result =
+            run(get_device_database(base_database, type, axis, value, p),
+                scaling_database, comm);
+        result.value = value;
+        result.n_processes = p;
+        runs.push_back(result);
+        if (world.rank() == 0)
+          std::cout << boost::format("value %d, %d processors, %.0f dofs: "
+                                     "%.3f s\n") %
+                           value % p % result.n_dofs %
+                           result.statistics.back().max_wall_time;
+      }
+      world.barrier();
+    }
+
+  if (world.rank() == 0)
+  {
+    compute_efficiency(type, runs);
+    std::string const output =
+        scaling_database.get<std::string>("output", "scaling");
+    std::ofstream csv_file(output + ".csv");
+    write_csv(csv_file, type, axis, runs);
+    std::ofstream json_file(output + ".json");
+    write_json(json_file, type, axis, runs);
+  }
 
   return 0;
 }
@@ -0,0 +1,16 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <cap/dof_renumbering.templates.h>
+
+namespace cap
+{
+template void renumber_dofs(dealii::DoFHandler<2> &dof_handler,
+                            boost::property_tree::ptree const &database);
+template void renumber_dofs(dealii::DoFHandler<3> &dof_handler,
+                            boost::property_tree::ptree const &database);
+}
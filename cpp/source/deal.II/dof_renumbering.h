@@ -0,0 +1,35 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_DEAL_II_DOF_RENUMBERING_H
+#define CAP_DEAL_II_DOF_RENUMBERING_H
+
+#include <boost/property_tree/ptree.hpp>
+#include <deal.II/dofs/dof_handler.h>
+
+namespace cap
+{
+/**
+ * Renumber the degrees of freedom of @p dof_handler according to @p database.
+ * The key "renumbering" selects the ordering of the degrees of freedom of a
+ * processor:
+ *   - "none" keeps the order given by the traversal of the cells (default),
+ *   - "cuthill_mckee" uses the Cuthill-McKee algorithm to reduce the
+ *   bandwidth of the matrix,
+ *   - "downstream" sorts the degrees of freedom along the stacking direction
+ *   of the layers of the cell.
+ * If the key "interleave_components" is false (default), the degrees of
+ * freedom are then grouped component-wise, preserving the previous order
+ * inside each component. Otherwise, the potentials of a support point stay
+ * next to each other, i.e., the matrix is made of small dense blocks.
+ */
+template <int dim>
+void renumber_dofs(dealii::DoFHandler<dim> &dof_handler,
+                   boost::property_tree::ptree const &database);
+}
+
+#endif
@@ -0,0 +1,42 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_DEAL_II_DOF_RENUMBERING_TEMPLATES_H
+#define CAP_DEAL_II_DOF_RENUMBERING_TEMPLATES_H
+
+#include <cap/dof_renumbering.h>
+#include <deal.II/base/point.h>
+#include <deal.II/dofs/dof_renumbering.h>
+#include <stdexcept>
+#include <string>
+
+namespace cap
+{
+template <int dim>
+void renumber_dofs(dealii::DoFHandler<dim> &dof_handler,
+                   boost::property_tree::ptree const &database)
+{
+  std::string const renumbering =
+      database.get<std::string>("renumbering", "none");
+  if (renumbering.compare("cuthill_mckee") == 0)
+    dealii::DoFRenumbering::Cuthill_McKee(dof_handler);
+  else if (renumbering.compare("downstream") == 0)
+  {
+    // The layers of the cell are stacked along the first direction.
+    dealii::Point<dim> direction;
+    direction[0] = 1.;
+    dealii::DoFRenumbering::downstream(dof_handler, direction);
+  }
+  else if (renumbering.compare("none") != 0)
+    throw std::runtime_error("Invalid renumbering " + renumbering);
+
+  if (!database.get("interleave_components", false))
+    dealii::DoFRenumbering::component_wise(dof_handler);
+}
+}
+
+#endif
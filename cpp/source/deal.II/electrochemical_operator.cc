@@ -0,0 +1,97 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <cap/electrochemical_operator.templates.h>
+#include <Epetra_MultiVector.h>
+
+namespace cap
+{
+template class ElectrochemicalOperatorBase<2>;
+template class ElectrochemicalOperator<2, 1>;
+template class ElectrochemicalOperator<2, 2>;
+template class ElectrochemicalOperator<2, 3>;
+template class ElectrochemicalOperatorBase<3>;
+template class ElectrochemicalOperator<3, 1>;
+template class ElectrochemicalOperator<3, 2>;
+template class ElectrochemicalOperator<3, 3>;
+template class ElectrochemicalOperatorBase<2, float>;
+template class ElectrochemicalOperator<2, 1, float>;
+template class ElectrochemicalOperator<2, 2, float>;
+template class ElectrochemicalOperator<2, 3, float>;
+template class ElectrochemicalOperatorBase<3, float>;
+template class ElectrochemicalOperator<3, 1, float>;
+template class ElectrochemicalOperator<3, 2, float>;
+template class ElectrochemicalOperator<3, 3, float>;
+
+template std::shared_ptr<ElectrochemicalOperatorBase<2>>
+build_electrochemical_operator(
+    std::shared_ptr<ElectrochemicalPhysicsParameters<2> const> parameters,
+    dealii::ConstraintMatrix const &constraint_matrix,
+    boost::mpi::communicator mpi_communicator);
+template std::shared_ptr<ElectrochemicalOperatorBase<3>>
+build_electrochemical_operator(
+    std::shared_ptr<ElectrochemicalPhysicsParameters<3> const> parameters,
+    dealii::ConstraintMatrix const &constraint_matrix,
+    boost::mpi::communicator mpi_communicator);
+template std::shared_ptr<ElectrochemicalOperatorBase<2, float>>
+build_electrochemical_operator(
+    std::shared_ptr<ElectrochemicalPhysicsParameters<2> const> parameters,
+    dealii::ConstraintMatrix const &constraint_matrix,
+    boost::mpi::communicator mpi_communicator);
+template std::shared_ptr<ElectrochemicalOperatorBase<3, float>>
+build_electrochemical_operator(
+    std::shared_ptr<ElectrochemicalPhysicsParameters<3> const> parameters,
+    dealii::ConstraintMatrix const &constraint_matrix,
+    boost::mpi::communicator mpi_communicator);
+
+void copy_locally_owned(dealii::Trilinos::MPI::Vector const &src,
+                        dealii::parallel::distributed::Vector<double> &dst)
+{
+  Epetra_MultiVector const &epetra_src = src.trilinos_vector();
+  BOOST_ASSERT_MSG(static_cast<unsigned int>(epetra_src.MyLength()) ==
+                       dst.local_size(),
+                   "The vectors have different layouts.");
+  for (unsigned int i = 0; i < dst.local_size(); ++i)
+    dst.local_element(i) = epetra_src[0][i];
+}
+
+void copy_locally_owned(
+    dealii::parallel::distributed::Vector<double> const &src,
+    dealii::Trilinos::MPI::Vector &dst)
+{
+  Epetra_MultiVector &epetra_dst = dst.trilinos_vector();
+  BOOST_ASSERT_MSG(static_cast<unsigned int>(epetra_dst.MyLength()) ==
+                       src.local_size(),
+                   "The vectors have different layouts.");
+  for (unsigned int i = 0; i < src.local_size(); ++i)
+    epetra_dst[0][i] = src.local_element(i);
+}
+
+void copy_locally_owned(dealii::Trilinos::MPI::Vector const &src,
+                        double const factor,
+                        dealii::parallel::distributed::Vector<float> &dst)
+{
+  Epetra_MultiVector const &epetra_src = src.trilinos_vector();
+  BOOST_ASSERT_MSG(static_cast<unsigned int>(epetra_src.MyLength()) ==
+                       dst.local_size(),
+                   "The vectors have different layouts.");
+  for (unsigned int i = 0; i < dst.local_size(); ++i)
+    dst.local_element(i) = static_cast<float>(factor * epetra_src[0][i]);
+}
+
+void add_locally_owned(double const factor,
+                       dealii::parallel::distributed::Vector<float> const &src,
+                       dealii::Trilinos::MPI::Vector &dst)
+{
+  Epetra_MultiVector &epetra_dst = dst.trilinos_vector();
+  BOOST_ASSERT_MSG(static_cast<unsigned int>(epetra_dst.MyLength()) ==
+                       src.local_size(),
+                   "The vectors have different layouts.");
+  for (unsigned int i = 0; i < src.local_size(); ++i)
+    epetra_dst[0][i] += factor * src.local_element(i);
+}
+}
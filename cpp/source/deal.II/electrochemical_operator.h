@@ -0,0 +1,215 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_DEAL_II_ELECTROCHEMICAL_OPERATOR_H
+#define CAP_DEAL_II_ELECTROCHEMICAL_OPERATOR_H
+
+#include <cap/electrochemical_physics.h>
+#include <cap/types.h>
+#include <deal.II/base/subscriptor.h>
+#include <deal.II/base/vectorization.h>
+#include <deal.II/lac/constraint_matrix.h>
+#include <deal.II/lac/parallel_vector.h>
+#include <deal.II/lac/trilinos_vector.h>
+#include <deal.II/matrix_free/fe_evaluation.h>
+#include <deal.II/matrix_free/matrix_free.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace cap
+{
+/**
+ * Matrix-free evaluation of the operator M + dt K of the electrochemical
+ * physics, where M is the mass matrix and K contains the diffusion of the
+ * solid and the liquid potentials and the faradaic coupling. The operator is
+ * evaluated on the fly with sum factorization. The material properties are
+ * constant on each cell and they are stored once per batch of cells. This
+ * class only defines the interface, the polynomial degree is a template
+ * argument of ElectrochemicalOperator. The operator and the vectors it acts
+ * on are stored with the precision @p Number, float is used by the inner
+ * solves of the iterative refinement of SuperCapacitor.
+ *
+ * The constraints are treated as follows: vmult() applies the operator
+ * restricted to the unconstrained degrees of freedom and the identity on the
+ * constrained ones. apply_add() applies the full operator, i.e., it reads the
+ * values of the constrained degrees of freedom. It is used to compute the
+ * mass term of the right-hand side and to lift the Dirichlet boundary
+ * conditions.
+ */
+template <int dim, typename Number = double>
+class ElectrochemicalOperatorBase : public dealii::Subscriptor
+{
+public:
+  typedef dealii::parallel::distributed::Vector<Number> VectorType;
+
+  virtual ~ElectrochemicalOperatorBase() = default;
+
+  /**
+   * @p dst = (M + dt K) @p src with homogeneous constraints.
+   */
+  virtual void vmult(VectorType &dst, VectorType const &src) const = 0;
+
+  /**
+   * @p dst += (@p mass_factor M + @p stiffness_factor K) @p src. The values
+   * of the constrained degrees of freedom of @p src are used as they are.
+   */
+  virtual void apply_add(VectorType &dst, VectorType const &src,
+                         double const mass_factor,
+                         double const stiffness_factor) const = 0;
+
+  /**
+   * Initialize @p vector with the layout used by the operator.
+   */
+  virtual void initialize_dof_vector(VectorType &vector) const = 0;
+
+  /**
+   * Set the entries of @p vector corresponding to constrained degrees of
+   * freedom to zero.
+   */
+  virtual void set_constrained_entries_to_zero(VectorType &vector) const = 0;
+
+  /**
+   * Return the inverse of the diagonal of the operator used by vmult().
+   */
+  virtual VectorType const &get_matrix_diagonal_inverse() const = 0;
+
+  /**
+   * Return the number of rows of the operator.
+   */
+  virtual dealii::types::global_dof_index m() const = 0;
+
+  /**
+   * Return the number of columns of the operator.
+   */
+  dealii::types::global_dof_index n() const;
+
+  /**
+   * Return the diagonal entry @p i of the operator. Only the diagonal entries
+   * are available.
+   */
+  Number el(dealii::types::global_dof_index const i,
+            dealii::types::global_dof_index const j) const;
+};
+
+/**
+ * Implementation of ElectrochemicalOperatorBase for FE_Q elements of degree
+ * @p fe_degree.
+ */
+template <int dim, int fe_degree, typename Number = double>
+class ElectrochemicalOperator : public ElectrochemicalOperatorBase<dim, Number>
+{
+public:
+  typedef
+      typename ElectrochemicalOperatorBase<dim, Number>::VectorType VectorType;
+
+  ElectrochemicalOperator(
+      std::shared_ptr<ElectrochemicalPhysicsParameters<dim> const> parameters,
+      dealii::ConstraintMatrix const &constraint_matrix,
+      boost::mpi::communicator mpi_communicator);
+
+  void vmult(VectorType &dst, VectorType const &src) const override;
+
+  void apply_add(VectorType &dst, VectorType const &src,
+                 double const mass_factor,
+                 double const stiffness_factor) const override;
+
+  void initialize_dof_vector(VectorType &vector) const override;
+
+  void set_constrained_entries_to_zero(VectorType &vector) const override;
+
+  VectorType const &get_matrix_diagonal_inverse() const override;
+
+  dealii::types::global_dof_index m() const override;
+
+private:
+  typedef dealii::FEEvaluation<dim, fe_degree, fe_degree + 1, 2, Number>
+      FEEvaluationType;
+
+  /**
+   * Apply the operator on the cells in @p cell_range.
+   */
+  void local_apply(dealii::MatrixFree<dim, Number> const &data,
+                   VectorType &dst, VectorType const &src,
+                   std::pair<unsigned int, unsigned int> const &cell_range,
+                   double const mass_factor, double const stiffness_factor,
+                   bool const homogeneous) const;
+
+  /**
+   * Apply the operator to the values of the degrees of freedom of the batch
+   * of cells @p cell stored in @p phi.
+   */
+  void local_operation(FEEvaluationType &phi, unsigned int const cell,
+                       double const mass_factor,
+                       double const stiffness_factor) const;
+
+  void compute_diagonal();
+
+  unsigned int _solid_potential_component;
+  unsigned int _liquid_potential_component;
+  double _time_step;
+  dealii::MatrixFree<dim, Number> _data;
+  /**
+   * Local indices of the constrained degrees of freedom that are locally
+   * owned.
+   */
+  std::vector<unsigned int> _constrained_dofs;
+  /**
+   * Material properties for each batch of cells.
+   */
+  std::vector<dealii::VectorizedArray<Number>> _specific_capacitance;
+  std::vector<dealii::VectorizedArray<Number>> _solid_conductivity;
+  std::vector<dealii::VectorizedArray<Number>> _liquid_conductivity;
+  std::vector<dealii::VectorizedArray<Number>> _faradaic_reaction_coefficient;
+  VectorType _diagonal_inverse;
+};
+
+/**
+ * Build an ElectrochemicalOperator whose polynomial degree is the degree of
+ * the finite element of the DoFHandler in @p parameters.
+ */
+template <int dim, typename Number = double>
+std::shared_ptr<ElectrochemicalOperatorBase<dim, Number>>
+build_electrochemical_operator(
+    std::shared_ptr<ElectrochemicalPhysicsParameters<dim> const> parameters,
+    dealii::ConstraintMatrix const &constraint_matrix,
+    boost::mpi::communicator mpi_communicator);
+
+/**
+ * Copy the locally owned entries of @p src in @p dst. Both vectors must have
+ * the same parallel layout.
+ */
+void copy_locally_owned(dealii::Trilinos::MPI::Vector const &src,
+                        dealii::parallel::distributed::Vector<double> &dst);
+
+/**
+ * Copy the locally owned entries of @p src in @p dst. Both vectors must have
+ * the same parallel layout.
+ */
+void copy_locally_owned(
+    dealii::parallel::distributed::Vector<double> const &src,
+    dealii::Trilinos::MPI::Vector &dst);
+
+/**
+ * Copy the locally owned entries of @p src, scaled by @p factor, in @p dst
+ * rounding them to single precision. Both vectors must have the same
+ * parallel layout.
+ */
+void copy_locally_owned(dealii::Trilinos::MPI::Vector const &src,
+                        double const factor,
+                        dealii::parallel::distributed::Vector<float> &dst);
+
+/**
+ * Add the locally owned entries of @p src, scaled by @p factor, to @p dst.
+ * Both vectors must have the same parallel layout.
+ */
+void add_locally_owned(double const factor,
+                       dealii::parallel::distributed::Vector<float> const &src,
+                       dealii::Trilinos::MPI::Vector &dst);
+}
+
+#endif
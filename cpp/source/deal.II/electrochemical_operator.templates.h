@@ -0,0 +1,310 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_DEAL_II_ELECTROCHEMICAL_OPERATOR_TEMPLATES_H
+#define CAP_DEAL_II_ELECTROCHEMICAL_OPERATOR_TEMPLATES_H
+
+#include <cap/electrochemical_operator.h>
+#include <boost/assert.hpp>
+#include <deal.II/base/quadrature_lib.h>
+#include <deal.II/base/utilities.h>
+#include <deal.II/dofs/dof_tools.h>
+#include <deal.II/fe/mapping_q1.h>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+namespace cap
+{
+template <int dim, typename Number>
+dealii::types::global_dof_index
+ElectrochemicalOperatorBase<dim, Number>::n() const
+{
+  return m();
+}
+
+template <int dim, typename Number>
+Number ElectrochemicalOperatorBase<dim, Number>::el(
+    dealii::types::global_dof_index const i,
+    dealii::types::global_dof_index const j) const
+{
+  BOOST_ASSERT_MSG(i == j, "Only the diagonal entries are available.");
+  return 1. / get_matrix_diagonal_inverse()(i);
+}
+
+template <int dim, int fe_degree, typename Number>
+ElectrochemicalOperator<dim, fe_degree, Number>::ElectrochemicalOperator(
+    std::shared_ptr<ElectrochemicalPhysicsParameters<dim> const> parameters,
+    dealii::ConstraintMatrix const &constraint_matrix,
+    boost::mpi::communicator mpi_communicator)
+    : _solid_potential_component(
+          parameters->database.template get<unsigned int>(
+              "solid_potential_component")),
+      _liquid_potential_component(
+          parameters->database.template get<unsigned int>(
+              "liquid_potential_component")),
+      _time_step(parameters->time_step), _data(), _constrained_dofs(),
+      _specific_capacitance(), _solid_conductivity(), _liquid_conductivity(),
+      _faradaic_reaction_coefficient(), _diagonal_inverse()
+{
+  dealii::DoFHandler<dim> const &dof_handler = *(parameters->dof_handler);
+  BOOST_ASSERT_MSG(dof_handler.get_fe().degree == fe_degree,
+                   "The degree of the finite element does not match.");
+
+  // MatrixFree only deals with homogeneous constraints. The inhomogeneities
+  // are taken care of by apply_add().
+  dealii::IndexSet locally_relevant_dofs;
+  dealii::DoFTools::extract_locally_relevant_dofs(dof_handler,
+                                                  locally_relevant_dofs);
+  dealii::ConstraintMatrix homogeneous_constraints(locally_relevant_dofs);
+  for (unsigned int i = 0; i < locally_relevant_dofs.n_elements(); ++i)
+  {
+    dealii::types::global_dof_index const dof =
+        locally_relevant_dofs.nth_index_in_set(i);
+    if (constraint_matrix.is_constrained(dof))
+    {
+      homogeneous_constraints.add_line(dof);
+      homogeneous_constraints.add_entries(
+          dof, *constraint_matrix.get_constraint_entries(dof));
+    }
+  }
+  homogeneous_constraints.close();
+
+  typename dealii::MatrixFree<dim, Number>::AdditionalData additional_data;
+  additional_data.mpi_communicator = mpi_communicator;
+  additional_data.tasks_parallel_scheme =
+      dealii::MatrixFree<dim, Number>::AdditionalData::none;
+  additional_data.mapping_update_flags =
+      dealii::update_values | dealii::update_gradients |
+      dealii::update_JxW_values;
+  _data.reinit(dealii::MappingQ1<dim>(), dof_handler, homogeneous_constraints,
+               dealii::QGauss<1>(fe_degree + 1), additional_data);
+
+  dealii::IndexSet const &locally_owned_dofs = dof_handler.locally_owned_dofs();
+  for (unsigned int i = 0; i < locally_owned_dofs.n_elements(); ++i)
+    if (homogeneous_constraints.is_constrained(
+            locally_owned_dofs.nth_index_in_set(i)))
+      _constrained_dofs.push_back(i);
+
+  // The material properties are constant on each cell.
+  unsigned int const n_macro_cells = _data.n_macro_cells();
+  _specific_capacitance.resize(n_macro_cells);
+  _solid_conductivity.resize(n_macro_cells);
+  _liquid_conductivity.resize(n_macro_cells);
+  _faradaic_reaction_coefficient.resize(n_macro_cells);
+  std::vector<double> values(1);
+  for (unsigned int cell = 0; cell < n_macro_cells; ++cell)
+    for (unsigned int v = 0; v < _data.n_components_filled(cell); ++v)
+    {
+      // MatrixFree returns a cell_iterator but the cells are active.
+      typename dealii::DoFHandler<dim>::active_cell_iterator const
+          cell_iterator(_data.get_cell_iterator(cell, v));
+      // clang-format off
+      parameters->mp_values->get_values("specific_capacitance",           cell_iterator, values);
+      _specific_capacitance[cell][v] = values[0];
+      parameters->mp_values->get_values("solid_electrical_conductivity",  cell_iterator, values);
+      _solid_conductivity[cell][v] = values[0];
+      parameters->mp_values->get_values("liquid_electrical_conductivity", cell_iterator, values);
+      _liquid_conductivity[cell][v] = values[0];
+      parameters->mp_values->get_values("faradaic_reaction_coefficient",  cell_iterator, values);
+      _faradaic_reaction_coefficient[cell][v] = values[0];
+      // clang-format on
+    }
+
+  compute_diagonal();
+}
+
+template <int dim, int fe_degree, typename Number>
+void ElectrochemicalOperator<dim, fe_degree, Number>::vmult(
+    VectorType &dst, VectorType const &src) const
+{
+  dst = 0.;
+  std::function<void(dealii::MatrixFree<dim, Number> const &, VectorType &,
+                     VectorType const &,
+                     std::pair<unsigned int, unsigned int> const &)> const
+      cell_operation = [this](
+          dealii::MatrixFree<dim, Number> const &data, VectorType &dst,
+          VectorType const &src,
+          std::pair<unsigned int, unsigned int> const &cell_range)
+  {
+    this->local_apply(data, dst, src, cell_range, 1., _time_step, true);
+  };
+  _data.cell_loop(cell_operation, dst, src);
+  for (auto const i : _constrained_dofs)
+    dst.local_element(i) = src.local_element(i);
+}
+
+template <int dim, int fe_degree, typename Number>
+void ElectrochemicalOperator<dim, fe_degree, Number>::apply_add(
+    VectorType &dst, VectorType const &src, double const mass_factor,
+    double const stiffness_factor) const
+{
+  std::function<void(dealii::MatrixFree<dim, Number> const &, VectorType &,
+                     VectorType const &,
+                     std::pair<unsigned int, unsigned int> const &)> const
+      cell_operation = [this, mass_factor, stiffness_factor](
+          dealii::MatrixFree<dim, Number> const &data, VectorType &dst,
+          VectorType const &src,
+          std::pair<unsigned int, unsigned int> const &cell_range)
+  {
+    this->local_apply(data, dst, src, cell_range, mass_factor,
+                      _time_step * stiffness_factor, false);
+  };
+  _data.cell_loop(cell_operation, dst, src);
+}
+
+template <int dim, int fe_degree, typename Number>
+void ElectrochemicalOperator<dim, fe_degree, Number>::initialize_dof_vector(
+    VectorType &vector) const
+{
+  _data.initialize_dof_vector(vector);
+}
+
+template <int dim, int fe_degree, typename Number>
+void ElectrochemicalOperator<dim, fe_degree,
+                             Number>::set_constrained_entries_to_zero(
+    VectorType &vector) const
+{
+  for (auto const i : _constrained_dofs)
+    vector.local_element(i) = 0.;
+}
+
+template <int dim, int fe_degree, typename Number>
+typename ElectrochemicalOperator<dim, fe_degree, Number>::VectorType const &
+ElectrochemicalOperator<dim, fe_degree,
+                        Number>::get_matrix_diagonal_inverse() const
+{
+  return _diagonal_inverse;
+}
+
+template <int dim, int fe_degree, typename Number>
+dealii::types::global_dof_index
+ElectrochemicalOperator<dim, fe_degree, Number>::m() const
+{
+  return _data.get_vector_partitioner()->size();
+}
+
+template <int dim, int fe_degree, typename Number>
+void ElectrochemicalOperator<dim, fe_degree, Number>::local_apply(
+    dealii::MatrixFree<dim, Number> const &data, VectorType &dst,
+    VectorType const &src,
+    std::pair<unsigned int, unsigned int> const &cell_range,
+    double const mass_factor, double const stiffness_factor,
+    bool const homogeneous) const
+{
+  FEEvaluationType phi(data);
+  for (unsigned int cell = cell_range.first; cell < cell_range.second; ++cell)
+  {
+    phi.reinit(cell);
+    if (homogeneous)
+      phi.read_dof_values(src);
+    else
+      phi.read_dof_values_plain(src);
+    local_operation(phi, cell, mass_factor, stiffness_factor);
+    phi.distribute_local_to_global(dst);
+  }
+}
+
+template <int dim, int fe_degree, typename Number>
+void ElectrochemicalOperator<dim, fe_degree, Number>::local_operation(
+    FEEvaluationType &phi, unsigned int const cell, double const mass_factor,
+    double const stiffness_factor) const
+{
+  unsigned int const s = _solid_potential_component;
+  unsigned int const l = _liquid_potential_component;
+  dealii::VectorizedArray<Number> const coupling_coefficient =
+      static_cast<Number>(mass_factor) * _specific_capacitance[cell] +
+      static_cast<Number>(stiffness_factor) *
+          _faradaic_reaction_coefficient[cell];
+  dealii::VectorizedArray<Number> const solid_coefficient =
+      static_cast<Number>(stiffness_factor) * _solid_conductivity[cell];
+  dealii::VectorizedArray<Number> const liquid_coefficient =
+      static_cast<Number>(stiffness_factor) * _liquid_conductivity[cell];
+  phi.evaluate(true, true);
+  for (unsigned int q = 0; q < phi.n_q_points; ++q)
+  {
+    auto value = phi.get_value(q);
+    auto gradient = phi.get_gradient(q);
+    dealii::VectorizedArray<Number> const coupling =
+        coupling_coefficient * (value[s] - value[l]);
+    value[s] = coupling;
+    value[l] = -coupling;
+    gradient[s] *= solid_coefficient;
+    gradient[l] *= liquid_coefficient;
+    phi.submit_value(value, q);
+    phi.submit_gradient(gradient, q);
+  }
+  phi.integrate(true, true);
+}
+
+template <int dim, int fe_degree, typename Number>
+void ElectrochemicalOperator<dim, fe_degree, Number>::compute_diagonal()
+{
+  _data.initialize_dof_vector(_diagonal_inverse);
+  FEEvaluationType phi(_data);
+  unsigned int const dofs_per_cell =
+      2 * dealii::Utilities::fixed_int_power<fe_degree + 1, dim>::value;
+  std::vector<dealii::VectorizedArray<Number>> local_diagonal(dofs_per_cell);
+  for (unsigned int cell = 0; cell < _data.n_macro_cells(); ++cell)
+  {
+    // Apply the operator to each basis function and keep the diagonal entry.
+    phi.reinit(cell);
+    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+    {
+      for (unsigned int j = 0; j < dofs_per_cell; ++j)
+        phi.begin_dof_values()[j] = 0.;
+      phi.begin_dof_values()[i] = 1.;
+      local_operation(phi, cell, 1., _time_step);
+      local_diagonal[i] = phi.begin_dof_values()[i];
+    }
+    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+      phi.begin_dof_values()[i] = local_diagonal[i];
+    phi.distribute_local_to_global(_diagonal_inverse);
+  }
+  _diagonal_inverse.compress(dealii::VectorOperation::add);
+
+  // The operator is the identity on the constrained degrees of freedom. The
+  // rows of the degrees of freedom without physics are empty, they are left
+  // unchanged by the preconditioner.
+  for (auto const i : _constrained_dofs)
+    _diagonal_inverse.local_element(i) = 1.;
+  for (unsigned int i = 0; i < _diagonal_inverse.local_size(); ++i)
+  {
+    Number const diagonal = _diagonal_inverse.local_element(i);
+    _diagonal_inverse.local_element(i) =
+        (diagonal != Number(0.)) ? Number(1.) / diagonal : Number(1.);
+  }
+}
+
+template <int dim, typename Number>
+std::shared_ptr<ElectrochemicalOperatorBase<dim, Number>>
+build_electrochemical_operator(
+    std::shared_ptr<ElectrochemicalPhysicsParameters<dim> const> parameters,
+    dealii::ConstraintMatrix const &constraint_matrix,
+    boost::mpi::communicator mpi_communicator)
+{
+  unsigned int const fe_degree = parameters->dof_handler->get_fe().degree;
+  switch (fe_degree)
+  {
+  case 1:
+    return std::make_shared<ElectrochemicalOperator<dim, 1, Number>>(
+        parameters, constraint_matrix, mpi_communicator);
+  case 2:
+    return std::make_shared<ElectrochemicalOperator<dim, 2, Number>>(
+        parameters, constraint_matrix, mpi_communicator);
+  case 3:
+    return std::make_shared<ElectrochemicalOperator<dim, 3, Number>>(
+        parameters, constraint_matrix, mpi_communicator);
+  default:
+    throw std::runtime_error("The matrix-free operator is not instantiated "
+                             "for degree " +
+                             std::to_string(fe_degree));
+  }
+}
+}
+
+#endif
@@ -9,7 +9,8 @@
 #define CAP_DEAL_II_ELECTROCHEMICAL_PHYSICS_H
 
 #include <cap/physics.h>
-#include <cap/timer.h>
+#include <cap/timer_registry.h>
+#include <vector>
 
 namespace cap
 {
@@ -31,7 +32,7 @@ public:
   ElectrochemicalPhysicsParameters(boost::property_tree::ptree const &d)
       : PhysicsParameters<dim>(d), supercapacitor_state(Uninitialized),
         constant_current_density(0.), constant_voltage(0.),
-        constant_load_density(0.), time_step(0.)
+        constant_load_density(0.), time_step(0.), record_cost(false)
   {
   }
 
@@ -40,6 +41,12 @@ public:
   double constant_voltage;
   double constant_load_density;
   double time_step;
+  /**
+   * If true, the assembly time and the number of matrix entries of each
+   * material are recorded. This is only needed to calibrate the load
+   * balancing.
+   */
+  bool record_cost;
 };
 
 /**
@@ -55,18 +62,59 @@ public:
       std::shared_ptr<PhysicsParameters<dim> const> parameters,
       boost::mpi::communicator mpi_communicator);
 
-  ~ElectrochemicalPhysics();
+  /**
+   * Return the wall-clock time in seconds spent assembling the locally owned
+   * cells of each material. The vector is indexed by the material id. It is
+   * empty unless ElectrochemicalPhysicsParameters::record_cost is set.
+   */
+  std::vector<double> const &get_assembly_time() const
+  {
+    return _assembly_time;
+  }
+
+  /**
+   * Return the number of entries of the cell matrices of the locally owned
+   * cells of each material that are added to the system matrix. This is a
+   * measure of the share of each material in the cost of a matrix-vector
+   * product. The vector is indexed by the material id. It is empty unless
+   * ElectrochemicalPhysicsParameters::record_cost is set.
+   */
+  std::vector<double> const &get_n_matrix_entries() const
+  {
+    return _n_matrix_entries;
+  }
 
 private:
   void assemble_system(std::shared_ptr<PhysicsParameters<dim> const> parameters,
                        bool const inhomogeneous_bc);
 
+  /**
+   * Constrain to zero the degrees of freedom of a potential that are only
+   * supported by cells where this potential carries no physics, i.e., where
+   * the corresponding conductivity, the specific capacitance, and the
+   * faradaic reaction coefficient all vanish. This is the case of the liquid
+   * potential in the collectors and of the solid potential in the separator.
+   * Without these constraints, the corresponding rows of the system matrix
+   * are empty.
+   */
+  void constrain_inactive_dofs();
+
   unsigned int solid_potential_component;
   unsigned int liquid_potential_component;
   dealii::types::boundary_id anode_boundary_id;
   dealii::types::boundary_id cathode_boundary_id;
-  Timer _assembly_timer;
-  Timer _setup_timer;
+  /**
+   * Locally relevant degrees of freedom constrained by
+   * constrain_inactive_dofs().
+   */
+  dealii::IndexSet inactive_dofs;
+  /**
+   * If false, only the constraints and the right-hand side are built. This is
+   * used by the matrix-free backend.
+   */
+  bool assemble_matrices;
+  std::vector<double> _assembly_time;
+  std::vector<double> _n_matrix_entries;
 };
 }
 
@@ -9,12 +9,16 @@
 #define CAP_DEAL_II_ELECTROCHEMICAL_PHYSICS_TEMPLATES_H
 
 #include <cap/electrochemical_physics.h>
+#include <cap/trace.h>
 #include <cap/types.h>
 #include <boost/assert.hpp>
 #include <deal.II/base/function.h>
 #include <deal.II/dofs/dof_tools.h>
 #include <deal.II/fe/fe_values.h>
 #include <deal.II/numerics/vector_tools.h>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
 
 namespace cap
 {
@@ -25,17 +29,22 @@ ElectrochemicalPhysics<dim>::ElectrochemicalPhysics(
     : Physics<dim>(parameters, mpi_communicator), solid_potential_component(-1),
       liquid_potential_component(-1),
       anode_boundary_id(type::invalid_boundary_id),
-      cathode_boundary_id(type::invalid_boundary_id),
-      _assembly_timer(mpi_communicator, "ElectrochemicalPhysics assembly"),
-      _setup_timer(mpi_communicator, "ElectrochemicalPhysics setup")
+      cathode_boundary_id(type::invalid_boundary_id), inactive_dofs(),
+      assemble_matrices(true), _assembly_time(), _n_matrix_entries()
 {
-  _setup_timer.start();
+  ScopedTimer setup_timer("setup");
+  CAP_TRACE_SCOPE("ElectrochemicalPhysics::setup");
   boost::property_tree::ptree const &database = parameters->database;
 
   // clang-format off
   this->solid_potential_component  = database.get<unsigned int>("solid_potential_component");
   this->liquid_potential_component = database.get<unsigned int>("liquid_potential_component");
   // clang-format on
+  // The matrix-free backend only needs the constraints and the Neumann part
+  // of the right-hand side.
+  assemble_matrices =
+      (database.get<std::string>("solver.backend", "matrix_based") !=
+       "matrix_free");
 
   anode_boundary_id = parameters->geometry->get_anode_boundary_id();
   cathode_boundary_id = parameters->geometry->get_cathode_boundary_id();
@@ -58,6 +67,12 @@ ElectrochemicalPhysics<dim>::ElectrochemicalPhysics(
   dealii::DoFTools::make_hanging_node_constraints(*(this->dof_handler),
                                                   this->constraint_matrix);
 
+  // Remove the degrees of freedom that carry no physics.
+  inactive_dofs.clear();
+  inactive_dofs.set_size(this->dof_handler->n_dofs());
+  if (database.get("solver.eliminate_inactive_dofs", false))
+    constrain_inactive_dofs();
+
   // Take care of Dirichlet boundary condition.
   // The anode is always set in Earth (Dirichlet value of 0).
   // If we impose a the voltage, the cathode is also a Dirichlet condition.
@@ -88,40 +103,59 @@ ElectrochemicalPhysics<dim>::ElectrochemicalPhysics(
   // Finally close the ConstraintMatrix.
   this->constraint_matrix.close();
 
-  // Create sparsity pattern
-  this->sparsity_pattern.reinit(
-      this->locally_owned_dofs, this->locally_owned_dofs,
-      this->locally_relevant_dofs, this->mpi_communicator);
-  dealii::DoFTools::make_sparsity_pattern(
-      *(this->dof_handler), this->sparsity_pattern, this->constraint_matrix,
-      true, dealii::Utilities::MPI::this_mpi_process(this->mpi_communicator));
-  this->sparsity_pattern.compress();
-
-  // Initialize matrices and vectors
-  this->system_matrix.reinit(this->sparsity_pattern);
-  this->mass_matrix.reinit(this->sparsity_pattern);
+  if (assemble_matrices)
+  {
+    // Create sparsity pattern
+    this->sparsity_pattern.reinit(
+        this->locally_owned_dofs, this->locally_owned_dofs,
+        this->locally_relevant_dofs, this->mpi_communicator);
+    if (dealii::Utilities::MPI::sum(inactive_dofs.n_elements(),
+                                    this->mpi_communicator) == 0)
+      dealii::DoFTools::make_sparsity_pattern(
+          *(this->dof_handler), this->sparsity_pattern,
+          this->constraint_matrix, true,
+          dealii::Utilities::MPI::this_mpi_process(this->mpi_communicator));
+    else
+    {
+      // The inactive degrees of freedom only keep their diagonal entry.
+      unsigned int const dofs_per_cell =
+          this->dof_handler->get_fe().dofs_per_cell;
+      std::vector<dealii::types::global_dof_index> local_dof_indices(
+          dofs_per_cell);
+      dealii::Table<2, bool> dof_mask(dofs_per_cell, dofs_per_cell);
+      for (auto cell : this->dof_handler->active_cell_iterators())
+        if (cell->is_locally_owned())
+        {
+          cell->get_dof_indices(local_dof_indices);
+          for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            for (unsigned int j = 0; j < dofs_per_cell; ++j)
+              dof_mask(i, j) =
+                  (i == j) ||
+                  (!inactive_dofs.is_element(local_dof_indices[i]) &&
+                   !inactive_dofs.is_element(local_dof_indices[j]));
+          this->constraint_matrix.add_entries_local_to_global(
+              local_dof_indices, this->sparsity_pattern, true, dof_mask);
+        }
+    }
+    this->sparsity_pattern.compress();
+
+    // Initialize matrices and vectors
+    this->system_matrix.reinit(this->sparsity_pattern);
+    this->mass_matrix.reinit(this->sparsity_pattern);
+  }
   this->system_rhs.reinit(this->locally_owned_dofs, this->mpi_communicator);
 
-  _setup_timer.stop();
+  setup_timer.stop();
   assemble_system(parameters, inhomogeneous_bc);
 }
 
-template <int dim>
-ElectrochemicalPhysics<dim>::~ElectrochemicalPhysics()
-{
-  if (this->verbose_lvl > 0)
-  {
-    _setup_timer.print();
-    _assembly_timer.print();
-  }
-}
-
 template <int dim>
 void ElectrochemicalPhysics<dim>::assemble_system(
     std::shared_ptr<PhysicsParameters<dim> const> parameters,
     bool const inhomogeneous_bc)
 {
-  _assembly_timer.start();
+  ScopedTimer assembly_timer("assembly");
+  CAP_TRACE_SCOPE("ElectrochemicalPhysics::assemble_system");
   std::shared_ptr<
       ElectrochemicalPhysicsParameters<dim> const> electrochemical_parameters =
       std::dynamic_pointer_cast<ElectrochemicalPhysicsParameters<dim> const>(
@@ -153,14 +187,27 @@ void ElectrochemicalPhysics<dim>::assemble_system(
   std::vector<double> faradaic_reaction_coefficient_values(n_q_points);
   std::vector<dealii::types::global_dof_index> local_dof_indices(dofs_per_cell);
 
-  this->system_matrix = 0.0;
-  this->mass_matrix = 0.0;
+  if (assemble_matrices)
+  {
+    this->system_matrix = 0.0;
+    this->mass_matrix = 0.0;
+  }
   this->system_rhs = 0.0;
+  // The cost of the cells is only measured to calibrate the load balancing.
+  bool const record_cost = electrochemical_parameters->record_cost;
+  std::fill(_assembly_time.begin(), _assembly_time.end(), 0.);
+  std::fill(_n_matrix_entries.begin(), _n_matrix_entries.end(), 0.);
 
+  // The volume terms only contribute to the right-hand side through the
+  // inhomogeneous constraints. With the matrix-free backend, this is done by
+  // the operator.
   for (auto cell : dof_handler.active_cell_iterators())
   {
-    if (cell->is_locally_owned())
+    if (assemble_matrices && cell->is_locally_owned())
     {
+      std::chrono::steady_clock::time_point start;
+      if (record_cost)
+        start = std::chrono::steady_clock::now();
       cell_system_matrix = 0.0;
       cell_mass_matrix = 0.0;
       cell_rhs = 0.0;
@@ -220,10 +267,34 @@ void ElectrochemicalPhysics<dim>::assemble_system(
       this->constraint_matrix.distribute_local_to_global(
           cell_system_matrix, cell_rhs, local_dof_indices, this->system_matrix,
           this->system_rhs, inhomogeneous_bc);
+      // The couplings of the inactive degrees of freedom are zero and they are
+      // not in the sparsity pattern.
+      unsigned int n_entries = 0;
       for (unsigned int i = 0; i < dofs_per_cell; ++i)
-        for (unsigned int j = 0; j < dofs_per_cell; ++j)
-          this->mass_matrix.add(local_dof_indices[i], local_dof_indices[j],
-                                cell_mass_matrix(i, j));
+        if (!inactive_dofs.is_element(local_dof_indices[i]))
+          for (unsigned int j = 0; j < dofs_per_cell; ++j)
+            if (!inactive_dofs.is_element(local_dof_indices[j]))
+            {
+              this->mass_matrix.add(local_dof_indices[i], local_dof_indices[j],
+                                    cell_mass_matrix(i, j));
+              ++n_entries;
+            }
+
+      // Record the cost of the cell for the load balancing.
+      if (record_cost)
+      {
+        dealii::types::material_id const material_id = cell->material_id();
+        if (material_id >= _assembly_time.size())
+        {
+          _assembly_time.resize(material_id + 1, 0.);
+          _n_matrix_entries.resize(material_id + 1, 0.);
+        }
+        _assembly_time[material_id] +=
+            std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          start)
+                .count();
+        _n_matrix_entries[material_id] += n_entries;
+      }
     }
   }
 
@@ -265,11 +336,96 @@ void ElectrochemicalPhysics<dim>::assemble_system(
 
   // We are done fill-in the matrices and the vector. So we can compress
   // everything.
-  this->system_matrix.compress(dealii::VectorOperation::add);
-  this->mass_matrix.compress(dealii::VectorOperation::add);
+  if (assemble_matrices)
+  {
+    this->system_matrix.compress(dealii::VectorOperation::add);
+    this->mass_matrix.compress(dealii::VectorOperation::add);
+  }
   this->system_rhs.compress(dealii::VectorOperation::add);
+}
+
+template <int dim>
+void ElectrochemicalPhysics<dim>::constrain_inactive_dofs()
+{
+  dealii::DoFHandler<dim> const &dof_handler = *(this->dof_handler);
+  dealii::FiniteElement<dim> const &fe = dof_handler.get_fe();
+  unsigned int const dofs_per_cell = fe.dofs_per_cell;
+  dealii::QGauss<dim> quadrature_rule(fe.degree + 1);
+  unsigned int const n_q_points = quadrature_rule.size();
+  std::vector<double> specific_capacitance_values(n_q_points);
+  std::vector<double> solid_phase_diffusion_coefficient_values(n_q_points);
+  std::vector<double> liquid_phase_diffusion_coefficient_values(n_q_points);
+  std::vector<double> faradaic_reaction_coefficient_values(n_q_points);
+  std::vector<dealii::types::global_dof_index> local_dof_indices(dofs_per_cell);
+  auto is_positive = [](std::vector<double> const &values)
+  {
+    return std::any_of(values.begin(), values.end(), [](double const value)
+                       {
+                         return value > 0.;
+                       });
+  };
+
+  // A degree of freedom is active if one of the cells sharing it gives it
+  // some physics. All the cells sharing a degree of freedom of a locally
+  // owned cell are either locally owned or ghost cells.
+  std::vector<dealii::types::global_dof_index> active;
+  std::vector<dealii::types::global_dof_index> candidates;
+  for (auto cell : dof_handler.active_cell_iterators())
+  {
+    if (cell->is_artificial())
+      continue;
+
+    // clang-format off
+    (this->mp_values)->get_values("specific_capacitance",           cell, specific_capacitance_values);
+    (this->mp_values)->get_values("solid_electrical_conductivity",  cell, solid_phase_diffusion_coefficient_values);
+    (this->mp_values)->get_values("liquid_electrical_conductivity", cell, liquid_phase_diffusion_coefficient_values);
+    (this->mp_values)->get_values("faradaic_reaction_coefficient",  cell, faradaic_reaction_coefficient_values);
+    // clang-format on
+    bool const coupled = is_positive(specific_capacitance_values) ||
+                         is_positive(faradaic_reaction_coefficient_values);
+    bool const solid_active =
+        coupled || is_positive(solid_phase_diffusion_coefficient_values);
+    bool const liquid_active =
+        coupled || is_positive(liquid_phase_diffusion_coefficient_values);
+
+    cell->get_dof_indices(local_dof_indices);
+    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+    {
+      unsigned int const component = fe.system_to_component_index(i).first;
+      if (((component == solid_potential_component) && solid_active) ||
+          ((component == liquid_potential_component) && liquid_active))
+        active.push_back(local_dof_indices[i]);
+    }
+    if (cell->is_locally_owned())
+      candidates.insert(candidates.end(), local_dof_indices.begin(),
+                        local_dof_indices.end());
+  }
+  std::sort(active.begin(), active.end());
+  active.erase(std::unique(active.begin(), active.end()), active.end());
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+
+  std::vector<dealii::types::global_dof_index> inactive;
+  std::set_difference(candidates.begin(), candidates.end(), active.begin(),
+                      active.end(), std::back_inserter(inactive));
+  for (auto const dof : inactive)
+    if (!this->constraint_matrix.is_constrained(dof))
+    {
+      this->constraint_matrix.add_line(dof);
+      inactive_dofs.add_index(dof);
+    }
+  inactive_dofs.compress();
 
-  _assembly_timer.stop();
+  if (this->verbose_lvl > 0)
+  {
+    dealii::types::global_dof_index const n_inactive_dofs =
+        dealii::Utilities::MPI::sum(inactive_dofs.n_elements(),
+                                    this->mpi_communicator);
+    if (dealii::Utilities::MPI::this_mpi_process(this->mpi_communicator) == 0)
+      std::cout << "Inactive degrees of freedom: " << n_inactive_dofs << " / "
+                << dof_handler.n_dofs() << std::endl;
+  }
 }
 }
 
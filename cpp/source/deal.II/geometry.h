@@ -14,7 +14,9 @@
 #include <boost/mpi.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace cap
 {
@@ -60,11 +62,60 @@ public:
     return _triangulation;
   }
 
+  /**
+   * Give write access to the triangulation. This is used to adapt the mesh.
+   * The refined cells inherit the material and the boundary ids of their
+   * parent.
+   */
+  std::shared_ptr<dealii::distributed::Triangulation<dim>>
+  get_mutable_triangulation()
+  {
+    return _triangulation;
+  }
+
+  /**
+   * Return the number of identical units of the stack represented by the
+   * triangulation. When the geometry database sets exploit_symmetry, the
+   * triangulation contains a single unit, with half of its cathode collector,
+   * and the post-processor scales the extensive quantities by this number.
+   * Otherwise, it is one.
+   */
+  unsigned int get_n_repeated_units() const { return _n_repeated_units; }
+
+  /**
+   * Set the extra weights used to balance the load between the processors.
+   * The entry i is the weight of the cells whose material id is i. It is added
+   * to the default weight of 1000 of each cell. The new weights are used the
+   * next time the mesh is repartitioned, i.e., the next time
+   * execute_coarsening_and_refinement() is called on the triangulation.
+   */
+  void set_cell_weights(std::vector<unsigned int> const &cell_weights)
+  {
+    _cell_weights = cell_weights;
+  }
+
+  std::vector<unsigned int> const &get_cell_weights() const
+  {
+    return _cell_weights;
+  }
+
   boost::mpi::communicator get_mpi_communicator() const
   {
     return _communicator;
   }
 
+  /**
+   * Return the name of the file used to cache the refined and partitioned
+   * mesh, or an empty string if the cache is disabled.
+   */
+  std::string const &get_cache_file() const { return _cache_file; }
+
+  /**
+   * Return true if the refinement and the partition of the mesh were loaded
+   * from the cache instead of being recomputed.
+   */
+  bool is_loaded_from_cache() const { return _loaded_from_cache; }
+
   std::shared_ptr<
       std::unordered_map<std::string, std::vector<dealii::types::material_id>>>
   get_materials() const
@@ -76,11 +127,18 @@ private:
   /**
    * Compute the weight used to do load balancing. This is necessary because the
    * physics solved in the collectors, the electrodes, and the separator are
-   * different.
+   * different. The weight is looked up in @p _cell_weights.
    */
   unsigned int compute_cell_weight(
-      typename dealii::Triangulation<dim, dim>::cell_iterator const &cell,
-      std::array<unsigned int, 4> const &weights) const;
+      typename dealii::Triangulation<dim, dim>::cell_iterator const &cell)
+      const;
+
+  /**
+   * Build the table of the weights of the cells from the anode.weight,
+   * cathode.weight, separator.weight, and collector.weight entries of the
+   * database. The weights default to zero.
+   */
+  void fill_cell_weights(boost::property_tree::ptree const &database);
 
   /**
    * Helper function for the constructor, when the mesh is loaded from a mesh.
@@ -101,9 +159,31 @@ private:
       std::shared_ptr<boost::property_tree::ptree> database);
 
   /**
-   * Create a mesh from a property tree.
+   * Return the name of the file used to cache the refined and partitioned
+   * mesh. The key is the hash of the geometry database and of the git commit,
+   * the dimension, and the number of processors. The hash is computed with
+   * FNV-1a so that the name does not depend on the compiler. If the database
+   * does not set cache_directory, the cache is disabled and an empty string
+   * is returned.
    */
-  void mesh_generator(boost::property_tree::ptree const &database);
+  std::string
+  build_cache_file_name(boost::property_tree::ptree const &database) const;
+
+  /**
+   * Create a mesh from a property tree. If @p _cache_file exists, the
+   * refinement and the partition of the mesh are loaded from it instead of
+   * being recomputed. Return true if the mesh was loaded from the cache.
+   */
+  bool mesh_generator(boost::property_tree::ptree const &database);
+
+  /**
+   * Save the refined and partitioned mesh in @p _cache_file. The files are
+   * written under a temporary name and renamed, the file that is checked by
+   * mesh_generator() last, so that concurrent runs never read a partially
+   * written cache. Two runs that miss the cache at the same time both write
+   * it, and the last rename wins.
+   */
+  void save_to_cache() const;
 
   /**
    * Set the boundary IDs on the cathode and the anode.
@@ -114,6 +194,13 @@ private:
   boost::mpi::communicator _communicator;
   dealii::types::boundary_id _anode_boundary_id;
   dealii::types::boundary_id _cathode_boundary_id;
+  unsigned int _n_repeated_units;
+  std::string _cache_file;
+  bool _loaded_from_cache;
+  /**
+   * Extra weight of the cells indexed by the material id.
+   */
+  std::vector<unsigned int> _cell_weights;
   std::shared_ptr<dealii::distributed::Triangulation<dim>> _triangulation;
   std::shared_ptr<std::unordered_map<
       std::string, std::vector<dealii::types::material_id>>> _materials;
@@ -6,89 +6,66 @@
  */
 
 #include <cap/geometry.h>
+#include <cap/trace.h>
 #include <cap/types.h>
 #include <cap/utils.h>
+#include <cap/version.h>
 #include <deal.II/grid/filtered_iterator.h>
-#include <deal.II/grid/grid_generator.h>
 #include <deal.II/grid/grid_in.h>
 #include <deal.II/grid/grid_tools.h>
+#include <deal.II/grid/tria.h>
 #include <deal.II/base/geometry_info.h>
+#include <boost/property_tree/info_parser.hpp>
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
+#include <functional>
+#include <iomanip>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
 #include <tuple>
+#include <vector>
 
 namespace cap
 {
 
 namespace internal
 {
-enum WEIGHT_TYPE
-{
-  anode,
-  cathode,
-  separator,
-  collector
-};
-
 template <int dim>
 struct Component
 {
 public:
-  Component(MPI_Comm mpi_communicator)
-      : offset(0.), box_dimensions(0), repetitions(0),
-        triangulation(mpi_communicator), shift_vector()
-  {
-  }
-
-  Component(std::vector<dealii::Point<dim>> const &box,
-            std::vector<unsigned int> const &repetitions,
-            MPI_Comm mpi_communicator)
-      : offset(0.), box_dimensions(box), repetitions(repetitions),
-        triangulation(mpi_communicator), shift_vector()
-  {
-  }
+  Component() : box_dimensions(0), repetitions(0), grading(1.) {}
 
-  // The current offset of the component.
-  double offset;
   std::vector<dealii::Point<dim>> box_dimensions;
   std::vector<unsigned int> repetitions;
-  dealii::distributed::Triangulation<dim> triangulation;
-  // The last shift that has been applied to the component.
-  dealii::Tensor<1, dim> shift_vector;
+  // Ratio between the widths of two consecutive cells in the through-thickness
+  // direction, going from the faces of the component toward its center.
+  double grading;
 };
 
-template <int dim>
-dealii::Point<dim> transform_coll_a(dealii::Point<dim> const &in,
-                                    double const scale_factor,
-                                    double const max_value)
+// Position of the tab of a layer of the stack.
+enum TabPosition
 {
-  double const eps = 1e-15;
-  if ((in[dim - 1] < eps) || (in[dim - 1] > (max_value - eps)))
-    return in;
-  else
-  {
-    dealii::Point<dim> out = in;
-    out[dim - 1] *= scale_factor;
-    return out;
-  }
-}
+  no_tab,
+  top_tab,
+  bottom_tab
+};
 
+// A layer of the stack: the component, the material id of its cells, and the
+// position of its tab.
 template <int dim>
-dealii::Point<dim> transform_coll_c(dealii::Point<dim> const &in,
-                                    double const scale_factor,
-                                    double const max_value, double const offset)
+struct Layer
 {
-  double const eps = 1e-15;
-  if ((in[dim - 1] < eps) || (in[dim - 1] > (max_value - eps)))
-    return in;
-  else
-  {
-    dealii::Point<dim> out = in;
-    out[dim - 1] *= scale_factor;
-    out[dim - 1] += offset;
-    return out;
-  }
-}
+  Component<dim> const *component;
+  dealii::types::material_id material_id;
+  TabPosition tab;
+};
 
 template <int dim>
 void read_component_database(boost::property_tree::ptree const &database,
@@ -101,64 +78,200 @@ void read_component_database(boost::property_tree::ptree const &database,
   component.box_dimensions.push_back(dealii::Point<dim>());
   std::vector<double> box_dimensions =
       to_vector<double>(database.get<std::string>("dimensions"));
+  if (repetitions.size() != dim)
+    throw std::runtime_error("The divisions need " + std::to_string(dim) +
+                             " values");
   if (dim == 2)
     component.box_dimensions.push_back(
         dealii::Point<dim>(box_dimensions[0], box_dimensions[1]));
   else
     component.box_dimensions.push_back(dealii::Point<dim>(
         box_dimensions[0], box_dimensions[1], box_dimensions[2]));
+  component.grading = database.get("grading", 1.);
+  if (component.grading <= 0.)
+    throw std::runtime_error("The grading must be positive");
 }
 
+// Return the widths of the cells of the component in each direction. The
+// width of the cells in the through-thickness direction is multiplied by the
+// grading of the component from one cell to the next, starting from both
+// faces of the component. In the other directions, the cells are uniform.
 template <int dim>
-void merge_components(
-    Component<dim> &component, double const offset,
-    std::shared_ptr<dealii::distributed::Triangulation<dim>> _triangulation)
+std::vector<std::vector<double>>
+compute_step_sizes(Component<dim> const &component)
 {
-  // Move the component by the necessary, i.e. desired position minus the
-  // current position
-  component.shift_vector[0] = offset - component.offset;
-  dealii::GridTools::shift(component.shift_vector, component.triangulation);
-  component.offset = offset;
-  // Merge the component with the current triangulation
-  dealii::distributed::Triangulation<dim> tmp_triangulation(
-      _triangulation->get_communicator());
-  dealii::GridGenerator::merge_triangulations(
-      *_triangulation, component.triangulation, tmp_triangulation);
-  _triangulation->clear();
-  _triangulation->copy_triangulation(tmp_triangulation);
-  // collector_c only needs to be shifted vertically the first time
-  if (component.shift_vector[dim - 1] != 0.)
-    component.shift_vector[dim - 1] = 0.;
+  std::vector<std::vector<double>> step_sizes(dim);
+  for (unsigned int d = 0; d < dim; ++d)
+  {
+    unsigned int const n_cells = component.repetitions[d];
+    std::vector<double> &widths = step_sizes[d];
+    widths.resize(n_cells, 1.);
+    if (d == 0)
+      for (unsigned int i = 0; i < n_cells; ++i)
+        widths[i] = std::pow(component.grading, std::min(i, n_cells - 1 - i));
+    double const scaling =
+        (component.box_dimensions[1][d] - component.box_dimensions[0][d]) /
+        std::accumulate(widths.begin(), widths.end(), 0.);
+    for (auto &width : widths)
+      width *= scaling;
+  }
+
+  return step_sizes;
+}
+
+// The components are stacked along the through-thickness direction, so their
+// faces need to share the same vertices. The divisions in the other
+// directions must be the same for all the components except for the
+// collectors that have one more cell in the last direction because of the tab.
+template <int dim>
+void check_divisions(Component<dim> const &collector,
+                     Component<dim> const &anode,
+                     Component<dim> const &separator,
+                     Component<dim> const &cathode)
+{
+  for (unsigned int d = 1; d < dim; ++d)
+  {
+    unsigned int const n_cells = anode.repetitions[d];
+    unsigned int const n_collector_cells =
+        (d == dim - 1) ? n_cells + 1 : n_cells;
+    if ((separator.repetitions[d] != n_cells) ||
+        (cathode.repetitions[d] != n_cells) ||
+        (collector.repetitions[d] != n_collector_cells))
+      throw std::runtime_error(
+          "The divisions in direction " + std::to_string(d) +
+          " of the components are inconsistent. The electrodes and the "
+          "separator need the same number of divisions and the collectors "
+          "need one more division in the last direction.");
+  }
+}
+
+// Create the coarse mesh of the whole stack at once. The cells of the layers
+// are structured: in the through-thickness direction, each layer uses the
+// widths of its component and, in the other directions, the cells of all the
+// layers are aligned with the cells of @p electrode. The collectors have one
+// more row of cells for the tab, either above or below the electrodes. The
+// vertices are indexed on the tensor-product grid and the ones that are not
+// used by any cell are removed before creating the triangulation.
+template <int dim>
+void create_stack(std::vector<Layer<dim>> const &layers,
+                  Component<dim> const &electrode, double const tab_height,
+                  dealii::Triangulation<dim> &triangulation)
+{
+  // Nodes in each direction. The nodes in the last direction start with the
+  // bottom of the tab and end with the top of the tab.
+  std::vector<std::vector<double>> nodes(dim, std::vector<double>(1, 0.));
+  std::vector<unsigned int> x_cell_layers;
+  for (unsigned int l = 0; l < layers.size(); ++l)
+    for (double const width : compute_step_sizes(*layers[l].component)[0])
+    {
+      nodes[0].push_back(nodes[0].back() + width);
+      x_cell_layers.push_back(l);
+    }
+  std::vector<std::vector<double>> const electrode_step_sizes =
+      compute_step_sizes(electrode);
+  for (unsigned int d = 1; d < dim; ++d)
+  {
+    for (double const width : electrode_step_sizes[d])
+      nodes[d].push_back(nodes[d].back() + width);
+    if (d == dim - 1)
+    {
+      nodes[d].insert(nodes[d].begin(), -tab_height);
+      nodes[d].push_back(nodes[d].back() + tab_height);
+    }
+  }
+
+  // The vertices are numbered with the through-thickness direction running
+  // the fastest.
+  std::array<unsigned int, dim> n_nodes;
+  unsigned int n_vertices = 1;
+  for (unsigned int d = 0; d < dim; ++d)
+  {
+    n_nodes[d] = nodes[d].size();
+    n_vertices *= n_nodes[d];
+  }
+  auto vertex_index = [&n_nodes](std::array<unsigned int, dim> const &index)
+  {
+    unsigned int vertex = 0;
+    for (unsigned int d = dim; d-- > 0;)
+      vertex = vertex * n_nodes[d] + index[d];
+    return vertex;
+  };
+  std::vector<dealii::Point<dim>> vertices(n_vertices);
+  std::array<unsigned int, dim> index;
+  for (unsigned int v = 0; v < n_vertices; ++v)
+  {
+    unsigned int remainder = v;
+    for (unsigned int d = 0; d < dim; ++d)
+    {
+      index[d] = remainder % n_nodes[d];
+      remainder /= n_nodes[d];
+      vertices[v][d] = nodes[d][index[d]];
+    }
+  }
+
+  // The cells are numbered with the through-thickness direction running the
+  // slowest so that the cells of a layer are contiguous. The vertices of a
+  // cell are numbered lexicographically.
+  std::vector<dealii::CellData<dim>> cells;
+  unsigned int const n_in_plane_cells = (dim == 2) ? 1 : n_nodes[1] - 1;
+  unsigned int const n_vertical_cells = n_nodes[dim - 1] - 1;
+  for (unsigned int i = 0; i < x_cell_layers.size(); ++i)
+  {
+    Layer<dim> const &layer = layers[x_cell_layers[i]];
+    unsigned int const first_row = (layer.tab == bottom_tab) ? 0 : 1;
+    unsigned int const last_row =
+        (layer.tab == top_tab) ? n_vertical_cells : n_vertical_cells - 1;
+    for (unsigned int j = 0; j < n_in_plane_cells; ++j)
+      for (unsigned int k = first_row; k < last_row; ++k)
+      {
+        dealii::CellData<dim> cell;
+        for (unsigned int v = 0;
+             v < dealii::GeometryInfo<dim>::vertices_per_cell; ++v)
+        {
+          index[0] = i + (v & 1);
+          if (dim == 3)
+            index[1] = j + ((v >> 1) & 1);
+          index[dim - 1] = k + ((v >> (dim - 1)) & 1);
+          cell.vertices[v] = vertex_index(index);
+        }
+        cell.material_id = layer.material_id;
+        cells.push_back(cell);
+      }
+  }
+
+  dealii::SubCellData subcell_data;
+  dealii::GridTools::delete_unused_vertices(vertices, cells, subcell_data);
+  triangulation.create_triangulation(vertices, cells, subcell_data);
 }
 }
 
 template <int dim>
 unsigned int Geometry<dim>::compute_cell_weight(
-    typename dealii::Triangulation<dim, dim>::cell_iterator const &cell,
-    std::array<unsigned int, 4> const &weights) const
+    typename dealii::Triangulation<dim, dim>::cell_iterator const &cell) const
 {
   // Cells in the anode of the cathode have to deal with two physics instead of
   // only one in the collectors and the separator. Each cell starts with a
   // default weight of 1000. This function returns the extra weight on some of
   // the cells.
-  dealii::types::material_id material = cell->material_id();
-  std::vector<dealii::types::material_id> &anode = (*_materials)["anode"];
-  std::vector<dealii::types::material_id> &cathode = (*_materials)["cathode"];
-  std::vector<dealii::types::material_id> &separator =
-      (*_materials)["separator"];
-  std::vector<dealii::types::material_id> &collector =
-      (*_materials)["collector"];
-  if (std::find(anode.begin(), anode.end(), material) != anode.end())
-    return weights[internal::WEIGHT_TYPE::anode];
-  if (std::find(cathode.begin(), cathode.end(), material) != cathode.end())
-    return weights[internal::WEIGHT_TYPE::cathode];
-  if (std::find(separator.begin(), separator.end(), material) !=
-      separator.end())
-    return weights[internal::WEIGHT_TYPE::separator];
-  if (std::find(collector.begin(), collector.end(), material) !=
-      collector.end())
-    return weights[internal::WEIGHT_TYPE::collector];
-  return dealii::numbers::invalid_unsigned_int;
+  dealii::types::material_id const material = cell->material_id();
+  return (material < _cell_weights.size()) ? _cell_weights[material] : 0;
+}
+
+template <int dim>
+void Geometry<dim>::fill_cell_weights(
+    boost::property_tree::ptree const &database)
+{
+  _cell_weights.clear();
+  for (std::string const &name : {"anode", "cathode", "separator", "collector"})
+  {
+    unsigned int const weight = database.get(name + ".weight", 0);
+    for (auto const material_id : (*_materials)[name])
+    {
+      if (material_id >= _cell_weights.size())
+        _cell_weights.resize(material_id + 1, 0);
+      _cell_weights[material_id] = weight;
+    }
+  }
 }
 
 template <int dim>
@@ -260,14 +373,33 @@ Geometry<dim>::Geometry(std::shared_ptr<boost::property_tree::ptree> database,
                         boost::mpi::communicator mpi_communicator)
     : _communicator(mpi_communicator),
       _anode_boundary_id(type::invalid_boundary_id),
-      _cathode_boundary_id(type::invalid_boundary_id), _triangulation(nullptr),
+      _cathode_boundary_id(type::invalid_boundary_id), _n_repeated_units(1),
+      _cache_file(""), _loaded_from_cache(false), _triangulation(nullptr),
       _materials(nullptr)
 {
+  CAP_TRACE_SCOPE("Geometry::Geometry");
   _triangulation = std::make_shared<dealii::distributed::Triangulation<dim>>(
       mpi_communicator);
+  // The key of the cache is computed before the database is modified.
+  _cache_file = build_cache_file_name(*database);
   std::string mesh_type = database->get<std::string>("type");
+  bool const exploit_symmetry = database->get("exploit_symmetry", false);
+  // Each rank of a distributed::Triangulation holds the whole coarse mesh.
+  // Building only the locally owned part requires
+  // parallel::fullydistributed::Triangulation which is not available in the
+  // version of deal.II that we use.
+  if (database->get("fully_distributed", false))
+    throw std::runtime_error(
+        "fully_distributed requires deal.II 9.2 or later. Use "
+        "exploit_symmetry to reduce the size of the mesh of a stack.");
   if (mesh_type.compare("file") == 0)
   {
+    if (exploit_symmetry)
+      throw std::runtime_error(
+          "exploit_symmetry can only be used with a generated mesh");
+    if (!_cache_file.empty())
+      throw std::runtime_error(
+          "cache_directory can only be used with a generated mesh");
     std::string mesh_file = database->get<std::string>("mesh_file");
     dealii::GridIn<dim> mesh_reader;
     mesh_reader.attach_triangulation(*_triangulation);
@@ -318,10 +450,10 @@ Geometry<dim>::Geometry(std::shared_ptr<boost::property_tree::ptree> database,
       }
       else
       {
-        std::string collector_div("3,3,3");
-        std::string anode_div("5,5,2");
+        std::string collector_div("3,4,3");
+        std::string anode_div("5,4,2");
         std::string separator_div("4,4,2");
-        std::string cathode_div("5,5,2");
+        std::string cathode_div("5,4,2");
         database->put("collector.divisions", collector_div);
         database->put("anode.divisions", anode_div);
         database->put("separator.divisions", separator_div);
@@ -329,24 +461,92 @@ Geometry<dim>::Geometry(std::shared_ptr<boost::property_tree::ptree> database,
       }
 
       database->put("n_repetitions", 0);
-      database->put("n_refinements", 1);
+      // The refinement of the default mesh can be changed, e.g., to study the
+      // convergence.
+      database->put("n_refinements",
+                    database->get<unsigned int>("n_refinements", 1));
     }
-    mesh_generator(*database);
+
+    // The units of the stack are mirror images of each other and they are
+    // connected in parallel. When all the units carry the same current, the
+    // midplane of a collector shared by two units is a symmetry plane, which
+    // is the natural boundary condition. So we only mesh one unit, with half
+    // of its cathode collector (see mesh_generator), and the post-processor
+    // scales the results to the whole stack.
+    if (exploit_symmetry)
+    {
+      _n_repeated_units = database->get<unsigned int>("n_repetitions", 1) + 1;
+      database->put("n_repetitions", 0);
+    }
+    _loaded_from_cache = mesh_generator(*database);
   }
 
   // We need to do load balancing because cells in the collectors and the
   // separator don't have both physics.
-  std::array<unsigned int, 4> weights;
-  weights[internal::WEIGHT_TYPE::anode] = database->get("anode.weight", 0);
-  weights[internal::WEIGHT_TYPE::cathode] = database->get("cathode.weight", 0);
-  weights[internal::WEIGHT_TYPE::separator] =
-      database->get("separator.weight", 0);
-  weights[internal::WEIGHT_TYPE::collector] =
-      database->get("collector.weight", 0);
-  _triangulation->signals.cell_weight.connect(
-      std::bind(&Geometry<dim>::compute_cell_weight, this,
-                std::placeholders::_1, weights));
-  _triangulation->repartition();
+  fill_cell_weights(*database);
+  _triangulation->signals.cell_weight.connect(std::bind(
+      &Geometry<dim>::compute_cell_weight, this, std::placeholders::_1));
+  // The partition is part of the cache.
+  if (!_loaded_from_cache)
+  {
+    _triangulation->repartition();
+    if (!_cache_file.empty())
+      save_to_cache();
+  }
+}
+
+template <int dim>
+std::string Geometry<dim>::build_cache_file_name(
+    boost::property_tree::ptree const &database) const
+{
+  std::string const cache_directory = database.get("cache_directory", "");
+  if (cache_directory.empty())
+    return "";
+
+  // The mesh generator may change between two versions of Cap, so the commit
+  // is part of the key.
+  std::stringstream info;
+  boost::property_tree::info_parser::write_info(info, database);
+  info << git_commit_hash();
+  std::uint64_t key = 14695981039346656037ull;
+  for (unsigned char const c : info.str())
+  {
+    key ^= c;
+    key *= 1099511628211ull;
+  }
+  std::stringstream file;
+  file << cache_directory << "/geometry_" << dim << "d_" << std::hex
+       << std::setw(16) << std::setfill('0') << key << std::dec << "_"
+       << _communicator.size() << ".mesh";
+
+  return file.str();
+}
+
+template <int dim>
+void Geometry<dim>::save_to_cache() const
+{
+  // The temporary name is unique to this run.
+  std::uint64_t tag = 0;
+  if (_communicator.rank() == 0)
+    tag = (static_cast<std::uint64_t>(std::random_device()()) << 32) |
+          std::random_device()();
+  boost::mpi::broadcast(_communicator, tag, 0);
+  std::string const tmp_file = _cache_file + ".tmp" + std::to_string(tag);
+  _triangulation->save(tmp_file);
+  _communicator.barrier();
+  if (_communicator.rank() == 0)
+  {
+    // Depending on the version of deal.II, the mesh is stored in several
+    // files next to the one that is checked by mesh_generator().
+    for (std::string const suffix :
+         {".info", "_fixed.data", "_variable.data", ""})
+      if (std::ifstream(tmp_file + suffix).good())
+        if (std::rename((tmp_file + suffix).c_str(),
+                        (_cache_file + suffix).c_str()) != 0)
+          throw std::runtime_error("Could not write the mesh cache " +
+                                   _cache_file + suffix);
+  }
+  _communicator.barrier();
 }
 
 template <int dim>
@@ -356,7 +556,8 @@ Geometry<dim>::Geometry(
     : _communicator(boost::mpi::communicator(triangulation->get_communicator(),
                                              boost::mpi::comm_duplicate)),
       _anode_boundary_id(type::invalid_boundary_id),
-      _cathode_boundary_id(type::invalid_boundary_id),
+      _cathode_boundary_id(type::invalid_boundary_id), _n_repeated_units(1),
+      _cache_file(""), _loaded_from_cache(false),
       _triangulation(triangulation), _materials(nullptr)
 {
   fill_materials_map(database);
@@ -427,115 +628,110 @@ void Geometry<dim>::set_boundary_ids(double const collector_top,
 }
 
 template <int dim>
-void Geometry<dim>::mesh_generator(boost::property_tree::ptree const &database)
+bool Geometry<dim>::mesh_generator(boost::property_tree::ptree const &database)
 {
-  // Read the data needed for the collectors
-  internal::Component<dim> collector_a(_communicator);
+  // Read the data needed for the collectors. For now, we assume that the two
+  // collectors have the same mesh.
+  internal::Component<dim> collector;
   boost::property_tree::ptree collector_database =
       database.get_child("collector");
-  internal::read_component_database(collector_database, collector_a);
-  internal::Component<dim> collector_c(collector_a.box_dimensions,
-                                       collector_a.repetitions, _communicator);
+  internal::read_component_database(collector_database, collector);
 
   // Read the data needed for the anode
-  internal::Component<dim> anode(_communicator);
+  internal::Component<dim> anode;
   boost::property_tree::ptree anode_database = database.get_child("anode");
   internal::read_component_database(anode_database, anode);
 
   // Read the data needed for the cathode
-  internal::Component<dim> cathode(_communicator);
+  internal::Component<dim> cathode;
   boost::property_tree::ptree cathode_database = database.get_child("cathode");
   internal::read_component_database(cathode_database, cathode);
 
   // Read the data needed for the separator
-  internal::Component<dim> separator(_communicator);
+  internal::Component<dim> separator;
   boost::property_tree::ptree separator_database =
       database.get_child("separator");
   internal::read_component_database(separator_database, separator);
 
-  // For now, we assume that the user does not create hanging nodes with the
-  // repetitions
-  // Create the triangulation for the anode.
-  dealii::GridGenerator::subdivided_hyper_rectangle(
-      anode.triangulation, anode.repetitions, anode.box_dimensions[0],
-      anode.box_dimensions[1]);
-  for (auto cell : anode.triangulation.cell_iterators())
-    cell->set_material_id((*_materials)["anode"][0]);
-  // Create the triangulation for the cathode.
-  dealii::GridGenerator::subdivided_hyper_rectangle(
-      cathode.triangulation, cathode.repetitions, cathode.box_dimensions[0],
-      cathode.box_dimensions[1]);
-  for (auto cell : cathode.triangulation.cell_iterators())
-    cell->set_material_id((*_materials)["cathode"][0]);
-  // Create the triangulation for the seperator.
-  dealii::GridGenerator::subdivided_hyper_rectangle(
-      separator.triangulation, separator.repetitions,
-      separator.box_dimensions[0], separator.box_dimensions[1]);
-  for (auto cell : separator.triangulation.cell_iterators())
-    cell->set_material_id((*_materials)["separator"][0]);
-
-  // Create the triangulation for first collector.
-  double const anode_dim = anode.box_dimensions[1][dim - 1];
-  double const collector_dim = collector_a.box_dimensions[1][dim - 1];
-  double const delta_collector =
-      collector_dim / collector_a.repetitions[dim - 1];
-  dealii::GridGenerator::subdivided_hyper_rectangle(
-      collector_a.triangulation, collector_a.repetitions,
-      collector_a.box_dimensions[0], collector_a.box_dimensions[1]);
-  for (auto cell : collector_a.triangulation.cell_iterators())
-    cell->set_material_id((*_materials)["collector_anode"][0]);
-  double const scale_factor_a = anode_dim / (collector_dim - delta_collector);
-  std::function<dealii::Point<dim>(dealii::Point<dim> const &)> transform_a =
-      std::bind(&internal::transform_coll_a<dim>, std::placeholders::_1,
-                scale_factor_a, collector_a.box_dimensions[1][dim - 1]);
-  dealii::GridTools::transform(transform_a, collector_a.triangulation);
-
-  // Create the triangulation for the second collector. For now, we assume that
-  // collector_a and collector_c have the same mesh.
-  dealii::GridGenerator::subdivided_hyper_rectangle(
-      collector_c.triangulation, collector_c.repetitions,
-      collector_c.box_dimensions[0], collector_c.box_dimensions[1]);
-  for (auto cell : collector_c.triangulation.cell_iterators())
-    cell->set_material_id((*_materials)["collector_cathode"][0]);
-  double const scale_factor_c = anode_dim / (collector_dim - delta_collector);
-  std::function<dealii::Point<dim>(dealii::Point<dim> const &)> transform_c =
-      std::bind(&internal::transform_coll_c<dim>, std::placeholders::_1,
-                scale_factor_c, collector_c.box_dimensions[1][dim - 1],
-                collector_dim - anode_dim - scale_factor_c * delta_collector);
-  dealii::GridTools::transform(transform_c, collector_c.triangulation);
-  collector_c.shift_vector[dim - 1] = -(collector_dim - anode_dim);
-
-  std::array<internal::Component<dim> *, 8> components = {
-      &anode,   &separator, &cathode, &collector_c,
-      &cathode, &separator, &anode,   &collector_a};
-  _triangulation->clear();
-  _triangulation->copy_triangulation(collector_a.triangulation);
-  double offset = collector_a.box_dimensions[1][0];
-  unsigned int pos = 0;
+  // Refine the components in the through-thickness direction only. This is
+  // done on the coarse mesh because distributed::Triangulation only supports
+  // isotropic refinement.
+  unsigned int const thickness_refinements =
+      database.get<unsigned int>("thickness_refinements", 0);
+  for (internal::Component<dim> *component :
+       {&collector, &anode, &cathode, &separator})
+    component->repetitions[0] <<= thickness_refinements;
+  internal::check_divisions(collector, anode, separator, cathode);
+
+  // The stack starts with an anode collector followed by the repeated unit.
+  // Two consecutive units are mirror images of each other and they share a
+  // collector.
+  dealii::types::material_id const anode_id = (*_materials)["anode"][0];
+  dealii::types::material_id const separator_id = (*_materials)["separator"][0];
+  dealii::types::material_id const cathode_id = (*_materials)["cathode"][0];
+  dealii::types::material_id const collector_a_id =
+      (*_materials)["collector_anode"][0];
+  dealii::types::material_id const collector_c_id =
+      (*_materials)["collector_cathode"][0];
+  std::array<internal::Layer<dim>, 8> const unit = {
+      {{&anode, anode_id, internal::no_tab},
+       {&separator, separator_id, internal::no_tab},
+       {&cathode, cathode_id, internal::no_tab},
+       {&collector, collector_c_id, internal::bottom_tab},
+       {&cathode, cathode_id, internal::no_tab},
+       {&separator, separator_id, internal::no_tab},
+       {&anode, anode_id, internal::no_tab},
+       {&collector, collector_a_id, internal::top_tab}}};
   unsigned int const n_repetitions =
       database.get<unsigned int>("n_repetitions", 1);
-  for (unsigned int i = 0; i <= n_repetitions; ++i)
+  std::vector<internal::Layer<dim>> layers(
+      1, internal::Layer<dim>{&collector, collector_a_id, internal::top_tab});
+  for (unsigned int i = 0; i < 4 * (n_repetitions + 1); ++i)
+    layers.push_back(unit[i % 8]);
+  // When a single unit represents the stack, its cathode collector is shared
+  // with the next unit and only the half up to the midplane is meshed. This
+  // is exact for a stack of two units, whose anode collectors are the outer
+  // ones. The cells are then the ones of the stack if the collectors are not
+  // graded and have an even number of divisions in the through-thickness
+  // direction. With more units, the anode collectors of the inner units are
+  // also shared but they are meshed with their whole thickness, so the ohmic
+  // drop in these collectors is underestimated.
+  internal::Component<dim> half_collector = collector;
+  if (_n_repeated_units > 1)
   {
-    for (unsigned int j = 0; j < 4; ++j)
-    {
-      internal::merge_components(*components[pos], offset, _triangulation);
-      offset += components[pos]->box_dimensions[1][0];
-      ++pos;
-      pos = pos % 8;
-    }
+    half_collector.box_dimensions[1][0] *= 0.5;
+    half_collector.repetitions[0] = (collector.repetitions[0] + 1) / 2;
+    layers.back().component = &half_collector;
   }
 
-  // Apply global refinement
-  unsigned int const n_refinements =
-      database.get<unsigned int>("n_refinements", 0);
-  _triangulation->refine_global(n_refinements);
+  double const anode_dim = anode.box_dimensions[1][dim - 1];
+  double const collector_dim = collector.box_dimensions[1][dim - 1];
+  _triangulation->clear();
+  internal::create_stack(layers, anode, collector_dim - anode_dim,
+                         *_triangulation);
+
+  // Apply global refinement or load the refined and partitioned mesh from
+  // the cache. The coarse mesh needs to be created in both cases.
+  bool cached = false;
+  if ((!_cache_file.empty()) && (_communicator.rank() == 0))
+    cached = std::ifstream(_cache_file).good();
+  boost::mpi::broadcast(_communicator, cached, 0);
+  if (cached)
+    _triangulation->load(_cache_file);
+  else
+  {
+    unsigned int const n_refinements =
+        database.get<unsigned int>("n_refinements", 0);
+    _triangulation->refine_global(n_refinements);
+  }
 
-  // Apply boundary conditions. This needs to be done after the merging because
-  // the merging loses the boundary id
+  // Apply boundary conditions on the top of the anode tabs and on the bottom
+  // of the cathode tabs.
   _anode_boundary_id = 1;
   _cathode_boundary_id = 2;
-  set_boundary_ids(collector_a.box_dimensions[1][dim - 1],
-                   -(collector_dim - anode_dim));
+  set_boundary_ids(collector_dim, -(collector_dim - anode_dim));
+
+  return cached;
 }
 
 } // end namespace cap
@@ -0,0 +1,251 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <cap/linear_solvers.h>
+#include <Epetra_CrsMatrix.h>
+#include <Epetra_MpiComm.h>
+#include <Epetra_MultiVector.h>
+#include <Epetra_Operator.h>
+#include <Epetra_Vector.h>
+#include <mpi.h>
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace cap
+{
+BatchedCG::BatchedCG(unsigned int const max_iter)
+    : _max_iter(max_iter), _last_step(0), _last_values()
+{
+}
+
+void BatchedCG::solve(dealii::Trilinos::SparseMatrix const &matrix,
+                      std::vector<dealii::Trilinos::MPI::Vector> &x,
+                      std::vector<dealii::Trilinos::MPI::Vector> const &b,
+                      dealii::Trilinos::PreconditionBase const &preconditioner,
+                      std::vector<double> const &tolerances)
+{
+  unsigned int const n_vectors = x.size();
+  BOOST_ASSERT_MSG(b.size() == n_vectors,
+                   "The number of solutions and right-hand sides differ.");
+  BOOST_ASSERT_MSG(tolerances.size() == n_vectors,
+                   "The number of tolerances and right-hand sides differ.");
+  _last_step = 0;
+  _last_values.assign(n_vectors, 0.);
+  if (n_vectors == 0)
+    return;
+
+  Epetra_CrsMatrix const &A = matrix.trilinos_matrix();
+  Epetra_Operator &M = preconditioner.trilinos_operator();
+  Epetra_BlockMap const &map = x[0].trilinos_vector().Map();
+  int const n_local = x[0].trilinos_vector().MyLength();
+
+  // Copy the solutions and the right-hand sides in multivectors. Each column
+  // is one of the systems.
+  Epetra_MultiVector X(map, n_vectors);
+  Epetra_MultiVector R(map, n_vectors);
+  for (unsigned int i = 0; i < n_vectors; ++i)
+  {
+    std::copy(x[i].trilinos_vector()[0], x[i].trilinos_vector()[0] + n_local,
+              X[i]);
+    std::copy(b[i].trilinos_vector()[0], b[i].trilinos_vector()[0] + n_local,
+              R[i]);
+  }
+  Epetra_MultiVector Z(map, n_vectors);
+  Epetra_MultiVector S(map, n_vectors);
+  Epetra_MultiVector P(map, n_vectors);
+  Epetra_MultiVector Q(map, n_vectors);
+  MPI_Comm const comm = dynamic_cast<Epetra_MpiComm const &>(map.Comm()).Comm();
+
+  // r = b - A x
+  A.Multiply(false, X, Q);
+  R.Update(-1., Q, 1.);
+
+  // The iteration is the one of Chronopoulos and Gear, as in PipelinedCG
+  // without the overlap: s = A z and q = A p is updated by recurrence, so the
+  // dot products (r, z), (z, s), and (r, r) of all the systems are available
+  // at the same time and are reduced with a single MPI call per iteration.
+  std::vector<bool> active(n_vectors, true);
+  std::vector<double> residual_norms(n_vectors);
+  std::vector<double> gamma_old(n_vectors, 0.);
+  std::vector<double> alpha(n_vectors, 0.);
+  std::vector<double> local_dots(3 * n_vectors);
+  std::vector<double> dots(3 * n_vectors);
+  while (true)
+  {
+    // The matrix and the preconditioner are applied to all the vectors,
+    // including the ones of the systems that have already converged. This
+    // keeps the multivector contiguous and the cost is marginal since the
+    // matrix entries are loaded only once.
+    M.ApplyInverse(R, Z);
+    A.Multiply(false, Z, S);
+
+    std::fill(local_dots.begin(), local_dots.end(), 0.);
+    for (unsigned int i = 0; i < n_vectors; ++i)
+      for (int k = 0; k < n_local; ++k)
+      {
+        local_dots[3 * i] += R[i][k] * Z[i][k];
+        local_dots[3 * i + 1] += Z[i][k] * S[i][k];
+        local_dots[3 * i + 2] += R[i][k] * R[i][k];
+      }
+    MPI_Allreduce(local_dots.data(), dots.data(), 3 * n_vectors, MPI_DOUBLE,
+                  MPI_SUM, comm);
+
+    unsigned int n_active = 0;
+    for (unsigned int i = 0; i < n_vectors; ++i)
+      if (active[i])
+      {
+        residual_norms[i] = std::sqrt(dots[3 * i + 2]);
+        active[i] = residual_norms[i] > tolerances[i];
+        if (active[i])
+          ++n_active;
+      }
+    if (n_active == 0)
+      break;
+    if (_last_step == _max_iter)
+      throw std::runtime_error("BatchedCG failed to converge within " +
+                               std::to_string(_max_iter) + " iterations");
+
+    for (unsigned int i = 0; i < n_vectors; ++i)
+      if (active[i])
+      {
+        double const gamma = dots[3 * i];
+        double const delta = dots[3 * i + 1];
+        double beta = 0.;
+        if (_last_step > 0)
+        {
+          beta = gamma / gamma_old[i];
+          alpha[i] = gamma / (delta - beta * gamma / alpha[i]);
+        }
+        else
+          alpha[i] = gamma / delta;
+        gamma_old[i] = gamma;
+
+        P(i)->Update(1., *Z(i), beta);
+        Q(i)->Update(1., *S(i), beta);
+        X(i)->Update(alpha[i], *P(i), 1.);
+        R(i)->Update(-alpha[i], *Q(i), 1.);
+      }
+    ++_last_step;
+  }
+
+  // Copy back the solutions.
+  for (unsigned int i = 0; i < n_vectors; ++i)
+    std::copy(X[i], X[i] + n_local, x[i].trilinos_vector()[0]);
+  _last_values = residual_norms;
+}
+
+unsigned int BatchedCG::last_step() const { return _last_step; }
+
+std::vector<double> const &BatchedCG::last_values() const
+{
+  return _last_values;
+}
+
+PipelinedCG::PipelinedCG(unsigned int const max_iter)
+    : _max_iter(max_iter), _last_step(0), _initial_value(0.), _last_value(0.)
+{
+}
+
+void PipelinedCG::solve(
+    dealii::Trilinos::SparseMatrix const &matrix,
+    dealii::Trilinos::MPI::Vector &x, dealii::Trilinos::MPI::Vector const &b,
+    dealii::Trilinos::PreconditionBase const &preconditioner,
+    double const tolerance)
+{
+  _last_step = 0;
+  _initial_value = 0.;
+  _last_value = 0.;
+
+  Epetra_CrsMatrix const &A = matrix.trilinos_matrix();
+  Epetra_Operator &M = preconditioner.trilinos_operator();
+  Epetra_MultiVector &X = x.trilinos_vector();
+  Epetra_BlockMap const &map = X.Map();
+  MPI_Comm const comm = dynamic_cast<Epetra_MpiComm const &>(map.Comm()).Comm();
+  int const n_local = X.MyLength();
+
+  Epetra_Vector r(map);
+  Epetra_Vector u(map);
+  Epetra_Vector w(map);
+  Epetra_Vector m(map);
+  Epetra_Vector n(map);
+  Epetra_Vector z(map);
+  Epetra_Vector q(map);
+  Epetra_Vector s(map);
+  Epetra_Vector p(map);
+
+  // r = b - A x, u = M^{-1} r, w = A u
+  A.Multiply(false, X, r);
+  r.Update(1., b.trilinos_vector(), -1.);
+  M.ApplyInverse(r, u);
+  A.Multiply(false, u, w);
+
+  double gamma_old = 0.;
+  double alpha = 0.;
+  // The reductions are (r, u), (w, u), and (r, r).
+  std::array<double, 3> local_dots;
+  std::array<double, 3> dots;
+  while (true)
+  {
+    local_dots.fill(0.);
+    for (int i = 0; i < n_local; ++i)
+    {
+      local_dots[0] += r[i] * u[i];
+      local_dots[1] += w[i] * u[i];
+      local_dots[2] += r[i] * r[i];
+    }
+    MPI_Request request;
+    MPI_Iallreduce(local_dots.data(), dots.data(), 3, MPI_DOUBLE, MPI_SUM,
+                   comm, &request);
+
+    // m = M^{-1} w and n = A m are computed while the reduction progresses.
+    M.ApplyInverse(w, m);
+    A.Multiply(false, m, n);
+
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    double const gamma = dots[0];
+    double const delta = dots[1];
+    _last_value = std::sqrt(dots[2]);
+    if (_last_step == 0)
+      _initial_value = _last_value;
+    if (_last_value <= tolerance)
+      break;
+    if (_last_step == _max_iter)
+      throw std::runtime_error("PipelinedCG failed to converge within " +
+                               std::to_string(_max_iter) + " iterations");
+
+    double beta = 0.;
+    if (_last_step > 0)
+    {
+      beta = gamma / gamma_old;
+      alpha = gamma / (delta - beta * gamma / alpha);
+    }
+    else
+      alpha = gamma / delta;
+    gamma_old = gamma;
+    ++_last_step;
+
+    z.Update(1., n, beta);
+    q.Update(1., m, beta);
+    s.Update(1., w, beta);
+    p.Update(1., u, beta);
+    X.Update(alpha, p, 1.);
+    r.Update(-alpha, s, 1.);
+    u.Update(-alpha, q, 1.);
+    w.Update(-alpha, z, 1.);
+  }
+}
+
+unsigned int PipelinedCG::last_step() const { return _last_step; }
+
+double PipelinedCG::initial_value() const { return _initial_value; }
+
+double PipelinedCG::last_value() const { return _last_value; }
+}
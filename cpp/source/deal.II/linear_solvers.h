@@ -0,0 +1,123 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_DEAL_II_LINEAR_SOLVERS_H
+#define CAP_DEAL_II_LINEAR_SOLVERS_H
+
+#include <cap/types.h>
+#include <deal.II/lac/trilinos_precondition.h>
+#include <deal.II/lac/trilinos_sparse_matrix.h>
+#include <deal.II/lac/trilinos_vector.h>
+#include <vector>
+
+namespace cap
+{
+/**
+ * Preconditioned conjugate gradient for several right-hand sides sharing the
+ * same matrix. The systems are advanced together: the matrix and the
+ * preconditioner are applied to all the vectors at once through an
+ * Epetra_MultiVector, so that the entries of the matrix are streamed from
+ * memory once per iteration instead of once per right-hand side. The
+ * iteration is rearranged as in PipelinedCG so that all the dot products of
+ * all the systems are reduced with a single MPI call per iteration. Each
+ * system keeps its own step lengths and stops being updated once it has
+ * reached its own tolerance.
+ */
+class BatchedCG
+{
+public:
+  /**
+   * Constructor. @p max_iter is the maximum number of iterations.
+   */
+  BatchedCG(unsigned int const max_iter);
+
+  /**
+   * Solve @p matrix @p x[i] = @p b[i] for all i. On input, @p x contains the
+   * initial guesses. The system i is converged when the l2 norm of its
+   * residual is less than @p tolerances[i]. Throw an exception if one of the
+   * systems does not converge within the maximum number of iterations.
+   */
+  void solve(dealii::Trilinos::SparseMatrix const &matrix,
+             std::vector<dealii::Trilinos::MPI::Vector> &x,
+             std::vector<dealii::Trilinos::MPI::Vector> const &b,
+             dealii::Trilinos::PreconditionBase const &preconditioner,
+             std::vector<double> const &tolerances);
+
+  /**
+   * Return the number of iterations performed during the last call to
+   * solve().
+   */
+  unsigned int last_step() const;
+
+  /**
+   * Return the l2 norms of the residuals at the end of the last call to
+   * solve().
+   */
+  std::vector<double> const &last_values() const;
+
+private:
+  unsigned int _max_iter;
+  unsigned int _last_step;
+  std::vector<double> _last_values;
+};
+
+/**
+ * Pipelined preconditioned conjugate gradient (Ghysels and Vanroose, 2014).
+ * The recurrences are rearranged so that the dot products of an iteration
+ * are reduced with a single non-blocking MPI_Iallreduce which is overlapped
+ * with the application of the preconditioner and of the matrix. Compared to
+ * the standard CG, there is one global synchronization per iteration instead
+ * of two and its latency is hidden behind local work, at the cost of more
+ * vector updates. This pays off when the number of processors is large.
+ */
+class PipelinedCG
+{
+public:
+  /**
+   * Constructor. @p max_iter is the maximum number of iterations.
+   */
+  PipelinedCG(unsigned int const max_iter);
+
+  /**
+   * Solve @p matrix @p x = @p b. On input, @p x contains the initial guess.
+   * The solver has converged when the l2 norm of the residual is less than
+   * @p tolerance. Throw an exception if the solver does not converge within
+   * the maximum number of iterations.
+   */
+  void solve(dealii::Trilinos::SparseMatrix const &matrix,
+             dealii::Trilinos::MPI::Vector &x,
+             dealii::Trilinos::MPI::Vector const &b,
+             dealii::Trilinos::PreconditionBase const &preconditioner,
+             double const tolerance);
+
+  /**
+   * Return the number of iterations performed during the last call to
+   * solve().
+   */
+  unsigned int last_step() const;
+
+  /**
+   * Return the l2 norm of the residual at the beginning of the last call to
+   * solve().
+   */
+  double initial_value() const;
+
+  /**
+   * Return the l2 norm of the residual at the end of the last call to
+   * solve().
+   */
+  double last_value() const;
+
+private:
+  unsigned int _max_iter;
+  unsigned int _last_step;
+  double _initial_value;
+  double _last_value;
+};
+}
+
+#endif
@@ -10,6 +10,8 @@
 #include <deal.II/lac/trilinos_sparse_matrix.h>
 #include <deal.II/lac/trilinos_sparsity_pattern.h>
 #include <deal.II/lac/trilinos_vector.h>
+#include <map>
+#include <string>
 
 namespace cap
 {
@@ -75,6 +77,12 @@ public:
     return this->system_rhs;
   }
 
+  /**
+   * Return the memory consumption in bytes of the constraints, the sparsity
+   * pattern, the matrices, and the right-hand side on this processor.
+   */
+  std::map<std::string, std::size_t> get_memory_consumption() const;
+
 protected:
   boost::mpi::communicator mpi_communicator;
   unsigned int verbose_lvl;
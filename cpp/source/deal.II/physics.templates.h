@@ -26,6 +26,18 @@ Physics<dim>::Physics(std::shared_ptr<PhysicsParameters<dim> const> parameters,
       mp_values(parameters->mp_values)
 {
 }
+
+template <int dim>
+std::map<std::string, std::size_t> Physics<dim>::get_memory_consumption() const
+{
+  std::map<std::string, std::size_t> memory;
+  memory["constraints"] = constraint_matrix.memory_consumption();
+  memory["sparsity_pattern"] = sparsity_pattern.memory_consumption();
+  memory["system_matrix"] = system_matrix.memory_consumption();
+  memory["mass_matrix"] = mass_matrix.memory_consumption();
+  memory["system_rhs"] = system_rhs.memory_consumption();
+  return memory;
+}
 }
 
 #endif
@@ -57,6 +57,11 @@ public:
   void get(std::string const &key, double &value) const;
   std::vector<std::string> get_vector_keys() const;
 
+  /**
+   * Return the memory consumption in bytes of the vectors on this processor.
+   */
+  std::size_t memory_consumption() const;
+
 protected:
   boost::mpi::communicator _communicator;
   std::shared_ptr<dealii::DoFHandler<dim> const> dof_handler;
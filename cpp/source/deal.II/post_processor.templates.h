@@ -6,6 +6,7 @@
  */
 
 #include <cap/post_processor.h>
+#include <cap/trace.h>
 #include <cap/utils.h>
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/dofs/dof_tools.h>
@@ -65,6 +66,15 @@ std::vector<std::string> Postprocessor<dim>::get_vector_keys() const
   return keys;
 }
 
+template <int dim>
+std::size_t Postprocessor<dim>::memory_consumption() const
+{
+  std::size_t memory = 0;
+  for (auto const &vector : this->vectors)
+    memory += vector.second.memory_consumption();
+  return memory;
+}
+
 //////////////////////// SUPERCAPACITOR POSTPROCESSOR PARAMETERS //////
 template <int dim>
 SuperCapacitorPostprocessorParameters<dim>::
@@ -139,6 +149,7 @@ template <int dim>
 void SuperCapacitorPostprocessor<dim>::reset(
     std::shared_ptr<PostprocessorParameters<dim> const> parameters)
 {
+  CAP_TRACE_SCOPE("SuperCapacitorPostprocessor::reset");
   dealii::DoFHandler<dim> const &dof_handler = *(this->dof_handler);
   dealii::Trilinos::MPI::BlockVector const &solution = *(this->solution);
 
@@ -200,6 +211,10 @@ void SuperCapacitorPostprocessor<dim>::reset(
   double cathode_electrode_potential = 0.0;
   double anode_electrode_volume = 0.0;
   double cathode_electrode_volume = 0.0;
+  double collector_volume = 0.0;
+  double collector_mass = 0.0;
+  std::vector<dealii::types::material_id> const &collector_material_ids =
+      (*materials)["collector"];
 
   std::vector<double> face_solid_electrical_conductivity_values(
       n_face_q_points);
@@ -260,6 +275,13 @@ void SuperCapacitorPostprocessor<dim>::reset(
         this->values["volume"] += fe_values.JxW(q_point);
         this->values["mass"] +=
             density_values[q_point] * fe_values.JxW(q_point);
+        if (std::find(collector_material_ids.begin(),
+                      collector_material_ids.end(),
+                      cell->material_id()) != collector_material_ids.end())
+        {
+          collector_volume += fe_values.JxW(q_point);
+          collector_mass += density_values[q_point] * fe_values.JxW(q_point);
+        }
         if (cell->material_id() == anode_electrode_material_id)
         {
           anode_electrode_potential += (solid_potential_values[q_point] -
@@ -441,6 +463,14 @@ void SuperCapacitorPostprocessor<dim>::reset(
       this->values["surface_area"], this->_communicator);
   this->values["voltage"] =
       dealii::Utilities::MPI::sum(this->values["voltage"], this->_communicator);
+  this->values["volume"] =
+      dealii::Utilities::MPI::sum(this->values["volume"], this->_communicator);
+  this->values["mass"] =
+      dealii::Utilities::MPI::sum(this->values["mass"], this->_communicator);
+  collector_volume =
+      dealii::Utilities::MPI::sum(collector_volume, this->_communicator);
+  collector_mass =
+      dealii::Utilities::MPI::sum(collector_mass, this->_communicator);
   anode_electrode_potential = dealii::Utilities::MPI::sum(
       anode_electrode_potential, this->_communicator);
   anode_electrode_volume =
@@ -455,6 +485,28 @@ void SuperCapacitorPostprocessor<dim>::reset(
   cathode_electrode_potential /= cathode_electrode_volume;
   this->values["anode_potential"] = anode_electrode_potential;
   this->values["cathode_potential"] = cathode_electrode_potential;
+
+  // When a single unit of the stack is meshed, scale the extensive quantities
+  // to the whole stack. The units are connected in parallel so the voltage is
+  // unchanged. Two neighboring units share a collector, so the stack has one
+  // collector more than units while the meshed unit has one collector and a
+  // half. The two collectors have the same thickness.
+  unsigned int const n_units = _geometry->get_n_repeated_units();
+  if (n_units > 1)
+  {
+    for (std::string const key :
+         {"current", "joule_heating",
+          "anode_electrode_interfacial_surface_area",
+          "anode_electrode_mass_of_active_material",
+          "cathode_electrode_interfacial_surface_area",
+          "cathode_electrode_mass_of_active_material"})
+      this->values[key] *= n_units;
+    this->values["volume"] =
+        n_units * (this->values["volume"] - collector_volume) +
+        (n_units + 1) * collector_volume / 1.5;
+    this->values["mass"] = n_units * (this->values["mass"] - collector_mass) +
+                           (n_units + 1) * collector_mass / 1.5;
+  }
 }
 
 } // end namespace cap
@@ -6,6 +6,7 @@
  */
 
 #include <cap/supercapacitor.templates.h>
+#include <cap/supercapacitor_1d.h>
 
 namespace cap
 {
@@ -23,7 +24,9 @@ public:
         boost::mpi::communicator const &comm) override
   {
     int const dim = ptree.get<int>("dim");
-    if (dim == 2)
+    if (dim == 1)
+      return std::make_unique<SuperCapacitor1D>(ptree, comm);
+    else if (dim == 2)
       return std::make_unique<SuperCapacitor<2>>(
           SuperCapacitor<2>(ptree, comm));
     else if (dim == 3)
@@ -31,7 +34,7 @@ public:
           SuperCapacitor<3>(ptree, comm));
     else
       throw std::runtime_error("dim=" + std::to_string(dim) +
-                               " must be 2 or 3");
+                               " must be 1, 2, or 3");
   }
 } global_SuperCapacitorBuilder;
 
@@ -11,12 +11,20 @@
 #include <cap/energy_storage_device.h>
 #include <cap/geometry.h>
 #include <cap/electrochemical_physics.h>
+#include <cap/electrochemical_operator.h>
 #include <cap/post_processor.h>
-#include <cap/timer.h>
+#include <cap/solver_statistics.h>
+#include <cap/timer_registry.h>
 #include <deal.II/fe/fe_system.h>
 #include <deal.II/lac/block_vector.h>
+#include <deal.II/lac/precondition.h>
+#include <deal.II/lac/trilinos_precondition.h>
+#include <boost/circular_buffer.hpp>
+#include <map>
 #include <memory>
 #include <iostream>
+#include <string>
+#include <vector>
 
 namespace cap
 {
@@ -41,8 +49,6 @@ public:
   SuperCapacitor(boost::property_tree::ptree const &ptree,
                  boost::mpi::communicator const &comm);
 
-  ~SuperCapacitor();
-
   void inspect(EnergyStorageDeviceInspector *inspector) override;
 
   void get_voltage(double &voltage) const override;
@@ -85,6 +91,86 @@ public:
   void evolve_one_time_step_linear_load(double const time_step,
                                         double const load) override;
 
+  /**
+   * Advance each state of @p states by @p time_step seconds. The current is
+   * constant during the time step and its value for the state i is
+   * @p currents[i] amperes. The states share the geometry, the material
+   * properties, and the time step so the system is assembled once and all the
+   * right-hand sides are solved together using a batched conjugate gradient.
+   * On output, @p voltages[i] is the voltage of the state i. The state of the
+   * device itself is not modified.
+   */
+  void evolve_one_time_step_constant_current(
+      double const time_step, std::vector<double> const &currents,
+      std::vector<dealii::Trilinos::MPI::Vector> &states,
+      std::vector<double> &voltages);
+
+  /**
+   * Adapt the mesh to the current solution. The error is estimated on both
+   * potentials with the Kelly error estimator, the cells are flagged for
+   * refinement and coarsening using fixed fractions, and the solution is
+   * transferred to the new mesh. The physics and the post-processor are
+   * rebuilt. The states returned by get_state() before the call cannot be used
+   * anymore.
+   */
+  void refine_mesh();
+
+  /**
+   * Repartition the mesh using the cost of the cells measured during the
+   * first @p calibration_steps time steps. The cost of a cell is the time
+   * spent assembling it plus its share, proportional to the number of entries
+   * it adds to the system matrix, of the matrix-vector products of the Krylov
+   * solver. The extra weight of the cells of each material is set to
+   * 1000 times the ratio between their cost and the cost of the cheapest
+   * cells, minus 1000. The solution is transferred to the new partition and the
+   * physics and the post-processor are rebuilt.
+   */
+  void rebalance_mesh();
+
+  /**
+   * Return a copy of the current state of the device. This can be used to
+   * initialize the states advanced by the batched evolve function.
+   */
+  dealii::Trilinos::MPI::Vector get_state() const;
+
+  /**
+   * Return the statistics of the last solves, from the oldest to the most
+   * recent. The number of solves kept is given by solver.statistics_capacity
+   * (default 1000). The batched evolve function does not record statistics.
+   */
+  boost::circular_buffer<SolverStatistics> const &
+  get_solver_statistics() const;
+
+  /**
+   * Return the memory consumption in bytes of the components of the device
+   * on this processor: triangulation, dof_handler, constraints,
+   * sparsity_pattern, system_matrix, mass_matrix, preconditioner, solution,
+   * system_rhs, and postprocessor. The preconditioner is the inverse of the
+   * diagonal used by the Chebyshev smoothers and the Trilinos wrapper of the
+   * AMG preconditioners; the hierarchy built by ML is not reported by
+   * Trilinos. The system is built
+   * during the first time step, so the memory of the matrices and of the
+   * preconditioner is zero before. The batched evolve function adds its own
+   * system and preconditioner.
+   */
+  std::map<std::string, std::size_t> get_memory_consumption() const;
+
+  /**
+   * Estimate the memory consumption in bytes of the components of a device
+   * built from @p ptree on this processor, without building the device. The
+   * mesh is built and the degrees of freedom are distributed, so the
+   * triangulation, the dof_handler, and the constraints are measured. The
+   * other components are extrapolated from the number of locally owned
+   * degrees of freedom assuming that every active degree of freedom is
+   * coupled to both potentials of all the neighboring cells. The
+   * preconditioner is estimated as it is measured by
+   * get_memory_consumption(). The cache of the mesh is not used. This
+   * function is collective.
+   */
+  static std::map<std::string, std::size_t>
+  estimate_memory_consumption(boost::property_tree::ptree const &ptree,
+                              boost::mpi::communicator const &comm);
+
   /**
    * Return the underlying Geometry.
    */
@@ -108,6 +194,31 @@ public:
   boost::property_tree::ptree const *get_property_tree() const;
 
 private:
+  /**
+   * Call refine_mesh() every @p refinement_interval time steps. This is called
+   * at the beginning of the evolve_one_time_step_* functions.
+   */
+  void adapt_mesh_if_needed();
+
+  /**
+   * Execute the refinement and the coarsening of the cells that are flagged,
+   * repartition the mesh, transfer @p relevant_solution to the new mesh, and
+   * rebuild the physics and the post-processor.
+   */
+  void execute_mesh_change(
+      dealii::Trilinos::MPI::Vector const &relevant_solution);
+
+  /**
+   * Accumulate in @p material_cost the cost of the materials during a time
+   * step. The assembly time is added if the system has been @p assembled and
+   * the time of @p n_iterations matrix-vector products is shared between the
+   * materials. The time of a matrix-vector product is measured by doing one
+   * extra product with the system matrix, so each calibration step costs one
+   * more product than a regular time step.
+   */
+  void record_material_cost(bool const assembled,
+                            unsigned int const n_iterations);
+
   /**
    * Helper function to advance time by @p time_step second.
    */
@@ -127,6 +238,40 @@ private:
    */
   void output_eigenvalues(std::vector<double> const &eigenvalues);
 
+  /**
+   * Solve @p system_matrix @p x = @p rhs using iterative refinement: the
+   * residual is computed in double precision with the Trilinos matrix while
+   * the corrections are computed in single precision, using the matrix-free
+   * operator and vectors stored as float and a Chebyshev preconditioner. The
+   * residual is scaled to unit norm before it is rounded to single
+   * precision. This function returns the total number of inner iterations.
+   * The residuals of the outer loop and whether the single-precision
+   * operator was rebuilt are stored in @p statistics.
+   */
+  unsigned int solve_with_iterative_refinement(
+      dealii::Trilinos::SparseMatrix const &system_matrix,
+      dealii::Trilinos::MPI::Vector &x,
+      dealii::Trilinos::MPI::Vector const &rhs, double const tolerance,
+      SolverStatistics &statistics);
+
+  /**
+   * Solve the system of the current time step with the matrix-free operator.
+   * The Dirichlet boundary conditions are lifted and the correction is
+   * computed using a conjugate gradient preconditioned by a Chebyshev
+   * polynomial of the Jacobi-preconditioned operator. The iterations, the
+   * residuals, and whether the preconditioner was rebuilt are stored in
+   * @p statistics.
+   */
+  void solve_matrix_free(SolverStatistics &statistics);
+
+  /**
+   * Build the vector used to compute the voltage of the states advanced by
+   * the batched evolve function. The voltage is the average of the solid
+   * potential on the cathode boundary, which is a linear functional of the
+   * state.
+   */
+  void build_voltage_functional();
+
   /**
    * Maximum number of iterations of the Krylov solver in
    * evolve_one_time_step().
@@ -150,7 +295,73 @@ private:
    */
   double rel_tolerance;
   /**
-   * Area of the cathode.
+   * Krylov solver used in evolve_one_time_step(): "cg" or "pipelined_cg".
+   */
+  std::string solver_type;
+  /**
+   * Representation of the operator in evolve_one_time_step(): "matrix_based"
+   * uses the Trilinos matrices built by ElectrochemicalPhysics while
+   * "matrix_free" uses ElectrochemicalOperator.
+   */
+  std::string backend;
+  /**
+   * Degree and smoothing range of the Chebyshev preconditioner used by the
+   * matrix-free backend.
+   */
+  unsigned int chebyshev_degree;
+  double smoothing_range;
+  /**
+   * If true, the linear systems in evolve_one_time_step() are solved with
+   * solve_with_iterative_refinement().
+   */
+  bool mixed_precision;
+  /**
+   * Relative tolerance of the single-precision inner solves of the iterative
+   * refinement.
+   */
+  double inner_rel_tolerance;
+  /**
+   * Maximum number of outer iterations of the iterative refinement.
+   */
+  unsigned int max_refinement_steps;
+  /**
+   * Number of time steps between two adaptations of the mesh. If zero, the
+   * mesh is never adapted automatically.
+   */
+  unsigned int refinement_interval;
+  /**
+   * Fractions of the estimated error used to flag the cells for refinement
+   * and for coarsening in refine_mesh().
+   */
+  double refine_fraction;
+  double coarsen_fraction;
+  /**
+   * Cells are not refined beyond @p max_refinement_level and not coarsened
+   * below @p min_refinement_level.
+   */
+  unsigned int max_refinement_level;
+  unsigned int min_refinement_level;
+  /**
+   * Number of time steps since the construction of the device.
+   */
+  unsigned int n_time_steps;
+  /**
+   * Number of time steps during which the cost of the materials is measured
+   * before rebalance_mesh() is called. If zero, the weights of the geometry
+   * database are used.
+   */
+  unsigned int calibration_steps;
+  /**
+   * Cost in seconds of the locally owned cells of each material, indexed by
+   * the material id.
+   */
+  std::vector<double> material_cost;
+  /**
+   * Statistics of the last solves.
+   */
+  boost::circular_buffer<SolverStatistics> solver_statistics;
+  /**
+   * Area of the cathode of the whole stack.
    */
   double surface_area;
 
@@ -162,12 +373,35 @@ private:
   std::shared_ptr<ElectrochemicalPhysicsParameters<dim>>
       electrochemical_physics_params;
   std::shared_ptr<ElectrochemicalPhysics<dim>> electrochemical_physics;
+  std::shared_ptr<dealii::Trilinos::PreconditionAMG> preconditioner;
+  std::shared_ptr<ElectrochemicalOperatorBase<dim>> electrochemical_operator;
+  std::shared_ptr<dealii::PreconditionChebyshev<
+      ElectrochemicalOperatorBase<dim>,
+      typename ElectrochemicalOperatorBase<dim>::VectorType>>
+      matrix_free_preconditioner;
+  /**
+   * Single-precision operator and preconditioner used by the inner solves of
+   * solve_with_iterative_refinement().
+   */
+  std::shared_ptr<ElectrochemicalOperatorBase<dim, float>>
+      single_precision_operator;
+  std::shared_ptr<dealii::PreconditionChebyshev<
+      ElectrochemicalOperatorBase<dim, float>,
+      typename ElectrochemicalOperatorBase<dim, float>::VectorType>>
+      single_precision_preconditioner;
+  /**
+   * Physics, preconditioner, and voltage functional used by the batched evolve
+   * function. The physics is built with a unit current density since the
+   * right-hand side is linear in the imposed current.
+   */
+  std::shared_ptr<ElectrochemicalPhysicsParameters<dim>> batch_physics_params;
+  std::shared_ptr<ElectrochemicalPhysics<dim>> batch_physics;
+  std::shared_ptr<dealii::Trilinos::PreconditionAMG> batch_preconditioner;
+  std::shared_ptr<dealii::Trilinos::MPI::Vector> voltage_functional;
   std::shared_ptr<SuperCapacitorPostprocessorParameters<dim>>
       post_processor_params;
   std::shared_ptr<SuperCapacitorPostprocessor<dim>> post_processor;
   boost::property_tree::ptree const _ptree;
-  Timer _setup_timer;
-  Timer _solver_timer;
 
   template <int dimension>
   friend class SuperCapacitorInspector;
@@ -9,12 +9,20 @@
 #define CAP_DEAL_II_SUPERCAPACITOR_TEMPLATES_H
 
 #include <cap/supercapacitor.h>
+#include <cap/dof_renumbering.h>
+#include <cap/linear_solvers.h>
+#include <cap/trace.h>
+#include <cap/utils.h>
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/base/multithread_info.h>
 #include <deal.II/fe/fe_q.h>
 #include <deal.II/dofs/dof_renumbering.h>
 #include <deal.II/dofs/dof_handler.h>
 #include <deal.II/dofs/dof_tools.h>
+#include <deal.II/distributed/grid_refinement.h>
+#include <deal.II/distributed/solution_transfer.h>
+#include <deal.II/lac/constraint_matrix.h>
+#include <deal.II/numerics/error_estimator.h>
 #include <deal.II/numerics/matrix_tools.h>
 #include <deal.II/numerics/data_out.h>
 #include <deal.II/lac/trilinos_precondition.h>
@@ -24,13 +32,19 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/test/floating_point_comparison.hpp>
 #include <tuple>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <limits>
+#include <numeric>
 
 namespace cap
 {
 template <int dim>
 void SuperCapacitorInspector<dim>::inspect(EnergyStorageDevice *device)
 {
+  CAP_TRACE_SCOPE("SuperCapacitorInspector::inspect");
   static int i = 0;
   SuperCapacitor<dim> *supercapacitor =
       dynamic_cast<SuperCapacitor<dim> *>(device);
@@ -55,7 +69,9 @@ void SuperCapacitorInspector<dim>::inspect(EnergyStorageDevice *device)
     BOOST_FOREACH (std::string const &key, keys)
       data_out.add_data_vector(supercapacitor->post_processor->get(key), key);
   }
-  data_out.build_patches();
+  // Subdivide the cells so that the higher order fields are not output as
+  // bilinear fields.
+  data_out.build_patches(supercapacitor->_fe->degree);
   std::string const filename =
       "solution-" + dealii::Utilities::int_to_string(i, 4) + "." +
       dealii::Utilities::int_to_string(local_subdomain_id, 4) + ".vtu";
@@ -83,14 +99,22 @@ template <int dim>
 SuperCapacitor<dim>::SuperCapacitor(boost::property_tree::ptree const &ptree,
                                     boost::mpi::communicator const &comm)
     : EnergyStorageDevice(comm), max_iter(0), verbose_lvl(0), abs_tolerance(0.),
-      rel_tolerance(0.), surface_area(0.), _geometry(nullptr), _fe(nullptr),
-      dof_handler(nullptr), solution(nullptr),
+      rel_tolerance(0.), solver_type(""), backend(""), chebyshev_degree(0),
+      smoothing_range(0.), mixed_precision(false),
+      inner_rel_tolerance(0.), max_refinement_steps(0), refinement_interval(0),
+      refine_fraction(0.), coarsen_fraction(0.), max_refinement_level(0),
+      min_refinement_level(0), n_time_steps(0), calibration_steps(0),
+      material_cost(), solver_statistics(), surface_area(0.),
+      _geometry(nullptr), _fe(nullptr), dof_handler(nullptr), solution(nullptr),
       electrochemical_physics_params(nullptr), electrochemical_physics(nullptr),
-      post_processor_params(nullptr), post_processor(nullptr), _ptree(ptree),
-      _setup_timer(comm, "SuperCapacitor setup"),
-      _solver_timer(comm, "SuperCapacitor solver")
+      preconditioner(nullptr), electrochemical_operator(nullptr),
+      matrix_free_preconditioner(nullptr), single_precision_operator(nullptr),
+      single_precision_preconditioner(nullptr), batch_physics_params(nullptr),
+      batch_physics(nullptr), batch_preconditioner(nullptr),
+      voltage_functional(nullptr), post_processor_params(nullptr),
+      post_processor(nullptr), _ptree(ptree)
 {
-  _setup_timer.start();
+  ScopedTimer setup_timer("setup");
 
   // get database
   boost::property_tree::ptree const &database = ptree;
@@ -102,6 +126,31 @@ SuperCapacitor<dim>::SuperCapacitor(boost::property_tree::ptree const &ptree,
   max_iter = solver_database.get<unsigned int>("max_iter", 1000);
   rel_tolerance = solver_database.get<double>("rel_tolerance", 1e-12);
   abs_tolerance = solver_database.get<double>("abs_tolerance", 1e-12);
+  solver_type = solver_database.get<std::string>("type", "cg");
+  if ((solver_type != "cg") && (solver_type != "pipelined_cg"))
+    throw std::runtime_error("Invalid solver type " + solver_type);
+  // get the parameters of the mixed-precision solve
+  mixed_precision = solver_database.get("mixed_precision", false);
+  inner_rel_tolerance =
+      solver_database.get<double>("inner_rel_tolerance", 1e-4);
+  max_refinement_steps =
+      solver_database.get<unsigned int>("max_refinement_steps", 10);
+  // get the parameters of the matrix-free backend
+  backend = solver_database.get<std::string>("backend", "matrix_based");
+  if ((backend != "matrix_based") && (backend != "matrix_free"))
+    throw std::runtime_error("Invalid backend " + backend);
+  if ((backend == "matrix_free") && (mixed_precision || (solver_type != "cg")))
+    throw std::runtime_error("The matrix-free backend only supports the "
+                             "conjugate gradient in double precision");
+  if (mixed_precision && (solver_type != "cg"))
+    throw std::runtime_error("The mixed-precision solve only supports the "
+                             "conjugate gradient");
+  chebyshev_degree =
+      solver_database.get<unsigned int>("chebyshev_degree", 4);
+  smoothing_range = solver_database.get<double>("smoothing_range", 100.);
+  // get the number of solves whose statistics are kept
+  solver_statistics.set_capacity(
+      solver_database.get<unsigned int>("statistics_capacity", 1000));
   // set the number of threads used by deal.II
   unsigned int n_threads = solver_database.get<unsigned int>("n_threads", 1);
   // if 0, let TBB uses all the available threads. This can also be used if one
@@ -112,25 +161,64 @@ SuperCapacitor<dim>::SuperCapacitor(boost::property_tree::ptree const &ptree,
     dealii::MultithreadInfo::set_thread_limit(n_threads);
 
   // build triangulation
+  ScopedTimer geometry_timer("geometry");
   std::shared_ptr<boost::property_tree::ptree> geometry_database =
       std::make_shared<boost::property_tree::ptree>(
           database.get_child("geometry"));
   _geometry = std::make_shared<cap::Geometry<dim>>(geometry_database,
                                                    this->_communicator);
+  geometry_timer.stop();
   std::shared_ptr<dealii::distributed::Triangulation<dim> const> triangulation =
       _geometry->get_triangulation();
 
-  // distribute degrees of freedom
-  _fe = std::make_shared<dealii::FESystem<dim>>(dealii::FE_Q<dim>(1), 2);
+  // get the parameters of the adaptive mesh refinement. By default, the cells
+  // can be refined twice more than the initial mesh.
+  refinement_interval =
+      database.get<unsigned int>("adaptive_refinement.interval", 0);
+  refine_fraction =
+      database.get<double>("adaptive_refinement.refine_fraction", 0.3);
+  coarsen_fraction =
+      database.get<double>("adaptive_refinement.coarsen_fraction", 0.03);
+  max_refinement_level = database.get<unsigned int>(
+      "adaptive_refinement.max_level", triangulation->n_global_levels() + 1);
+  min_refinement_level =
+      database.get<unsigned int>("adaptive_refinement.min_level", 0);
+  if (refine_fraction + coarsen_fraction > 1.)
+    throw std::runtime_error("The sum of the refine and coarsen fractions "
+                             "cannot be greater than one");
+
+  // get the number of time steps used to measure the cost of the materials
+  // before the mesh is rebalanced.
+  calibration_steps =
+      database.get<unsigned int>("load_balancing.calibration_steps", 0);
+  if ((calibration_steps > 0) && (backend == "matrix_free"))
+    throw std::runtime_error("The calibration of the load balancing requires "
+                             "the matrix-based backend");
+
+  // distribute degrees of freedom. Both potentials use the same continuous
+  // Lagrange element. The matrix-free backend supports degrees one to three.
+  ScopedTimer dofs_timer("dofs");
+  unsigned int const polynomial_degree =
+      solver_database.get<unsigned int>("polynomial_degree", 1);
+  if (polynomial_degree == 0)
+    throw std::runtime_error("The polynomial degree must be positive");
+  if ((backend == "matrix_free") && (polynomial_degree > 3))
+    throw std::runtime_error(
+        "The matrix-free backend does not support degree " +
+        std::to_string(polynomial_degree));
+  _fe = std::make_shared<dealii::FESystem<dim>>(
+      dealii::FE_Q<dim>(polynomial_degree), 2);
   dof_handler = std::make_shared<dealii::DoFHandler<dim>>(*triangulation);
   dof_handler->distribute_dofs(*_fe);
 
-  // Renumber the degrees of freedom component-wise.
-  dealii::DoFRenumbering::component_wise(*dof_handler);
+  // Renumber the degrees of freedom. By default, they are numbered
+  // component-wise.
+  renumber_dofs(*dof_handler, solver_database);
   unsigned int const n_components =
       dealii::DoFTools::n_components(*dof_handler);
   std::vector<dealii::types::global_dof_index> dofs_per_component(n_components);
   dealii::DoFTools::count_dofs_per_component(*dof_handler, dofs_per_component);
+  dofs_timer.stop();
 
   // read material properties
   std::shared_ptr<boost::property_tree::ptree> material_properties_database =
@@ -165,16 +253,20 @@ SuperCapacitor<dim>::SuperCapacitor(boost::property_tree::ptree const &ptree,
            face < dealii::GeometryInfo<dim>::faces_per_cell; ++face)
         if ((cell->face(face)->at_boundary()) &&
             (cell->face(face)->boundary_id() == cathode_boundary_id))
+        {
+          fe_face_values.reinit(cell, face);
           for (unsigned int face_q_point = 0; face_q_point < n_face_q_points;
                ++face_q_point)
-          {
-            fe_face_values.reinit(cell, face);
             surface_area += fe_face_values.JxW(face_q_point);
-          }
+        }
   // Reduce the value computed on each processor.
   surface_area = dealii::Utilities::MPI::sum(surface_area, this->_communicator);
+  // When only one unit of the stack is meshed, the current imposed on the
+  // stack is shared by all the units.
+  surface_area *= _geometry->get_n_repeated_units();
 
   // Create the post-processor parameters
+  ScopedTimer postprocess_timer("postprocess");
   post_processor_params =
       std::make_shared<SuperCapacitorPostprocessorParameters<dim>>(
           std::make_shared<boost::property_tree::ptree>(database), dof_handler);
@@ -192,18 +284,6 @@ SuperCapacitor<dim>::SuperCapacitor(boost::property_tree::ptree const &ptree,
       post_processor_params, _geometry, this->_communicator);
 
   post_processor->reset(post_processor_params);
-
-  _setup_timer.stop();
-}
-
-template <int dim>
-SuperCapacitor<dim>::~SuperCapacitor()
-{
-  if (verbose_lvl > 0)
-  {
-    _setup_timer.print();
-    _solver_timer.print();
-  }
 }
 
 template <int dim>
@@ -228,6 +308,8 @@ template <int dim>
 void SuperCapacitor<dim>::evolve_one_time_step_constant_current(
     double const time_step, double const current)
 {
+  CAP_TRACE_SCOPE("SuperCapacitor::evolve_one_time_step_constant_current");
+  adapt_mesh_if_needed();
   BOOST_ASSERT_MSG(surface_area > 0.,
                    "The surface area should be greater than zero.");
   double const constant_current_density = current / surface_area;
@@ -245,6 +327,8 @@ template <int dim>
 void SuperCapacitor<dim>::evolve_one_time_step_constant_voltage(
     double const time_step, double const voltage)
 {
+  CAP_TRACE_SCOPE("SuperCapacitor::evolve_one_time_step_constant_voltage");
+  adapt_mesh_if_needed();
   bool const rebuild =
       (electrochemical_physics_params->constant_voltage == voltage) ? false
                                                                     : true;
@@ -256,6 +340,8 @@ template <int dim>
 void SuperCapacitor<dim>::evolve_one_time_step_constant_power(
     double const time_step, double const power)
 {
+  CAP_TRACE_SCOPE("SuperCapacitor::evolve_one_time_step_constant_power");
+  adapt_mesh_if_needed();
   BOOST_ASSERT_MSG(surface_area > 0.,
                    "The surface area should be greater than zero.");
   dealii::Trilinos::MPI::Vector old_solution(solution->block(0));
@@ -338,24 +424,47 @@ void SuperCapacitor<dim>::evolve_one_time_step(
 {
   // The first time evolve_one_time_step is called, the solution and the
   // post-processor need to be iniatialized.
-  if (electrochemical_physics_params->supercapacitor_state == Uninitialized)
+  ScopedTimer time_step_timer("time_step");
+  SolverStatistics statistics = SolverStatistics();
+  statistics.step = n_time_steps;
+  // The cost of the cells is only recorded while the load balancing is
+  // calibrated.
+  electrochemical_physics_params->record_cost =
+      (calibration_steps > 0) && (n_time_steps <= calibration_steps);
+  // Build the system the first time and rebuild it if necessary. The physics
+  // is deleted when the mesh is adapted.
+  if ((electrochemical_physics_params->supercapacitor_state ==
+       Uninitialized) ||
+      (rebuild == true) || (electrochemical_physics == nullptr) ||
+      (std::abs(time_step / electrochemical_physics_params->time_step - 1.0) >
+       1e-14) ||
+      (supercapacitor_state !=
+       electrochemical_physics_params->supercapacitor_state))
   {
+    ScopedTimer physics_timer("physics");
+    statistics.rebuilt_operator = true;
     electrochemical_physics_params->time_step = time_step;
     electrochemical_physics_params->supercapacitor_state = supercapacitor_state;
     electrochemical_physics.reset(new ElectrochemicalPhysics<dim>(
         electrochemical_physics_params, this->_communicator));
+    preconditioner.reset();
+    matrix_free_preconditioner.reset();
+    electrochemical_operator.reset();
+    single_precision_preconditioner.reset();
+    single_precision_operator.reset();
+    statistics.assembly_time = physics_timer.stop();
   }
-  // Rebuild the system if necessary
-  else if ((rebuild == true) ||
-           (std::abs(time_step / electrochemical_physics_params->time_step -
-                     1.0) > 1e-14) ||
-           (supercapacitor_state !=
-            electrochemical_physics_params->supercapacitor_state))
+
+  if (backend == "matrix_free")
   {
-    electrochemical_physics_params->time_step = time_step;
-    electrochemical_physics_params->supercapacitor_state = supercapacitor_state;
-    electrochemical_physics.reset(new ElectrochemicalPhysics<dim>(
-        electrochemical_physics_params, this->_communicator));
+    ScopedTimer solve_timer("solve");
+    solve_matrix_free(statistics);
+    statistics.solve_time = solve_timer.stop();
+    ScopedTimer postprocess_timer("postprocess");
+    post_processor->reset(post_processor_params);
+    statistics.postprocess_time = postprocess_timer.stop();
+    solver_statistics.push_back(statistics);
+    return;
   }
 
   // Get the system from the ElectrochemicalPhysiscs object.
@@ -371,29 +480,450 @@ void SuperCapacitor<dim>::evolve_one_time_step(
   mass_matrix.vmult_add(time_dep_rhs, solution->block(0));
 
   // Solve the system
-  _solver_timer.start();
   double tolerance =
       std::max(abs_tolerance, rel_tolerance * system_rhs.l2_norm());
-  dealii::SolverControl solver_control(max_iter, tolerance);
-  dealii::SolverCG<dealii::Trilinos::MPI::Vector> solver(solver_control);
-  // Compute the condition number at the end of the CG iterations.
-  if (verbose_lvl > 1)
-    solver.connect_condition_number_slot(
-        std::bind(&SuperCapacitor<dim>::output_condition_number, this,
-                  std::placeholders::_1),
-        false);
-  // Compute all the eigenvalues at the end of the CG iterations.
-  if (verbose_lvl > 2)
-    solver.connect_eigenvalues_slot(
-        std::bind(&SuperCapacitor<dim>::output_eigenvalues, this,
-                  std::placeholders::_1),
-        false);
-  dealii::Trilinos::PreconditionAMG preconditioner;
-  // Temporary preconditioner. Need to find what parameters work best.
-  preconditioner.initialize(system_matrix);
+  // The preconditioner only depends on the system matrix so it is built only
+  // when the system has been rebuilt. The iterative refinement uses its own
+  // single-precision preconditioner.
+  if ((preconditioner == nullptr) && !mixed_precision)
+  {
+    ScopedTimer preconditioner_timer("preconditioner");
+    CAP_TRACE_SCOPE("SuperCapacitor::build_preconditioner");
+    statistics.rebuilt_preconditioner = true;
+    // Temporary preconditioner. Need to find what parameters work best.
+    preconditioner = std::make_shared<dealii::Trilinos::PreconditionAMG>();
+    preconditioner->initialize(system_matrix);
+  }
+  ScopedTimer solve_timer("solve");
+  constraint_matrix.distribute(solution->block(0));
+  unsigned int n_iterations = 0;
+  if (mixed_precision)
+  {
+    CAP_TRACE_SCOPE("SuperCapacitor::solve_with_iterative_refinement");
+    n_iterations = solve_with_iterative_refinement(
+        system_matrix, solution->block(0), time_dep_rhs, tolerance,
+        statistics);
+    if ((verbose_lvl > 0) && (_communicator.rank() == 0))
+      std::cout << "Number of inner iterations: " << n_iterations << std::endl
+                << std::endl;
+  }
+  else if (solver_type == "pipelined_cg")
+  {
+    CAP_TRACE_SCOPE("SuperCapacitor::pipelined_cg_solve");
+    PipelinedCG solver(max_iter);
+    solver.solve(system_matrix, solution->block(0), time_dep_rhs,
+                 *preconditioner, tolerance);
+    n_iterations = solver.last_step();
+    statistics.n_iterations = n_iterations;
+    statistics.initial_residual = solver.initial_value();
+    statistics.final_residual = solver.last_value();
+    if ((verbose_lvl > 0) && (_communicator.rank() == 0))
+      std::cout << "Last value: " << solver.last_value() << std::endl
+                << "Number of iterations: " << solver.last_step() << std::endl
+                << std::endl;
+  }
+  else
+  {
+    CAP_TRACE_SCOPE("SuperCapacitor::cg_solve");
+    dealii::SolverControl solver_control(max_iter, tolerance);
+    dealii::SolverCG<dealii::Trilinos::MPI::Vector> solver(solver_control);
+    // Compute the condition number at the end of the CG iterations.
+    if (verbose_lvl > 1)
+      solver.connect_condition_number_slot(
+          std::bind(&SuperCapacitor<dim>::output_condition_number, this,
+                    std::placeholders::_1),
+          false);
+    // Compute all the eigenvalues at the end of the CG iterations.
+    if (verbose_lvl > 2)
+      solver.connect_eigenvalues_slot(
+          std::bind(&SuperCapacitor<dim>::output_eigenvalues, this,
+                    std::placeholders::_1),
+          false);
+    solver.solve(system_matrix, solution->block(0), time_dep_rhs,
+                 *preconditioner);
+    n_iterations = solver_control.last_step();
+    statistics.n_iterations = n_iterations;
+    statistics.initial_residual = solver_control.initial_value();
+    statistics.final_residual = solver_control.last_value();
+    if ((verbose_lvl > 0) && (_communicator.rank() == 0))
+    {
+      std::cout << "Initial value: " << solver_control.initial_value()
+                << std::endl;
+      std::cout << "Last value: " << solver_control.last_value() << std::endl;
+      std::cout << "Number of iterations: " << solver_control.last_step()
+                << std::endl
+                << std::endl;
+    }
+  }
   constraint_matrix.distribute(solution->block(0));
-  solver.solve(system_matrix, solution->block(0), time_dep_rhs, preconditioner);
+  statistics.solve_time = solve_timer.stop();
+
+  // Measure the cost of the materials during the first time steps.
+  if (n_time_steps <= calibration_steps)
+    record_material_cost(statistics.rebuilt_operator, n_iterations);
+
+  // Update the data in post-processor
+  ScopedTimer postprocess_timer("postprocess");
+  post_processor->reset(post_processor_params);
+  statistics.postprocess_time = postprocess_timer.stop();
+  solver_statistics.push_back(statistics);
+}
+
+template <int dim>
+void SuperCapacitor<dim>::adapt_mesh_if_needed()
+{
+  if ((calibration_steps > 0) && (n_time_steps == calibration_steps))
+    rebalance_mesh();
+  if ((refinement_interval > 0) && (n_time_steps > 0) &&
+      (n_time_steps % refinement_interval == 0))
+    refine_mesh();
+  ++n_time_steps;
+}
+
+template <int dim>
+void SuperCapacitor<dim>::refine_mesh()
+{
+  ScopedTimer refine_timer("refine_mesh");
+  std::shared_ptr<dealii::distributed::Triangulation<dim>> triangulation =
+      _geometry->get_mutable_triangulation();
+
+  // The estimator and the solution transfer need the ghost values.
+  dealii::IndexSet locally_relevant_dofs;
+  dealii::DoFTools::extract_locally_relevant_dofs(*dof_handler,
+                                                  locally_relevant_dofs);
+  dealii::Trilinos::MPI::Vector relevant_solution(
+      dof_handler->locally_owned_dofs(), locally_relevant_dofs,
+      this->_communicator);
+  relevant_solution = solution->block(0);
+
+  // Estimate the error on both potentials. Most of the error is located at the
+  // interfaces between the electrodes and the separator where the
+  // conductivities jump.
+  dealii::Vector<float> estimated_error(triangulation->n_active_cells());
+  dealii::KellyErrorEstimator<dim>::estimate(
+      *dof_handler, dealii::QGauss<dim - 1>(_fe->degree + 1),
+      typename dealii::FunctionMap<dim>::type(), relevant_solution,
+      estimated_error);
+  dealii::distributed::GridRefinement::refine_and_coarsen_fixed_fraction(
+      *triangulation, estimated_error, refine_fraction, coarsen_fraction);
+  for (auto cell : triangulation->active_cell_iterators())
+    if (cell->is_locally_owned())
+    {
+      if (static_cast<unsigned int>(cell->level()) >= max_refinement_level)
+        cell->clear_refine_flag();
+      if (static_cast<unsigned int>(cell->level()) <= min_refinement_level)
+        cell->clear_coarsen_flag();
+    }
+
+  execute_mesh_change(relevant_solution);
+  refine_timer.stop();
+
+  if ((verbose_lvl > 0) && (_communicator.rank() == 0))
+    std::cout << "Number of active cells: "
+              << triangulation->n_global_active_cells() << std::endl
+              << "Number of degrees of freedom: " << dof_handler->n_dofs()
+              << std::endl
+              << std::endl;
+}
+
+template <int dim>
+void SuperCapacitor<dim>::rebalance_mesh()
+{
+  ScopedTimer rebalance_timer("rebalance_mesh");
+  std::shared_ptr<dealii::distributed::Triangulation<dim>> triangulation =
+      _geometry->get_mutable_triangulation();
+
+  // Count the cells of each material. All the processors need to know the
+  // number of materials.
+  std::vector<double> n_local_cells(material_cost.size(), 0.);
+  for (auto cell : triangulation->active_cell_iterators())
+    if (cell->is_locally_owned())
+    {
+      dealii::types::material_id const material_id = cell->material_id();
+      if (material_id >= n_local_cells.size())
+        n_local_cells.resize(material_id + 1, 0.);
+      n_local_cells[material_id] += 1.;
+    }
+  unsigned int const n_materials = dealii::Utilities::MPI::max(
+      static_cast<unsigned int>(
+          std::max(n_local_cells.size(), material_cost.size())),
+      this->_communicator);
+  n_local_cells.resize(n_materials, 0.);
+  material_cost.resize(n_materials, 0.);
+  std::vector<double> n_cells(n_materials);
+  std::vector<double> cost(n_materials);
+  dealii::Utilities::MPI::sum(n_local_cells, this->_communicator, n_cells);
+  dealii::Utilities::MPI::sum(material_cost, this->_communicator, cost);
+
+  // Compute the cost of one cell of each material. The cheapest cells keep the
+  // default weight.
+  double min_cost = std::numeric_limits<double>::max();
+  for (unsigned int m = 0; m < n_materials; ++m)
+    if ((n_cells[m] > 0.) && (cost[m] > 0.))
+    {
+      cost[m] /= n_cells[m];
+      min_cost = std::min(min_cost, cost[m]);
+    }
+    else
+      cost[m] = 0.;
+  // If nothing has been measured, the weights are left unchanged.
+  if (min_cost == std::numeric_limits<double>::max())
+    return;
+  std::vector<unsigned int> cell_weights(n_materials, 0);
+  for (unsigned int m = 0; m < n_materials; ++m)
+    if (cost[m] > 0.)
+      cell_weights[m] = static_cast<unsigned int>(
+          std::lround(1000. * (cost[m] / min_cost - 1.)));
+  _geometry->set_cell_weights(cell_weights);
+
+  // No cell is flagged so the mesh is only repartitioned.
+  dealii::IndexSet locally_relevant_dofs;
+  dealii::DoFTools::extract_locally_relevant_dofs(*dof_handler,
+                                                  locally_relevant_dofs);
+  dealii::Trilinos::MPI::Vector relevant_solution(
+      dof_handler->locally_owned_dofs(), locally_relevant_dofs,
+      this->_communicator);
+  relevant_solution = solution->block(0);
+  execute_mesh_change(relevant_solution);
+  rebalance_timer.stop();
+
+  if ((verbose_lvl > 0) && (_communicator.rank() == 0))
+  {
+    std::cout << "Weights of the cells:";
+    for (unsigned int m = 0; m < n_materials; ++m)
+      std::cout << " " << cell_weights[m];
+    std::cout << std::endl << std::endl;
+  }
+}
+
+template <int dim>
+void SuperCapacitor<dim>::execute_mesh_change(
+    dealii::Trilinos::MPI::Vector const &relevant_solution)
+{
+  std::shared_ptr<dealii::distributed::Triangulation<dim>> triangulation =
+      _geometry->get_mutable_triangulation();
+
+  // Adapt the mesh and transfer the solution.
+  dealii::distributed::SolutionTransfer<dim, dealii::Trilinos::MPI::Vector>
+      solution_transfer(*dof_handler);
+  triangulation->prepare_coarsening_and_refinement();
+  solution_transfer.prepare_for_coarsening_and_refinement(relevant_solution);
+  triangulation->execute_coarsening_and_refinement();
+
+  dof_handler->distribute_dofs(*_fe);
+  renumber_dofs(*dof_handler, _ptree.get_child("solver"));
+  dealii::Trilinos::MPI::Vector transferred_solution(
+      dof_handler->locally_owned_dofs(), this->_communicator);
+  solution_transfer.interpolate(transferred_solution);
+  // Make the solution continuous at the hanging nodes.
+  dealii::IndexSet locally_relevant_dofs;
+  dealii::DoFTools::extract_locally_relevant_dofs(*dof_handler,
+                                                  locally_relevant_dofs);
+  dealii::ConstraintMatrix hanging_node_constraints(locally_relevant_dofs);
+  dealii::DoFTools::make_hanging_node_constraints(*dof_handler,
+                                                  hanging_node_constraints);
+  hanging_node_constraints.close();
+  hanging_node_constraints.distribute(transferred_solution);
+  // The solution is reinitialized in place because it is shared with the
+  // post-processor parameters.
+  std::vector<dealii::IndexSet> index_set(1, dof_handler->locally_owned_dofs());
+  solution->reinit(index_set, this->_communicator);
+  solution->block(0) = transferred_solution;
+
+  // The physics and everything built on top of it are rebuilt during the next
+  // time step. The surface area of the cathode does not change since the
+  // boundary is flat.
+  electrochemical_physics.reset();
+  preconditioner.reset();
+  matrix_free_preconditioner.reset();
+  electrochemical_operator.reset();
+  single_precision_preconditioner.reset();
+  single_precision_operator.reset();
+  batch_physics.reset();
+  batch_preconditioner.reset();
+  voltage_functional.reset();
+
+  // The post-processor stores cell-wise quantities so it needs to be rebuilt.
+  post_processor = std::make_shared<SuperCapacitorPostprocessor<dim>>(
+      post_processor_params, _geometry, this->_communicator);
+  post_processor->reset(post_processor_params);
+}
+
+template <int dim>
+void SuperCapacitor<dim>::record_material_cost(bool const assembled,
+                                               unsigned int const n_iterations)
+{
+  std::vector<double> const &assembly_time =
+      electrochemical_physics->get_assembly_time();
+  std::vector<double> const &n_matrix_entries =
+      electrochemical_physics->get_n_matrix_entries();
+  if (material_cost.size() < assembly_time.size())
+    material_cost.resize(assembly_time.size(), 0.);
+  if (assembled)
+    for (unsigned int m = 0; m < assembly_time.size(); ++m)
+      material_cost[m] += assembly_time[m];
+
+  // Time one matrix-vector product and share the time of the products done by
+  // the Krylov solver between the materials. The solver does not expose the
+  // time of its own products so an extra one is done. This only happens during
+  // the calibration steps.
+  dealii::Trilinos::MPI::Vector product(solution->block(0));
+  std::chrono::steady_clock::time_point const start =
+      std::chrono::steady_clock::now();
+  electrochemical_physics->get_system_matrix().vmult(product,
+                                                     solution->block(0));
+  double const matvec_time =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  double const n_entries =
+      std::accumulate(n_matrix_entries.begin(), n_matrix_entries.end(), 0.);
+  if (n_entries > 0.)
+    for (unsigned int m = 0; m < n_matrix_entries.size(); ++m)
+      material_cost[m] +=
+          n_iterations * matvec_time * n_matrix_entries[m] / n_entries;
+}
+
+template <int dim>
+unsigned int SuperCapacitor<dim>::solve_with_iterative_refinement(
+    dealii::Trilinos::SparseMatrix const &system_matrix,
+    dealii::Trilinos::MPI::Vector &x, dealii::Trilinos::MPI::Vector const &rhs,
+    double const tolerance, SolverStatistics &statistics)
+{
+  typedef typename ElectrochemicalOperatorBase<dim, float>::VectorType
+      FloatVectorType;
+  dealii::ConstraintMatrix const &constraint_matrix =
+      electrochemical_physics->get_constraint_matrix();
+  // The single-precision operator represents the same matrix as
+  // system_matrix. It only depends on the time step and on the constraints so
+  // it is built only when the system has been rebuilt.
+  if (single_precision_operator == nullptr)
+  {
+    ScopedTimer preconditioner_timer("preconditioner");
+    CAP_TRACE_SCOPE("SuperCapacitor::build_preconditioner");
+    statistics.rebuilt_preconditioner = true;
+    single_precision_operator = build_electrochemical_operator<dim, float>(
+        electrochemical_physics_params, constraint_matrix, _communicator);
+    typename dealii::PreconditionChebyshev<
+        ElectrochemicalOperatorBase<dim, float>,
+        FloatVectorType>::AdditionalData chebyshev_data;
+    chebyshev_data.degree = chebyshev_degree;
+    chebyshev_data.smoothing_range = smoothing_range;
+    chebyshev_data.matrix_diagonal_inverse =
+        single_precision_operator->get_matrix_diagonal_inverse();
+    single_precision_preconditioner =
+        std::make_shared<dealii::PreconditionChebyshev<
+            ElectrochemicalOperatorBase<dim, float>, FloatVectorType>>();
+    single_precision_preconditioner->initialize(*single_precision_operator,
+                                                chebyshev_data);
+  }
+
+  dealii::Trilinos::MPI::Vector residual(rhs);
+  FloatVectorType float_residual;
+  FloatVectorType correction;
+  single_precision_operator->initialize_dof_vector(float_residual);
+  single_precision_operator->initialize_dof_vector(correction);
+  unsigned int n_iterations = 0;
+  for (unsigned int k = 0; k <= max_refinement_steps; ++k)
+  {
+    // r = b - A x in double precision. The constrained entries are set by
+    // the caller once the solve is done so they are left out.
+    system_matrix.residual(residual, x, rhs);
+    constraint_matrix.set_zero(residual);
+    double const residual_norm = residual.l2_norm();
+    if ((verbose_lvl > 0) && (_communicator.rank() == 0))
+      std::cout << "Refinement step " << k << " residual: " << residual_norm
+                << std::endl;
+    if (k == 0)
+      statistics.initial_residual = residual_norm;
+    statistics.final_residual = residual_norm;
+    statistics.n_iterations = n_iterations;
+    if (residual_norm <= tolerance)
+      return n_iterations;
+    if (k == max_refinement_steps)
+      break;
+
+    // A c = r / |r| in single precision, then x += |r| c.
+    copy_locally_owned(residual, 1. / residual_norm, float_residual);
+    correction = 0.f;
+    dealii::SolverControl inner_control(
+        max_iter, std::max(tolerance / residual_norm, inner_rel_tolerance));
+    dealii::SolverCG<FloatVectorType> inner_solver(inner_control);
+    inner_solver.solve(*single_precision_operator, correction, float_residual,
+                       *single_precision_preconditioner);
+    n_iterations += inner_control.last_step();
+    add_locally_owned(residual_norm, correction, x);
+  }
+
+  throw std::runtime_error("iterative refinement did not converge in " +
+                           std::to_string(max_refinement_steps) + " steps");
+}
+
+template <int dim>
+void SuperCapacitor<dim>::solve_matrix_free(SolverStatistics &statistics)
+{
+  typedef typename ElectrochemicalOperatorBase<dim>::VectorType VectorType;
+  dealii::ConstraintMatrix const &constraint_matrix =
+      electrochemical_physics->get_constraint_matrix();
+  // The operator and the preconditioner only depend on the time step and on
+  // the constraints so they are built only when the system has been rebuilt.
+  if (electrochemical_operator == nullptr)
+  {
+    CAP_TRACE_SCOPE("SuperCapacitor::build_preconditioner");
+    statistics.rebuilt_preconditioner = true;
+    electrochemical_operator = build_electrochemical_operator<dim>(
+        electrochemical_physics_params, constraint_matrix, _communicator);
+    typename dealii::PreconditionChebyshev<
+        ElectrochemicalOperatorBase<dim>, VectorType>::AdditionalData
+        chebyshev_data;
+    chebyshev_data.degree = chebyshev_degree;
+    chebyshev_data.smoothing_range = smoothing_range;
+    chebyshev_data.matrix_diagonal_inverse =
+        electrochemical_operator->get_matrix_diagonal_inverse();
+    matrix_free_preconditioner = std::make_shared<dealii::PreconditionChebyshev<
+        ElectrochemicalOperatorBase<dim>, VectorType>>();
+    matrix_free_preconditioner->initialize(*electrochemical_operator,
+                                           chebyshev_data);
+  }
+
+  VectorType old_solution;
+  VectorType rhs;
+  VectorType lifting;
+  VectorType correction;
+  electrochemical_operator->initialize_dof_vector(old_solution);
+  electrochemical_operator->initialize_dof_vector(rhs);
+  electrochemical_operator->initialize_dof_vector(lifting);
+  electrochemical_operator->initialize_dof_vector(correction);
+  copy_locally_owned(solution->block(0), old_solution);
+  copy_locally_owned(electrochemical_physics->get_system_rhs(), rhs);
+
+  // Lift the Dirichlet boundary conditions: lifting contains the values of
+  // the constrained degrees of freedom and zero elsewhere.
+  constraint_matrix.distribute(lifting);
+  electrochemical_operator->apply_add(rhs, lifting, -1., -1.);
+  electrochemical_operator->set_constrained_entries_to_zero(rhs);
+  double const tolerance =
+      std::max(abs_tolerance, rel_tolerance * rhs.l2_norm());
+  // Add the contribution of the previous time step.
+  electrochemical_operator->apply_add(rhs, old_solution, 1., 0.);
+  electrochemical_operator->set_constrained_entries_to_zero(rhs);
+
+  // Use the previous solution as initial guess.
+  correction = old_solution;
+  correction -= lifting;
+  electrochemical_operator->set_constrained_entries_to_zero(correction);
+  dealii::SolverControl solver_control(max_iter, tolerance);
+  dealii::SolverCG<VectorType> solver(solver_control);
+  {
+    CAP_TRACE_SCOPE("SuperCapacitor::cg_solve");
+    solver.solve(*electrochemical_operator, correction, rhs,
+                 *matrix_free_preconditioner);
+  }
+  correction += lifting;
+  copy_locally_owned(correction, solution->block(0));
   constraint_matrix.distribute(solution->block(0));
+  statistics.n_iterations = solver_control.last_step();
+  statistics.initial_residual = solver_control.initial_value();
+  statistics.final_residual = solver_control.last_value();
   if ((verbose_lvl > 0) && (_communicator.rank() == 0))
   {
     std::cout << "Initial value: " << solver_control.initial_value()
@@ -403,10 +933,140 @@ void SuperCapacitor<dim>::evolve_one_time_step(
               << std::endl
               << std::endl;
   }
-  _solver_timer.stop();
+}
 
-  // Update the data in post-processor
-  post_processor->reset(post_processor_params);
+template <int dim>
+void SuperCapacitor<dim>::evolve_one_time_step_constant_current(
+    double const time_step, std::vector<double> const &currents,
+    std::vector<dealii::Trilinos::MPI::Vector> &states,
+    std::vector<double> &voltages)
+{
+  CAP_TRACE_SCOPE("SuperCapacitor::evolve_one_time_step_constant_current");
+  BOOST_ASSERT_MSG(surface_area > 0.,
+                   "The surface area should be greater than zero.");
+  BOOST_ASSERT_MSG(currents.size() == states.size(),
+                   "The number of currents and states differ.");
+  if (backend == "matrix_free")
+    throw std::runtime_error("The batched evolve function is not available "
+                             "with the matrix-free backend");
+  unsigned int const n_states = states.size();
+
+  // The system matrix does not depend on the imposed current, so it only needs
+  // to be rebuilt when the time step changes. The physics is built using a unit
+  // current density and the right-hand side is scaled for each state.
+  if ((batch_physics == nullptr) ||
+      (std::abs(time_step / batch_physics_params->time_step - 1.0) > 1e-14))
+  {
+    batch_physics_params =
+        std::make_shared<ElectrochemicalPhysicsParameters<dim>>(
+            *electrochemical_physics_params);
+    batch_physics_params->time_step = time_step;
+    batch_physics_params->supercapacitor_state = ConstantCurrent;
+    batch_physics_params->constant_current_density = 1.;
+    batch_physics_params->record_cost = false;
+    batch_physics = std::make_shared<ElectrochemicalPhysics<dim>>(
+        batch_physics_params, this->_communicator);
+    batch_preconditioner =
+        std::make_shared<dealii::Trilinos::PreconditionAMG>();
+    batch_preconditioner->initialize(batch_physics->get_system_matrix());
+  }
+  if (voltage_functional == nullptr)
+    build_voltage_functional();
+
+  dealii::Trilinos::SparseMatrix const &system_matrix =
+      batch_physics->get_system_matrix();
+  dealii::Trilinos::SparseMatrix const &mass_matrix =
+      batch_physics->get_mass_matrix();
+  dealii::ConstraintMatrix const &constraint_matrix =
+      batch_physics->get_constraint_matrix();
+  dealii::Trilinos::MPI::Vector const &unit_rhs =
+      batch_physics->get_system_rhs();
+  double const unit_rhs_norm = unit_rhs.l2_norm();
+
+  std::vector<dealii::Trilinos::MPI::Vector> time_dep_rhs(n_states, unit_rhs);
+  std::vector<double> tolerances(n_states);
+  for (unsigned int i = 0; i < n_states; ++i)
+  {
+    double const current_density = currents[i] / surface_area;
+    time_dep_rhs[i] *= current_density;
+    mass_matrix.vmult_add(time_dep_rhs[i], states[i]);
+    tolerances[i] = std::max(abs_tolerance, rel_tolerance *
+                                                std::abs(current_density) *
+                                                unit_rhs_norm);
+    constraint_matrix.distribute(states[i]);
+  }
+
+  // Solve all the systems together
+  ScopedTimer solve_timer("batched_solve");
+  BatchedCG solver(max_iter);
+  {
+    CAP_TRACE_SCOPE("SuperCapacitor::batched_cg_solve");
+    solver.solve(system_matrix, states, time_dep_rhs, *batch_preconditioner,
+                 tolerances);
+  }
+  if ((verbose_lvl > 0) && (_communicator.rank() == 0))
+    std::cout << "Number of iterations of the batched solver: "
+              << solver.last_step() << std::endl
+              << std::endl;
+  solve_timer.stop();
+
+  voltages.resize(n_states);
+  for (unsigned int i = 0; i < n_states; ++i)
+  {
+    constraint_matrix.distribute(states[i]);
+    voltages[i] = (*voltage_functional) * states[i];
+  }
+}
+
+template <int dim>
+void SuperCapacitor<dim>::build_voltage_functional()
+{
+  voltage_functional = std::make_shared<dealii::Trilinos::MPI::Vector>(
+      dof_handler->locally_owned_dofs(), this->_communicator);
+  dealii::types::boundary_id const cathode_boundary_id =
+      _geometry->get_cathode_boundary_id();
+  dealii::FEValuesExtractors::Scalar const solid_potential(
+      _ptree.get<unsigned int>("solid_potential_component"));
+  dealii::QGauss<dim - 1> face_quadrature_rule(_fe->degree + 1);
+  unsigned int const n_face_q_points = face_quadrature_rule.size();
+  dealii::FEFaceValues<dim> fe_face_values(
+      *_fe, face_quadrature_rule,
+      dealii::update_values | dealii::update_JxW_values);
+  unsigned int const dofs_per_cell = _fe->dofs_per_cell;
+  dealii::Vector<double> cell_functional(dofs_per_cell);
+  std::vector<dealii::types::global_dof_index> local_dof_indices(dofs_per_cell);
+  double area = 0.;
+  for (auto cell : dof_handler->active_cell_iterators())
+    if (cell->is_locally_owned() && cell->at_boundary())
+    {
+      cell_functional = 0.;
+      for (unsigned int face = 0;
+           face < dealii::GeometryInfo<dim>::faces_per_cell; ++face)
+        if ((cell->face(face)->at_boundary()) &&
+            (cell->face(face)->boundary_id() == cathode_boundary_id))
+        {
+          fe_face_values.reinit(cell, face);
+          for (unsigned int q = 0; q < n_face_q_points; ++q)
+          {
+            for (unsigned int i = 0; i < dofs_per_cell; ++i)
+              cell_functional[i] +=
+                  fe_face_values[solid_potential].value(i, q) *
+                  fe_face_values.JxW(q);
+            area += fe_face_values.JxW(q);
+          }
+        }
+      cell->get_dof_indices(local_dof_indices);
+      voltage_functional->add(local_dof_indices, cell_functional);
+    }
+  voltage_functional->compress(dealii::VectorOperation::add);
+  area = dealii::Utilities::MPI::sum(area, this->_communicator);
+  (*voltage_functional) /= area;
+}
+
+template <int dim>
+dealii::Trilinos::MPI::Vector SuperCapacitor<dim>::get_state() const
+{
+  return solution->block(0);
 }
 
 template <int dim>
@@ -429,6 +1089,199 @@ void SuperCapacitor<dim>::output_eigenvalues(
   }
 }
 
+template <int dim>
+boost::circular_buffer<SolverStatistics> const &
+SuperCapacitor<dim>::get_solver_statistics() const
+{
+  return solver_statistics;
+}
+
+template <int dim>
+std::map<std::string, std::size_t>
+SuperCapacitor<dim>::get_memory_consumption() const
+{
+  std::map<std::string, std::size_t> memory;
+  memory["triangulation"] =
+      _geometry->get_triangulation()->memory_consumption();
+  memory["dof_handler"] = dof_handler->memory_consumption();
+  for (std::string const &key :
+       {"constraints", "sparsity_pattern", "system_matrix", "mass_matrix",
+        "system_rhs", "preconditioner"})
+    memory[key] = 0;
+  for (auto const &physics : {electrochemical_physics, batch_physics})
+    if (physics != nullptr)
+      for (auto const &component : physics->get_memory_consumption())
+        memory[component.first] += component.second;
+  for (auto const &amg : {preconditioner, batch_preconditioner})
+    if (amg != nullptr)
+      memory["preconditioner"] += amg->memory_consumption();
+  // The Chebyshev smoothers use the inverse of the diagonal stored by the
+  // operators.
+  if (electrochemical_operator != nullptr)
+    memory["preconditioner"] +=
+        electrochemical_operator->get_matrix_diagonal_inverse()
+            .memory_consumption();
+  if (single_precision_operator != nullptr)
+    memory["preconditioner"] +=
+        single_precision_operator->get_matrix_diagonal_inverse()
+            .memory_consumption();
+  memory["solution"] = solution->memory_consumption();
+  memory["postprocessor"] = post_processor->memory_consumption();
+
+  return memory;
+}
+
+template <int dim>
+std::map<std::string, std::size_t>
+SuperCapacitor<dim>::estimate_memory_consumption(
+    boost::property_tree::ptree const &ptree,
+    boost::mpi::communicator const &comm)
+{
+  // Build the mesh and distribute the degrees of freedom as in the
+  // constructor. They are cheap compared to the system. The cache of the mesh
+  // is neither read nor written since the device is not built.
+  std::shared_ptr<boost::property_tree::ptree> geometry_database =
+      std::make_shared<boost::property_tree::ptree>(
+          ptree.get_child("geometry"));
+  geometry_database->erase("cache_directory");
+  Geometry<dim> geometry(geometry_database, comm);
+  std::shared_ptr<dealii::distributed::Triangulation<dim> const> triangulation =
+      geometry.get_triangulation();
+  unsigned int const polynomial_degree =
+      ptree.get<unsigned int>("solver.polynomial_degree", 1);
+  dealii::FESystem<dim> fe(dealii::FE_Q<dim>(polynomial_degree), 2);
+  dealii::DoFHandler<dim> dof_handler(*triangulation);
+  dof_handler.distribute_dofs(fe);
+  dealii::IndexSet locally_relevant_dofs;
+  dealii::DoFTools::extract_locally_relevant_dofs(dof_handler,
+                                                  locally_relevant_dofs);
+  dealii::ConstraintMatrix constraints(locally_relevant_dofs);
+  dealii::DoFTools::make_hanging_node_constraints(dof_handler, constraints);
+  constraints.close();
+
+  std::map<std::string, std::size_t> memory;
+  memory["triangulation"] = triangulation->memory_consumption();
+  memory["dof_handler"] = dof_handler.memory_consumption();
+  memory["constraints"] = constraints.memory_consumption();
+
+  // When the inactive degrees of freedom are eliminated, their rows and their
+  // columns are empty. The liquid potential carries no physics in the current
+  // collectors and the solid potential carries none in the separator.
+  std::size_t const n_rows = dof_handler.n_locally_owned_dofs();
+  std::size_t n_active_rows = n_rows;
+  if (ptree.get("solver.eliminate_inactive_dofs", false))
+  {
+    unsigned int const solid_potential_component =
+        ptree.get<unsigned int>("solid_potential_component");
+    unsigned int const liquid_potential_component =
+        ptree.get<unsigned int>("liquid_potential_component");
+    std::vector<std::pair<bool, bool>> active_components;
+    for (auto const &material : *geometry.get_materials())
+    {
+      std::string const type =
+          ptree.get("material_properties." + material.first + ".type", "");
+      for (auto const material_id : material.second)
+      {
+        if (material_id >= active_components.size())
+          active_components.resize(material_id + 1,
+                                   std::make_pair(true, true));
+        active_components[material_id] = std::make_pair(
+            type != "permeable_membrane", type != "current_collector");
+      }
+    }
+    dealii::IndexSet const &locally_owned_dofs =
+        dof_handler.locally_owned_dofs();
+    std::vector<dealii::types::global_dof_index> local_dof_indices(
+        fe.dofs_per_cell);
+    std::vector<dealii::types::global_dof_index> active;
+    for (auto cell : dof_handler.active_cell_iterators())
+    {
+      if (cell->is_artificial())
+        continue;
+      std::pair<bool, bool> const cell_active_components =
+          (cell->material_id() < active_components.size())
+              ? active_components[cell->material_id()]
+              : std::make_pair(true, true);
+      cell->get_dof_indices(local_dof_indices);
+      for (unsigned int i = 0; i < fe.dofs_per_cell; ++i)
+      {
+        unsigned int const component = fe.system_to_component_index(i).first;
+        if ((((component == solid_potential_component) &&
+              cell_active_components.first) ||
+             ((component == liquid_potential_component) &&
+              cell_active_components.second)) &&
+            locally_owned_dofs.is_element(local_dof_indices[i]))
+          active.push_back(local_dof_indices[i]);
+      }
+    }
+    std::sort(active.begin(), active.end());
+    active.erase(std::unique(active.begin(), active.end()), active.end());
+    n_active_rows = active.size();
+  }
+
+  // Epetra stores the column index of each entry and the offset of each row.
+  // The values are stored in double precision. Every active degree of freedom
+  // is assumed to be coupled to both potentials of all the neighboring cells
+  // and the inactive columns are assumed to be evenly spread over the rows.
+  std::size_t row_length = fe.n_components();
+  for (unsigned int d = 0; d < dim; ++d)
+    row_length *= 2 * polynomial_degree + 1;
+  std::size_t const n_entries =
+      (n_rows > 0) ? n_active_rows * n_active_rows / n_rows * row_length : 0;
+  std::size_t const vector_memory = n_rows * sizeof(double);
+  // The preconditioner is counted as in get_memory_consumption(): the
+  // Chebyshev smoothers only add the inverse of the diagonal, which is stored
+  // by the operators. The hierarchy built by ML is not reported by
+  // Trilinos::PreconditionAMG::memory_consumption() so only the wrapper is
+  // counted, which does not depend on the matrix.
+  bool const matrix_free =
+      (ptree.get<std::string>("solver.backend", "matrix_based") ==
+       "matrix_free");
+  bool const mixed_precision = ptree.get("solver.mixed_precision", false);
+  memory["preconditioner"] = 0;
+  if (matrix_free)
+    memory["preconditioner"] += vector_memory;
+  if (mixed_precision)
+    memory["preconditioner"] += n_rows * sizeof(float);
+  if (!matrix_free && !mixed_precision)
+    memory["preconditioner"] +=
+        dealii::Trilinos::PreconditionAMG().memory_consumption();
+  if (matrix_free)
+  {
+    memory["sparsity_pattern"] = 0;
+    memory["system_matrix"] = 0;
+    memory["mass_matrix"] = 0;
+  }
+  else
+  {
+    std::size_t const matrix_memory =
+        n_entries * (sizeof(double) + sizeof(int)) + n_rows * sizeof(int);
+    memory["sparsity_pattern"] = (n_entries + n_rows) * sizeof(int);
+    memory["system_matrix"] = matrix_memory;
+    memory["mass_matrix"] = matrix_memory;
+  }
+  memory["solution"] = vector_memory;
+  memory["system_rhs"] = vector_memory;
+
+  // The postprocessor stores one value per active cell, including the ghost
+  // and the artificial cells, for each debug field and each component of the
+  // debug fluxes.
+  std::size_t n_debug_vectors =
+      ptree.get("debug.material_ids", false) ? 1 : 0;
+  n_debug_vectors +=
+      to_vector<std::string>(ptree.get("debug.material_properties", ""))
+          .size();
+  n_debug_vectors +=
+      to_vector<std::string>(ptree.get("debug.solution_fields", "")).size();
+  n_debug_vectors +=
+      dim *
+      to_vector<std::string>(ptree.get("debug.solution_fluxes", "")).size();
+  memory["postprocessor"] =
+      n_debug_vectors * triangulation->n_active_cells() * sizeof(double);
+
+  return memory;
+}
+
 template <int dim>
 std::shared_ptr<Geometry<dim>> SuperCapacitor<dim>::get_geometry() const
 {
@@ -0,0 +1,423 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <cap/supercapacitor_1d.h>
+#include <cap/mp_values.h>
+#include <cap/utils.h>
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/grid/grid_generator.h>
+#include <deal.II/grid/tria.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace cap
+{
+
+namespace
+{
+// The two potentials of a node are numbered consecutively so the couplings
+// of a linear element are at most three rows away from the diagonal.
+unsigned int const bandwidth = 3;
+unsigned int const stride = bandwidth + 1;
+
+// Add @p value to the entry (i, j) of the lower band @p band. The entries
+// above the diagonal are ignored since the matrices are symmetric.
+void add(std::vector<double> &band, unsigned int const i, unsigned int const j,
+         double const value)
+{
+  if (j <= i)
+    band[i * stride + i - j] += value;
+}
+
+// Overwrite @p band with its Cholesky factor.
+void factorize(std::vector<double> &band)
+{
+  unsigned int const n = band.size() / stride;
+  for (unsigned int j = 0; j < n; ++j)
+  {
+    double diagonal = band[j * stride];
+    for (unsigned int k = (j > bandwidth) ? j - bandwidth : 0; k < j; ++k)
+      diagonal -= band[j * stride + j - k] * band[j * stride + j - k];
+    if (diagonal <= 0.)
+      throw std::runtime_error("The system matrix is not positive definite.");
+    diagonal = std::sqrt(diagonal);
+    band[j * stride] = diagonal;
+    for (unsigned int i = j + 1; i < std::min(n, j + bandwidth + 1); ++i)
+    {
+      double value = band[i * stride + i - j];
+      for (unsigned int k = (i > bandwidth) ? i - bandwidth : 0; k < j; ++k)
+        value -= band[i * stride + i - k] * band[j * stride + j - k];
+      band[i * stride + i - j] = value / diagonal;
+    }
+  }
+}
+
+// Solve L L^T x = @p b in place, where L is stored in @p band.
+void solve(std::vector<double> const &band, std::vector<double> &b)
+{
+  unsigned int const n = b.size();
+  for (unsigned int i = 0; i < n; ++i)
+  {
+    for (unsigned int k = (i > bandwidth) ? i - bandwidth : 0; k < i; ++k)
+      b[i] -= band[i * stride + i - k] * b[k];
+    b[i] /= band[i * stride];
+  }
+  for (unsigned int i = n; i-- > 0;)
+  {
+    for (unsigned int k = i + 1; k < std::min(n, i + bandwidth + 1); ++k)
+      b[i] -= band[k * stride + k - i] * b[k];
+    b[i] /= band[i * stride];
+  }
+}
+
+// @p dst = A @p src where A is the symmetric matrix whose lower band is
+// @p band.
+void vmult(std::vector<double> const &band, std::vector<double> const &src,
+           std::vector<double> &dst)
+{
+  unsigned int const n = src.size();
+  std::fill(dst.begin(), dst.end(), 0.);
+  for (unsigned int i = 0; i < n; ++i)
+  {
+    dst[i] += band[i * stride] * src[i];
+    for (unsigned int k = 1; (k <= bandwidth) && (k <= i); ++k)
+    {
+      dst[i] += band[i * stride + k] * src[i - k];
+      dst[i - k] += band[i * stride + k] * src[i];
+    }
+  }
+}
+}
+
+SuperCapacitor1D::SuperCapacitor1D(boost::property_tree::ptree const &ptree,
+                                   boost::mpi::communicator const &comm)
+    : EnergyStorageDevice(comm), area(0.), widths(), specific_capacitance(),
+      solid_conductivity(), liquid_conductivity(),
+      faradaic_reaction_coefficient(), mass_matrix(), system_matrix(),
+      lifting(), solution(), rhs(), factorized_time_step(0.),
+      factorized_state(Uninitialized), voltage(0.), current(0.)
+{
+  boost::property_tree::ptree const &geometry_database =
+      ptree.get_child("geometry");
+  std::vector<std::string> const cell_materials =
+      build_cells(geometry_database);
+  build_material_properties(ptree, cell_materials);
+  unsigned int const n_dofs = 2 * (n_cells() + 1);
+  solution.resize(n_dofs, 0.);
+  rhs.resize(n_dofs, 0.);
+}
+
+std::vector<std::string>
+SuperCapacitor1D::build_cells(boost::property_tree::ptree const &database)
+{
+  double const cm_to_m = 0.01;
+  double const cm2_to_m2 = 0.0001;
+  area = database.get<double>("geometric_area") * cm2_to_m2;
+
+  // The "supercapacitor" type of Geometry reads a mesh file, which cannot be
+  // reduced to a through-thickness discretization, so only the mesh generator
+  // is supported.
+  std::string const mesh_type = database.get<std::string>("type");
+  if (mesh_type.compare("mesh_generator") != 0)
+    throw std::runtime_error("The pseudo-1D SuperCapacitor does not support "
+                             "the geometry type " +
+                             mesh_type);
+  // The units of a stack are connected in parallel. When they carry the same
+  // current, a single unit with a larger area gives the response of the stack.
+  unsigned int const n_repetitions =
+      database.get<unsigned int>("n_repetitions", 1);
+  if (database.get("exploit_symmetry", false))
+    area *= n_repetitions + 1;
+  else if (n_repetitions != 0)
+    throw std::runtime_error("The pseudo-1D SuperCapacitor does not support "
+                             "repetitions unless exploit_symmetry is set.");
+
+  // The cells of each component are built as in Geometry::mesh_generator: the
+  // coarse cells are graded and the through-thickness refinements are applied
+  // before the global refinements, which bisect every cell.
+  unsigned int const n_refinements =
+      database.get<unsigned int>("n_refinements");
+  unsigned int const thickness_refinements =
+      database.get<unsigned int>("thickness_refinements", 0);
+  std::vector<std::pair<std::string, double>> const components = {
+      {"collector", database.get<double>("anode_collector_thickness")},
+      {"anode", database.get<double>("anode_electrode_thickness")},
+      {"separator", database.get<double>("separator_thickness")},
+      {"cathode", database.get<double>("cathode_electrode_thickness")},
+      {"collector", database.get<double>("cathode_collector_thickness")}};
+
+  std::vector<std::string> cell_materials;
+  for (auto const &component : components)
+  {
+    std::string const &name = component.first;
+    unsigned int n_coarse_cells = to_vector<unsigned int>(
+        database.get<std::string>(name + ".divisions"))[0];
+    double const grading = database.get(name + ".grading", 1.);
+    if (grading <= 0.)
+      throw std::runtime_error("The grading must be positive");
+    n_coarse_cells <<= thickness_refinements;
+    std::vector<double> coarse_widths(n_coarse_cells);
+    for (unsigned int i = 0; i < n_coarse_cells; ++i)
+      coarse_widths[i] =
+          std::pow(grading, std::min(i, n_coarse_cells - 1 - i));
+    double const scaling =
+        component.second * cm_to_m /
+        std::accumulate(coarse_widths.begin(), coarse_widths.end(), 0.);
+    unsigned int const n_children = 1 << n_refinements;
+    for (double const coarse_width : coarse_widths)
+      for (unsigned int child = 0; child < n_children; ++child)
+      {
+        widths.push_back(coarse_width * scaling / n_children);
+        cell_materials.push_back(name);
+      }
+  }
+
+  return cell_materials;
+}
+
+void SuperCapacitor1D::build_material_properties(
+    boost::property_tree::ptree const &ptree,
+    std::vector<std::string> const &cell_materials)
+{
+  std::shared_ptr<boost::property_tree::ptree const> database =
+      std::make_shared<boost::property_tree::ptree>(
+          ptree.get_child("material_properties"));
+  // The material properties are uniform so we query them on a dummy cell.
+  dealii::Triangulation<2> triangulation;
+  dealii::GridGenerator::hyper_cube(triangulation);
+  dealii::DoFHandler<2> dof_handler(triangulation);
+  dealii::DoFHandler<2>::active_cell_iterator cell = dof_handler.begin_active();
+  std::vector<std::string> const keys = {
+      "specific_capacitance", "solid_electrical_conductivity",
+      "liquid_electrical_conductivity", "faradaic_reaction_coefficient"};
+  std::map<std::string, std::vector<double>> properties;
+  for (std::string const &material_name :
+       {"anode", "separator", "cathode", "collector"})
+  {
+    std::shared_ptr<MPValues<2>> material =
+        buildMaterial<2>(material_name, database);
+    std::vector<double> &values = properties[material_name];
+    for (std::string const &key : keys)
+    {
+      std::vector<double> value(1);
+      material->get_values(key, cell, value);
+      values.push_back(value[0]);
+    }
+  }
+
+  for (std::string const &material_name : cell_materials)
+  {
+    std::vector<double> const &values = properties[material_name];
+    specific_capacitance.push_back(values[0]);
+    solid_conductivity.push_back(values[1]);
+    liquid_conductivity.push_back(values[2]);
+    faradaic_reaction_coefficient.push_back(values[3]);
+  }
+}
+
+void SuperCapacitor1D::inspect(EnergyStorageDeviceInspector *inspector)
+{
+  inspector->inspect(this);
+}
+
+void SuperCapacitor1D::get_voltage(double &voltage) const
+{
+  voltage = this->voltage;
+}
+
+void SuperCapacitor1D::get_current(double &current) const
+{
+  current = this->current;
+}
+
+unsigned int SuperCapacitor1D::n_cells() const { return widths.size(); }
+
+std::vector<double> const &SuperCapacitor1D::get_solution() const
+{
+  return solution;
+}
+
+void SuperCapacitor1D::evolve_one_time_step_constant_current(
+    double const time_step, double const current)
+{
+  evolve_one_time_step(time_step, ConstantCurrent, current);
+}
+
+void SuperCapacitor1D::evolve_one_time_step_constant_voltage(
+    double const time_step, double const voltage)
+{
+  evolve_one_time_step(time_step, ConstantVoltage, voltage);
+}
+
+void SuperCapacitor1D::evolve_one_time_step_constant_power(
+    double const time_step, double const power)
+{
+  std::vector<double> const old_solution(solution);
+  // The tolerance and the maximum number of iterations are for the picard
+  // iterations done below.
+  int const max_iterations = 10;
+  double const percent_tolerance = 1.0e-2;
+  double current(0.0);
+  double voltage(0.0);
+  get_voltage(voltage);
+  for (int k = 0; k < max_iterations; ++k)
+  {
+    current = power / voltage;
+    evolve_one_time_step(time_step, ConstantCurrent, current);
+    get_voltage(voltage);
+    if (std::abs(power - voltage * current) / std::abs(power) <
+        percent_tolerance)
+      return;
+    solution = old_solution;
+  }
+  throw std::runtime_error("fixed point iteration did not converge in " +
+                           std::to_string(max_iterations) + " iterations");
+}
+
+void SuperCapacitor1D::evolve_one_time_step_constant_load(double const,
+                                                          double const)
+{
+  throw std::runtime_error("This function is not implemented.");
+}
+
+void SuperCapacitor1D::evolve_one_time_step_linear_current(
+    double const time_step, double const current)
+{
+  // TODO: this is a temporary solution
+  evolve_one_time_step_constant_current(time_step, current);
+}
+
+void SuperCapacitor1D::evolve_one_time_step_linear_voltage(
+    double const time_step, double const voltage)
+{
+  // TODO: this is a temporary solution
+  evolve_one_time_step_constant_voltage(time_step, voltage);
+}
+
+void SuperCapacitor1D::evolve_one_time_step_linear_power(
+    double const time_step, double const power)
+{
+  // TODO: this is a temporary solution
+  evolve_one_time_step_constant_power(time_step, power);
+}
+
+void SuperCapacitor1D::evolve_one_time_step_linear_load(double const,
+                                                        double const)
+{
+  throw std::runtime_error("This function is not implemented.");
+}
+
+void SuperCapacitor1D::assemble_system(
+    double const time_step, SuperCapacitorState const supercapacitor_state)
+{
+  unsigned int const n_dofs = solution.size();
+  mass_matrix.assign(n_dofs * stride, 0.);
+  system_matrix.assign(n_dofs * stride, 0.);
+  for (unsigned int cell = 0; cell < n_cells(); ++cell)
+  {
+    double const h = widths[cell];
+    double const mass[2][2] = {{h / 3., h / 6.}, {h / 6., h / 3.}};
+    double const stiffness[2][2] = {{1. / h, -1. / h}, {-1. / h, 1. / h}};
+    for (unsigned int a = 0; a < 2; ++a)
+      for (unsigned int b = 0; b < 2; ++b)
+      {
+        unsigned int const solid_i = 2 * (cell + a);
+        unsigned int const liquid_i = solid_i + 1;
+        unsigned int const solid_j = 2 * (cell + b);
+        unsigned int const liquid_j = solid_j + 1;
+        // The capacitance and the faradaic reaction couple the difference of
+        // the potentials.
+        double const capacitance = specific_capacitance[cell] * mass[a][b];
+        double const reaction =
+            time_step * faradaic_reaction_coefficient[cell] * mass[a][b];
+        add(mass_matrix, solid_i, solid_j, capacitance);
+        add(mass_matrix, solid_i, liquid_j, -capacitance);
+        add(mass_matrix, liquid_i, solid_j, -capacitance);
+        add(mass_matrix, liquid_i, liquid_j, capacitance);
+        add(system_matrix, solid_i, solid_j,
+            capacitance + reaction +
+                time_step * solid_conductivity[cell] * stiffness[a][b]);
+        add(system_matrix, solid_i, liquid_j, -capacitance - reaction);
+        add(system_matrix, liquid_i, solid_j, -capacitance - reaction);
+        add(system_matrix, liquid_i, liquid_j,
+            capacitance + reaction +
+                time_step * liquid_conductivity[cell] * stiffness[a][b]);
+      }
+  }
+
+  // The liquid potential in the collectors and the solid potential in the
+  // separator do not have any coupling.
+  for (unsigned int i = 0; i < n_dofs; ++i)
+    if (system_matrix[i * stride] == 0.)
+      system_matrix[i * stride] = 1.;
+
+  // Eliminate the Dirichlet boundary conditions symmetrically. The solid
+  // potential on the anode is zero. When the voltage is imposed, the column of
+  // the solid potential on the cathode is saved to lift the boundary
+  // condition.
+  std::vector<unsigned int> constrained_dofs(1, 0);
+  unsigned int const cathode_dof = 2 * n_cells();
+  lifting.assign(n_dofs, 0.);
+  if (supercapacitor_state == ConstantVoltage)
+  {
+    constrained_dofs.push_back(cathode_dof);
+    for (unsigned int k = 1; (k <= bandwidth) && (k <= cathode_dof); ++k)
+      lifting[cathode_dof - k] = system_matrix[cathode_dof * stride + k];
+    for (unsigned int k = 1; (k <= bandwidth) && (cathode_dof + k < n_dofs);
+         ++k)
+      lifting[cathode_dof + k] = system_matrix[(cathode_dof + k) * stride + k];
+  }
+  for (unsigned int const dof : constrained_dofs)
+  {
+    for (unsigned int k = 1; (k <= bandwidth) && (k <= dof); ++k)
+      system_matrix[dof * stride + k] = 0.;
+    for (unsigned int k = 1; (k <= bandwidth) && (dof + k < n_dofs); ++k)
+      system_matrix[(dof + k) * stride + k] = 0.;
+    system_matrix[dof * stride] = 1.;
+  }
+
+  factorize(system_matrix);
+  factorized_time_step = time_step;
+  factorized_state = supercapacitor_state;
+}
+
+void SuperCapacitor1D::evolve_one_time_step(
+    double const time_step, SuperCapacitorState const supercapacitor_state,
+    double const value)
+{
+  if ((time_step != factorized_time_step) ||
+      (supercapacitor_state != factorized_state))
+    assemble_system(time_step, supercapacitor_state);
+
+  unsigned int const cathode_dof = 2 * n_cells();
+  vmult(mass_matrix, solution, rhs);
+  rhs[0] = 0.;
+  if (supercapacitor_state == ConstantCurrent)
+    rhs[cathode_dof] += time_step * value / area;
+  else
+  {
+    for (unsigned int i = 0; i < rhs.size(); ++i)
+      rhs[i] -= lifting[i] * value;
+    rhs[cathode_dof] = value;
+  }
+  solve(system_matrix, rhs);
+  solution.swap(rhs);
+
+  voltage = solution[cathode_dof];
+  if (supercapacitor_state == ConstantCurrent)
+    current = value;
+  else
+    current = area * solid_conductivity.back() *
+              (solution[cathode_dof] - solution[cathode_dof - 2]) /
+              widths.back();
+}
+
+} // end namespace cap
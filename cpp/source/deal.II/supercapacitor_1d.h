@@ -0,0 +1,154 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_DEAL_II_SUPERCAPACITOR_1D_H
+#define CAP_DEAL_II_SUPERCAPACITOR_1D_H
+
+#include <cap/energy_storage_device.h>
+#include <cap/electrochemical_physics.h>
+#include <string>
+#include <vector>
+
+namespace cap
+{
+/**
+ * Pseudo one-dimensional supercapacitor. Only the through-thickness direction
+ * of the device is discretized: collector | anode | separator | cathode |
+ * collector. The equations, the material properties, and the input database
+ * are the same as for SuperCapacitor<2> and SuperCapacitor<3> but the
+ * potentials are assumed to be uniform in the plane of the electrodes and the
+ * currents are scaled by the geometric area. The system is discretized with
+ * linear finite elements and the two potentials of a node are numbered
+ * consecutively, so the matrix is banded and it is factorized once with a
+ * banded Cholesky decomposition. The factorization is reused as long as the
+ * time step and the type of boundary condition do not change.
+ *
+ * The device is built by the SuperCapacitor builder when dim is 1. Only the
+ * "mesh_generator" geometry type is supported and only the first value of the
+ * divisions of each component is used. Stacks, i.e. n_repetitions larger than
+ * zero, require exploit_symmetry. The device is not supported by
+ * DefaultInspector, SolverStatisticsInspector, and estimate_memory_footprint;
+ * MemoryFootprintInspector only reports the peak resident set size.
+ */
+class SuperCapacitor1D : public EnergyStorageDevice
+{
+public:
+  SuperCapacitor1D(boost::property_tree::ptree const &ptree,
+                   boost::mpi::communicator const &comm);
+
+  void inspect(EnergyStorageDeviceInspector *inspector) override;
+
+  void get_voltage(double &voltage) const override;
+
+  void get_current(double &current) const override;
+
+  void evolve_one_time_step_constant_current(double const time_step,
+                                             double const current) override;
+
+  void evolve_one_time_step_constant_voltage(double const time_step,
+                                             double const voltage) override;
+
+  void evolve_one_time_step_constant_power(double const time_step,
+                                           double const power) override;
+
+  /**
+   * This function is not implemented and throws an exception.
+   */
+  void evolve_one_time_step_constant_load(double const time_step,
+                                          double const load) override;
+
+  void evolve_one_time_step_linear_current(double const time_step,
+                                           double const current) override;
+
+  void evolve_one_time_step_linear_voltage(double const time_step,
+                                           double const voltage) override;
+
+  void evolve_one_time_step_linear_power(double const time_step,
+                                         double const power) override;
+
+  /**
+   * This function is not implemented and throws an exception.
+   */
+  void evolve_one_time_step_linear_load(double const time_step,
+                                        double const load) override;
+
+  /**
+   * Return the number of cells in the through-thickness direction.
+   */
+  unsigned int n_cells() const;
+
+  /**
+   * Return the solid and the liquid potentials at the nodes. The entry 2i is
+   * the solid potential and the entry 2i+1 the liquid potential of the node i.
+   */
+  std::vector<double> const &get_solution() const;
+
+private:
+  /**
+   * Read the widths of the cells from the geometry database and return the
+   * name of the material of each cell.
+   */
+  std::vector<std::string>
+  build_cells(boost::property_tree::ptree const &geometry_database);
+
+  /**
+   * Read the material properties of each cell.
+   */
+  void
+  build_material_properties(boost::property_tree::ptree const &ptree,
+                            std::vector<std::string> const &cell_materials);
+
+  /**
+   * Assemble the mass matrix and the system matrix and factorize the latter.
+   */
+  void assemble_system(double const time_step,
+                       SuperCapacitorState const supercapacitor_state);
+
+  /**
+   * Advance time by @p time_step seconds. @p value is the current when
+   * @p supercapacitor_state is ConstantCurrent and the voltage when it is
+   * ConstantVoltage.
+   */
+  void evolve_one_time_step(double const time_step,
+                            SuperCapacitorState const supercapacitor_state,
+                            double const value);
+
+  /**
+   * Geometric area of the electrodes of all the units of the stack in square
+   * meters.
+   */
+  double area;
+  /**
+   * Width, specific capacitance, solid and liquid conductivity, and faradaic
+   * reaction coefficient of each cell.
+   */
+  std::vector<double> widths;
+  std::vector<double> specific_capacitance;
+  std::vector<double> solid_conductivity;
+  std::vector<double> liquid_conductivity;
+  std::vector<double> faradaic_reaction_coefficient;
+  /**
+   * Lower band of the mass matrix and of the Cholesky factor of the system
+   * matrix. The entry (i, j), j <= i, is stored at i * (bandwidth + 1) + i - j.
+   */
+  std::vector<double> mass_matrix;
+  std::vector<double> system_matrix;
+  /**
+   * Entries of the system matrix in the column of the solid potential on the
+   * cathode. They are used to lift the Dirichlet boundary condition.
+   */
+  std::vector<double> lifting;
+  std::vector<double> solution;
+  std::vector<double> rhs;
+  double factorized_time_step;
+  SuperCapacitorState factorized_state;
+  double voltage;
+  double current;
+};
+}
+
+#endif
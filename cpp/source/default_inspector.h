@@ -13,6 +13,12 @@
 namespace cap
 {
 
+/**
+ * This inspector copies the surface areas, the masses of active material, the
+ * number of dofs, and a few geometric and material properties of a
+ * SuperCapacitor<2> or SuperCapacitor<3>. The data of the other devices,
+ * including the pseudo-1D SuperCapacitor (dim=1), is left empty.
+ */
 class DefaultInspector : public EnergyStorageDeviceInspector
 {
 public:
@@ -24,6 +24,13 @@ class EnergyStorageDeviceInspector;
  * This class is an abstract representation of an energy storage device. It can
  * evolve in time at various operating conditions and return the voltage drop
  * across itself and the electrical current that flows through it.
+ *
+ * Different devices can be built and evolved concurrently by different
+ * threads: the devices do not share any mutable state, and the TimerRegistry
+ * and the TraceRecorder are thread safe. A device must not be used by two
+ * threads at the same time. The devices that communicate, e.g.
+ * SuperCapacitor, need a different communicator per thread and MPI
+ * initialized with MPI_THREAD_MULTIPLE.
  */
 class EnergyStorageDevice
 {
@@ -0,0 +1,168 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <cap/hardware_counters.h>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cap
+{
+#ifdef __linux__
+namespace
+{
+// Return the file descriptor of the counter or -1 if it is not available. The
+// counter joins the group of @p group_fd, or leads a new group if it is -1.
+int open_counter(std::uint64_t const config, int const group_fd)
+{
+  perf_event_attr attributes;
+  std::memset(&attributes, 0, sizeof(attributes));
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.size = sizeof(attributes);
+  attributes.config = config;
+  // The group is started by its leader.
+  attributes.disabled = (group_fd < 0) ? 1 : 0;
+  // The threads created by the calling thread are not counted. With inherit
+  // set, their events would only be added when they exit, i.e., to whatever
+  // section is running at that time.
+  attributes.inherit = 0;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+  // Count the calling thread on any CPU.
+  int const fd = static_cast<int>(
+      syscall(__NR_perf_event_open, &attributes, 0, -1, group_fd, 0));
+  return (fd < 0) ? -1 : fd;
+}
+}
+
+HardwareCounters::HardwareCounters() : _group_leader(-1)
+{
+  // The counters are opened as a single group so that the kernel schedules
+  // them together: when the events are multiplexed, they are all counted over
+  // the same time and ratios such as the instructions per cycle are
+  // consistent. If a counter is not available, the next one leads the group.
+  std::array<std::uint64_t, n_counters> const configs = {
+      {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+       PERF_COUNT_HW_CACHE_MISSES}};
+  for (unsigned int i = 0; i < n_counters; ++i)
+  {
+    _file_descriptors[i] = open_counter(configs[i], _group_leader);
+    if ((_group_leader < 0) && (_file_descriptors[i] >= 0))
+      _group_leader = _file_descriptors[i];
+  }
+  if ((_group_leader >= 0) &&
+      ((ioctl(_group_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) != 0) ||
+       (ioctl(_group_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) !=
+        0)))
+  {
+    for (int &fd : _file_descriptors)
+      if (fd >= 0)
+      {
+        close(fd);
+        fd = -1;
+      }
+    _group_leader = -1;
+  }
+}
+
+HardwareCounters::~HardwareCounters()
+{
+  for (int const fd : _file_descriptors)
+    if (fd >= 0)
+      close(fd);
+}
+
+HardwareCounters::Values HardwareCounters::read() const
+{
+  Values values;
+  values.fill(std::numeric_limits<double>::quiet_NaN());
+  if (_group_leader < 0)
+    return values;
+  // The number of counters, the time enabled, the time running, and the
+  // values of the counters in the order in which they joined the group.
+  std::array<std::uint64_t, 3 + n_counters> buffer;
+  ssize_t const size = ::read(_group_leader, buffer.data(),
+                              buffer.size() * sizeof(std::uint64_t));
+  if ((size < static_cast<ssize_t>(3 * sizeof(std::uint64_t))) ||
+      (buffer[0] > n_counters) ||
+      (size < static_cast<ssize_t>((3 + buffer[0]) * sizeof(std::uint64_t))))
+    return values;
+  // The counters of the group are scheduled together, so a single scaling
+  // extrapolates all of them to the time enabled.
+  double const scaling =
+      (buffer[2] > 0) ? static_cast<double>(buffer[1]) /
+                            static_cast<double>(buffer[2])
+                      : 0.;
+  unsigned int position = 0;
+  for (unsigned int i = 0; i < n_counters; ++i)
+    if ((_file_descriptors[i] >= 0) && (position < buffer[0]))
+    {
+      values[i] = static_cast<double>(buffer[3 + position]) * scaling;
+      ++position;
+    }
+  return values;
+}
+
+unsigned int HardwareCounters::get_cache_line_size()
+{
+#ifdef _SC_LEVEL1_DCACHE_LINESIZE
+  long const size = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+  if (size > 0)
+    return static_cast<unsigned int>(size);
+#endif
+  return 64;
+}
+#else
+HardwareCounters::HardwareCounters() : _group_leader(-1)
+{
+  _file_descriptors.fill(-1);
+}
+
+HardwareCounters::~HardwareCounters() {}
+
+HardwareCounters::Values HardwareCounters::read() const
+{
+  Values values;
+  values.fill(std::numeric_limits<double>::quiet_NaN());
+  return values;
+}
+
+unsigned int HardwareCounters::get_cache_line_size() { return 64; }
+#endif
+
+bool HardwareCounters::is_available() const
+{
+  for (int const fd : _file_descriptors)
+    if (fd >= 0)
+      return true;
+  return false;
+}
+
+std::string HardwareCounters::get_name(Counter counter)
+{
+  switch (counter)
+  {
+  case cycles:
+    return "cycles";
+  case instructions:
+    return "instructions";
+  case llc_misses:
+    return "llc_misses";
+  default:
+    throw std::runtime_error("Invalid hardware counter");
+  }
+}
+}
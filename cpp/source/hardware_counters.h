@@ -0,0 +1,89 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_HARDWARE_COUNTERS_H
+#define CAP_HARDWARE_COUNTERS_H
+
+#include <array>
+#include <string>
+
+namespace cap
+{
+/**
+ * This class reads the hardware performance counters of the thread that
+ * constructs it, using the perf_event_open system call of Linux. The other
+ * threads, including the ones created by this thread, are not counted: each
+ * thread that needs its counters constructs its own object. Only the
+ * user-space events are counted. The counters are:
+ *   - cycles: the number of CPU cycles,
+ *   - instructions: the number of instructions retired,
+ *   - llc_misses: the number of misses of the last-level cache.
+ * The traffic to the memory can be estimated by multiplying the number of
+ * misses of the last-level cache by the size of a cache line.
+ *
+ * A counter is unavailable if the kernel or the CPU does not support it, if
+ * the system call is forbidden (e.g. in a container or when
+ * /proc/sys/kernel/perf_event_paranoid is too high), or on other operating
+ * systems. The value of an unavailable counter is NaN.
+ */
+class HardwareCounters
+{
+public:
+  enum Counter
+  {
+    cycles,
+    instructions,
+    llc_misses,
+    n_counters
+  };
+
+  using Values = std::array<double, n_counters>;
+
+  /**
+   * Open and start the counters.
+   */
+  HardwareCounters();
+
+  /**
+   * Close the counters.
+   */
+  ~HardwareCounters();
+
+  HardwareCounters(HardwareCounters const &) = delete;
+
+  HardwareCounters &operator=(HardwareCounters const &) = delete;
+
+  /**
+   * Return true if at least one of the counters is available.
+   */
+  bool is_available() const;
+
+  /**
+   * Return the values of the counters since the construction of the object.
+   * The counters are read together as a single group. When the CPU has fewer
+   * counters than the events, the kernel multiplexes the group as a whole and
+   * the values are extrapolated to the whole time.
+   */
+  Values read() const;
+
+  /**
+   * Return the name of the counter @p counter, e.g. "llc_misses".
+   */
+  static std::string get_name(Counter counter);
+
+  /**
+   * Return the size of a cache line in bytes.
+   */
+  static unsigned int get_cache_line_size();
+
+private:
+  std::array<int, n_counters> _file_descriptors;
+  int _group_leader;
+};
+}
+
+#endif
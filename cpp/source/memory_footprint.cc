@@ -0,0 +1,110 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <cap/memory_footprint.h>
+#include <cap/supercapacitor.h>
+#include <sys/resource.h>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+namespace cap
+{
+namespace
+{
+// Every processor must have the same components.
+std::map<std::string, MemoryStatistics>
+reduce_memory(std::map<std::string, std::size_t> const &memory,
+              boost::mpi::communicator const &communicator)
+{
+  std::vector<std::size_t> values;
+  for (auto const &component : memory)
+    values.push_back(component.second);
+  std::vector<std::size_t> min_values(values.size());
+  std::vector<std::size_t> max_values(values.size());
+  std::vector<std::size_t> sum_values(values.size());
+  boost::mpi::all_reduce(communicator, values.data(), values.size(),
+                         min_values.data(),
+                         boost::mpi::minimum<std::size_t>());
+  boost::mpi::all_reduce(communicator, values.data(), values.size(),
+                         max_values.data(),
+                         boost::mpi::maximum<std::size_t>());
+  boost::mpi::all_reduce(communicator, values.data(), values.size(),
+                         sum_values.data(), std::plus<std::size_t>());
+
+  std::map<std::string, MemoryStatistics> footprint;
+  unsigned int i = 0;
+  for (auto const &component : memory)
+  {
+    footprint[component.first] =
+        MemoryStatistics{min_values[i], max_values[i], sum_values[i]};
+    ++i;
+  }
+  return footprint;
+}
+
+void add_total(std::map<std::string, std::size_t> &memory)
+{
+  std::size_t total = 0;
+  for (auto const &component : memory)
+    total += component.second;
+  memory["total"] = total;
+}
+}
+
+void MemoryFootprintInspector::inspect(EnergyStorageDevice *device)
+{
+  std::map<std::string, std::size_t> memory;
+  if (auto supercapacitor_2d = dynamic_cast<SuperCapacitor<2> *>(device))
+  {
+    memory = supercapacitor_2d->get_memory_consumption();
+    add_total(memory);
+  }
+  else if (auto supercapacitor_3d = dynamic_cast<SuperCapacitor<3> *>(device))
+  {
+    memory = supercapacitor_3d->get_memory_consumption();
+    add_total(memory);
+  }
+  memory["peak_resident_set_size"] = get_peak_resident_set_size();
+  _footprint = reduce_memory(memory, device->get_mpi_communicator());
+}
+
+std::map<std::string, MemoryStatistics> const &
+MemoryFootprintInspector::get_footprint() const
+{
+  return _footprint;
+}
+
+std::map<std::string, MemoryStatistics>
+estimate_memory_footprint(boost::property_tree::ptree const &ptree,
+                          boost::mpi::communicator const &comm)
+{
+  std::map<std::string, std::size_t> memory;
+  int const dim = ptree.get<int>("dim");
+  if (dim == 2)
+    memory = SuperCapacitor<2>::estimate_memory_consumption(ptree, comm);
+  else if (dim == 3)
+    memory = SuperCapacitor<3>::estimate_memory_consumption(ptree, comm);
+  else
+    throw std::runtime_error("The memory footprint can only be estimated "
+                             "for dim=2 or dim=3");
+  add_total(memory);
+  return reduce_memory(memory, comm);
+}
+
+std::size_t get_peak_resident_set_size()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+// ru_maxrss is in bytes on macOS and in kilobytes on Linux.
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024;
+#endif
+}
+}
@@ -0,0 +1,69 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_MEMORY_FOOTPRINT_H
+#define CAP_MEMORY_FOOTPRINT_H
+
+#include <cap/energy_storage_device.h>
+#include <boost/mpi.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <map>
+#include <string>
+
+namespace cap
+{
+/**
+ * Memory used by a component of a device in bytes, reduced over the
+ * processors.
+ */
+struct MemoryStatistics
+{
+  std::size_t min;
+  std::size_t max;
+  std::size_t total;
+};
+
+/**
+ * This inspector collects the memory consumption of the components of a
+ * SuperCapacitor (see SuperCapacitor::get_memory_consumption) and reduces it
+ * over the processors of the device. The footprint also contains the sum of
+ * the components, "total", and the peak resident set size of the processes,
+ * "peak_resident_set_size", which includes the memory not accounted for by
+ * the components, e.g. the MPI buffers. The other devices, including the
+ * pseudo-1D SuperCapacitor (dim=1), only report the peak resident set size.
+ * This inspector is collective.
+ */
+class MemoryFootprintInspector : public EnergyStorageDeviceInspector
+{
+public:
+  void inspect(EnergyStorageDevice *device) override;
+
+  std::map<std::string, MemoryStatistics> const &get_footprint() const;
+
+private:
+  std::map<std::string, MemoryStatistics> _footprint;
+};
+
+/**
+ * Estimate the memory footprint of a SuperCapacitor built from @p ptree on
+ * the processors of @p comm without building it (see
+ * SuperCapacitor::estimate_memory_consumption). The footprint contains the
+ * same components as the one of MemoryFootprintInspector except for the peak
+ * resident set size. The pseudo-1D SuperCapacitor (dim=1) is not supported
+ * and an exception is thrown. This function is collective.
+ */
+std::map<std::string, MemoryStatistics>
+estimate_memory_footprint(boost::property_tree::ptree const &ptree,
+                          boost::mpi::communicator const &comm);
+
+/**
+ * Return the peak resident set size of the calling process in bytes.
+ */
+std::size_t get_peak_resident_set_size();
+}
+
+#endif
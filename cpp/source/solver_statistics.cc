@@ -0,0 +1,29 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <cap/solver_statistics.h>
+#include <cap/supercapacitor.h>
+
+namespace cap
+{
+void SolverStatisticsInspector::inspect(EnergyStorageDevice *device)
+{
+  _statistics.clear();
+  if (auto supercapacitor_2d = dynamic_cast<SuperCapacitor<2> *>(device))
+    _statistics.assign(supercapacitor_2d->get_solver_statistics().begin(),
+                       supercapacitor_2d->get_solver_statistics().end());
+  else if (auto supercapacitor_3d = dynamic_cast<SuperCapacitor<3> *>(device))
+    _statistics.assign(supercapacitor_3d->get_solver_statistics().begin(),
+                       supercapacitor_3d->get_solver_statistics().end());
+}
+
+std::vector<SolverStatistics> const &
+SolverStatisticsInspector::get_statistics() const
+{
+  return _statistics;
+}
+}
@@ -0,0 +1,63 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_SOLVER_STATISTICS_H
+#define CAP_SOLVER_STATISTICS_H
+
+#include <cap/energy_storage_device.h>
+#include <vector>
+
+namespace cap
+{
+/**
+ * Statistics of one solve of the linear system of a time step. The residuals
+ * are the l2 norms of the residual of the Krylov solver before the first and
+ * after the last iteration. With the mixed precision solver, they are the
+ * residuals of the first and the last refinement step and the number of
+ * iterations is the total of the inner solves. The times are wall-clock times
+ * in seconds.
+ */
+struct SolverStatistics
+{
+  /**
+   * Number of time steps taken by the device, including the current one.
+   */
+  unsigned int step;
+  unsigned int n_iterations;
+  double initial_residual;
+  double final_residual;
+  /**
+   * True if the system, or the matrix-free operator, was rebuilt because the
+   * time step, the boundary condition, or the mesh changed.
+   */
+  bool rebuilt_operator;
+  bool rebuilt_preconditioner;
+  double assembly_time;
+  double solve_time;
+  double postprocess_time;
+};
+
+/**
+ * This inspector copies the statistics of the last solves of a
+ * SuperCapacitor, from the oldest to the most recent. The number of solves
+ * kept by the device is given by solver.statistics_capacity in its database.
+ * The other devices, including the pseudo-1D SuperCapacitor (dim=1), which
+ * uses a direct solver, do not have statistics.
+ */
+class SolverStatisticsInspector : public EnergyStorageDeviceInspector
+{
+public:
+  void inspect(EnergyStorageDevice *device) override;
+
+  std::vector<SolverStatistics> const &get_statistics() const;
+
+private:
+  std::vector<SolverStatistics> _statistics;
+};
+}
+
+#endif
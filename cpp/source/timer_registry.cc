@@ -0,0 +1,417 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <cap/timer_registry.h>
+#include <boost/assert.hpp>
+#include <boost/chrono/include.hpp>
+#include <boost/format.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <set>
+#include <stdexcept>
+
+namespace cap
+{
+namespace
+{
+// Paths and starting times of the running sections of a thread. The last one
+// is the current section. The hardware counters are opened by the first
+// section entered by the thread once they are enabled. They are closed when
+// the thread has no running section and the counters have been enabled or
+// disabled since they were opened, i.e., when hardware_counters_generation
+// differs from the one of the registry.
+struct RunningSections
+{
+  std::vector<std::string> paths;
+  std::vector<std::chrono::steady_clock::time_point> wall_starts;
+  std::vector<boost::chrono::thread_clock::time_point> cpu_starts;
+  std::vector<HardwareCounters::Values> counter_starts;
+  std::unique_ptr<HardwareCounters> hardware_counters;
+  unsigned int hardware_counters_generation = 0;
+};
+
+RunningSections &get_running_sections()
+{
+  thread_local RunningSections running_sections;
+  return running_sections;
+}
+}
+
+TimerRegistry &TimerRegistry::instance()
+{
+  static TimerRegistry registry;
+  return registry;
+}
+
+TimerRegistry::TimerRegistry()
+    : _hardware_counters(false), _hardware_counters_generation(0)
+{
+}
+
+void TimerRegistry::enter(std::string const &name)
+{
+  BOOST_ASSERT_MSG(name.find('/') == std::string::npos,
+                   "The name of a section cannot contain '/'.");
+  RunningSections &running = get_running_sections();
+  // Drop the counters opened before the last call to
+  // enable_hardware_counters() or disable_hardware_counters().
+  if (running.paths.empty() &&
+      (running.hardware_counters_generation != _hardware_counters_generation))
+  {
+    running.hardware_counters.reset();
+    running.hardware_counters_generation = _hardware_counters_generation;
+  }
+  std::string const path =
+      running.paths.empty() ? name : running.paths.back() + "/" + name;
+  running.paths.push_back(path);
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    HardwareCounters::Values zero;
+    zero.fill(0.);
+    _sections.emplace(path, Section{0, 0., 0., zero});
+  }
+  // The counters are NaN when they are disabled.
+  HardwareCounters::Values counter_start;
+  counter_start.fill(std::numeric_limits<double>::quiet_NaN());
+  if (_hardware_counters)
+  {
+    if (!running.hardware_counters)
+      running.hardware_counters.reset(new HardwareCounters());
+    counter_start = running.hardware_counters->read();
+  }
+  running.counter_starts.push_back(counter_start);
+  running.cpu_starts.push_back(boost::chrono::thread_clock::now());
+  running.wall_starts.push_back(std::chrono::steady_clock::now());
+}
+
+double TimerRegistry::leave()
+{
+  std::chrono::steady_clock::time_point const wall_end =
+      std::chrono::steady_clock::now();
+  boost::chrono::thread_clock::time_point const cpu_end =
+      boost::chrono::thread_clock::now();
+  RunningSections &running = get_running_sections();
+  BOOST_ASSERT_MSG(!running.paths.empty(), "No section is running.");
+  // A call without the counters makes them NaN.
+  HardwareCounters::Values counters = running.counter_starts.back();
+  if (running.hardware_counters)
+  {
+    HardwareCounters::Values const counter_end =
+        running.hardware_counters->read();
+    for (unsigned int i = 0; i < HardwareCounters::n_counters; ++i)
+      counters[i] = counter_end[i] - counters[i];
+  }
+  double const wall_time =
+      std::chrono::duration<double>(wall_end - running.wall_starts.back())
+          .count();
+  double const cpu_time =
+      boost::chrono::duration<double>(cpu_end - running.cpu_starts.back())
+          .count();
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Section &section = _sections[running.paths.back()];
+    ++section.n_calls;
+    section.wall_time += wall_time;
+    section.cpu_time += cpu_time;
+    for (unsigned int i = 0; i < HardwareCounters::n_counters; ++i)
+      section.counters[i] += counters[i];
+  }
+
+  running.paths.pop_back();
+  running.wall_starts.pop_back();
+  running.cpu_starts.pop_back();
+  running.counter_starts.pop_back();
+  if (running.paths.empty() &&
+      (running.hardware_counters_generation != _hardware_counters_generation))
+    running.hardware_counters.reset();
+
+  return wall_time;
+}
+
+void TimerRegistry::reset()
+{
+  BOOST_ASSERT_MSG(get_running_sections().paths.empty(),
+                   "The registry cannot be reset while a section is running.");
+  std::lock_guard<std::mutex> lock(_mutex);
+  _sections.clear();
+}
+
+bool TimerRegistry::enable_hardware_counters()
+{
+  RunningSections &running = get_running_sections();
+  BOOST_ASSERT_MSG(running.paths.empty(), "The hardware counters cannot be "
+                                          "enabled while a section is "
+                                          "running.");
+  running.hardware_counters_generation = ++_hardware_counters_generation;
+  running.hardware_counters.reset(new HardwareCounters());
+  if (!running.hardware_counters->is_available())
+  {
+    running.hardware_counters.reset();
+    _hardware_counters = false;
+    return false;
+  }
+  _hardware_counters = true;
+  return true;
+}
+
+void TimerRegistry::disable_hardware_counters()
+{
+  RunningSections &running = get_running_sections();
+  BOOST_ASSERT_MSG(running.paths.empty(), "The hardware counters cannot be "
+                                          "disabled while a section is "
+                                          "running.");
+  // The other threads close their counters when they have no running
+  // section.
+  running.hardware_counters_generation = ++_hardware_counters_generation;
+  running.hardware_counters.reset();
+  _hardware_counters = false;
+}
+
+bool TimerRegistry::hardware_counters_enabled() const
+{
+  return _hardware_counters;
+}
+
+std::vector<std::string> TimerRegistry::get_paths() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::vector<std::string> paths;
+  for (auto const &section : _sections)
+    paths.push_back(section.first);
+  return paths;
+}
+
+TimerRegistry::Section TimerRegistry::get_section(std::string const &path) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto const section = _sections.find(path);
+  if (section == _sections.end())
+    throw std::runtime_error("The section " + path + " does not exist");
+  return section->second;
+}
+
+unsigned int TimerRegistry::get_n_calls(std::string const &path) const
+{
+  return get_section(path).n_calls;
+}
+
+double TimerRegistry::get_wall_time(std::string const &path) const
+{
+  return get_section(path).wall_time;
+}
+
+double TimerRegistry::get_cpu_time(std::string const &path) const
+{
+  return get_section(path).cpu_time;
+}
+
+double TimerRegistry::get_counter(std::string const &path,
+                                 HardwareCounters::Counter counter) const
+{
+  return get_section(path).counters[counter];
+}
+
+std::map<std::string, TimerStatistics>
+TimerRegistry::gather(boost::mpi::communicator const &communicator) const
+{
+  // The processors do not necessarily go through the same sections.
+  std::vector<std::vector<std::string>> all_paths;
+  boost::mpi::all_gather(communicator, get_paths(), all_paths);
+  std::set<std::string> path_set;
+  for (auto const &paths : all_paths)
+    path_set.insert(paths.begin(), paths.end());
+  std::vector<std::string> const paths(path_set.begin(), path_set.end());
+
+  // Reduce all the sections at once. The hardware counters are only summed.
+  unsigned int const n_sections = paths.size();
+  unsigned int const n_values = 3 + HardwareCounters::n_counters;
+  std::vector<double> values(n_values * n_sections, 0.);
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (unsigned int i = 0; i < n_sections; ++i)
+  {
+    auto const section = _sections.find(paths[i]);
+    if (section != _sections.end())
+    {
+      values[n_values * i] = section->second.n_calls;
+      values[n_values * i + 1] = section->second.wall_time;
+      values[n_values * i + 2] = section->second.cpu_time;
+      std::copy(section->second.counters.begin(),
+                section->second.counters.end(),
+                values.begin() + n_values * i + 3);
+    }
+  }
+  lock.unlock();
+  std::vector<double> min_values(values.size());
+  std::vector<double> max_values(values.size());
+  std::vector<double> sum_values(values.size());
+  boost::mpi::all_reduce(communicator, values.data(), values.size(),
+                         min_values.data(), boost::mpi::minimum<double>());
+  boost::mpi::all_reduce(communicator, values.data(), values.size(),
+                         max_values.data(), boost::mpi::maximum<double>());
+  boost::mpi::all_reduce(communicator, values.data(), values.size(),
+                         sum_values.data(), std::plus<double>());
+
+  std::map<std::string, TimerStatistics> statistics;
+  double const n_processors = communicator.size();
+  for (unsigned int i = 0; i < n_sections; ++i)
+  {
+    TimerStatistics &section_statistics = statistics[paths[i]];
+    section_statistics.n_calls =
+        static_cast<unsigned int>(max_values[n_values * i]);
+    section_statistics.min_wall_time = min_values[n_values * i + 1];
+    section_statistics.mean_wall_time =
+        sum_values[n_values * i + 1] / n_processors;
+    section_statistics.max_wall_time = max_values[n_values * i + 1];
+    section_statistics.min_cpu_time = min_values[n_values * i + 2];
+    section_statistics.mean_cpu_time =
+        sum_values[n_values * i + 2] / n_processors;
+    section_statistics.max_cpu_time = max_values[n_values * i + 2];
+    std::copy(sum_values.begin() + n_values * i + 3,
+              sum_values.begin() + n_values * (i + 1),
+              section_statistics.counters.begin());
+  }
+
+  return statistics;
+}
+
+namespace
+{
+// Return true if at least one of the hardware counters was read.
+bool has_counters(std::map<std::string, TimerStatistics> const &statistics)
+{
+  for (auto const &section : statistics)
+    for (double const value : section.second.counters)
+      if (std::isfinite(value))
+        return true;
+  return false;
+}
+
+// Format @p value or return "-" if it is NaN.
+std::string format_counter(char const *format, double const value)
+{
+  return std::isfinite(value) ? (boost::format(format) % value).str() : "-";
+}
+}
+
+void TimerRegistry::print(std::ostream &os,
+                          boost::mpi::communicator const &communicator) const
+{
+  std::map<std::string, TimerStatistics> const statistics =
+      gather(communicator);
+  if (communicator.rank() != 0)
+    return;
+
+  // The sections are sorted by path so the nested sections follow their
+  // parent. They are indented by their depth.
+  bool const counters = has_counters(statistics);
+  os << boost::format("%-32s %8s %12s %12s %12s %12s") % "Section" %
+            "Calls" % "Min wall" % "Mean wall" % "Max wall" % "Mean CPU";
+  if (counters)
+    os << boost::format(" %10s %10s %6s %10s %8s") % "Cycles" %
+              "Instr" % "IPC" % "LLC miss" % "GB/s";
+  os << "\n";
+  for (auto const &section : statistics)
+  {
+    std::string const &path = section.first;
+    std::size_t const depth = std::count(path.begin(), path.end(), '/');
+    std::size_t const name_begin = path.find_last_of('/');
+    std::string const name =
+        std::string(2 * depth, ' ') +
+        ((name_begin == std::string::npos) ? path
+                                           : path.substr(name_begin + 1));
+    TimerStatistics const &s = section.second;
+    os << boost::format("%-32s %8d %12.4f %12.4f %12.4f %12.4f") % name %
+              s.n_calls % s.min_wall_time % s.mean_wall_time %
+              s.max_wall_time % s.mean_cpu_time;
+    if (counters)
+    {
+      // The bandwidth is the traffic of all the processors over the longest
+      // time.
+      double const cycles = s.counters[HardwareCounters::cycles];
+      double const instructions = s.counters[HardwareCounters::instructions];
+      double const llc_misses = s.counters[HardwareCounters::llc_misses];
+      double const bandwidth =
+          s.max_wall_time > 0.
+              ? llc_misses * HardwareCounters::get_cache_line_size() /
+                    s.max_wall_time * 1e-9
+              : std::numeric_limits<double>::quiet_NaN();
+      os << boost::format(" %10s %10s %6s %10s %8s") %
+                format_counter("%.3e", cycles) %
+                format_counter("%.3e", instructions) %
+                format_counter("%.2f", instructions / cycles) %
+                format_counter("%.3e", llc_misses) %
+                format_counter("%.2f", bandwidth);
+    }
+    os << "\n";
+  }
+}
+
+void TimerRegistry::write_json(
+    std::ostream &os, boost::mpi::communicator const &communicator) const
+{
+  std::map<std::string, TimerStatistics> const statistics =
+      gather(communicator);
+  if (communicator.rank() != 0)
+    return;
+
+  // The counters are only written if they were read. NaN is written as null.
+  bool const counters = has_counters(statistics);
+  os << "{";
+  bool first = true;
+  for (auto const &section : statistics)
+  {
+    TimerStatistics const &s = section.second;
+    os << (first ? "\n" : ",\n");
+    first = false;
+    os << boost::format("  \"%s\": {\"calls\": %d, "
+                        "\"wall_time\": {\"min\": %.9e, \"mean\": %.9e, "
+                        "\"max\": %.9e}, "
+                        "\"cpu_time\": {\"min\": %.9e, \"mean\": %.9e, "
+                        "\"max\": %.9e}") %
+              section.first % s.n_calls % s.min_wall_time %
+              s.mean_wall_time % s.max_wall_time % s.min_cpu_time %
+              s.mean_cpu_time % s.max_cpu_time;
+    if (counters)
+    {
+      os << ", \"counters\": {";
+      for (unsigned int i = 0; i < HardwareCounters::n_counters; ++i)
+        os << (i == 0 ? "" : ", ") << "\""
+           << HardwareCounters::get_name(
+                  static_cast<HardwareCounters::Counter>(i))
+           << "\": "
+           << (std::isfinite(s.counters[i])
+                   ? (boost::format("%.9e") % s.counters[i]).str()
+                   : "null");
+      os << "}";
+    }
+    os << "}";
+  }
+  os << "\n}\n";
+}
+
+ScopedTimer::ScopedTimer(std::string const &name) : _running(true)
+{
+  TimerRegistry::instance().enter(name);
+}
+
+ScopedTimer::~ScopedTimer() { stop(); }
+
+double ScopedTimer::stop()
+{
+  if (!_running)
+    return 0.;
+  _running = false;
+  return TimerRegistry::instance().leave();
+}
+}
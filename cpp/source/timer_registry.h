@@ -0,0 +1,224 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_TIMER_REGISTRY_H
+#define CAP_TIMER_REGISTRY_H
+
+#include <cap/hardware_counters.h>
+#include <boost/mpi.hpp>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace cap
+{
+/**
+ * Statistics of a section of the TimerRegistry over the processors. The times
+ * are in seconds. The number of calls is the maximum over the processors. The
+ * hardware counters are summed over the processors. They are NaN if they were
+ * not read during every call of the section on every processor.
+ */
+struct TimerStatistics
+{
+  unsigned int n_calls;
+  double min_wall_time;
+  double mean_wall_time;
+  double max_wall_time;
+  double min_cpu_time;
+  double mean_cpu_time;
+  double max_cpu_time;
+  HardwareCounters::Values counters;
+};
+
+/**
+ * This class records the wall-clock time, the CPU time, and the number of
+ * calls of nested sections of the code. A section is identified by its path,
+ * i.e., the names of the enclosing sections and its own name separated by
+ * '/', e.g. "setup/geometry". The CPU time is the time of the thread that
+ * runs the section, so it does not include the time of the threads that the
+ * section uses or of the other threads that run concurrently. Contrary to
+ * Timer, the time spent waiting in MPI calls is part of the wall-clock time
+ * and the statistics of all the processors are available through gather().
+ *
+ * Nothing is reported automatically, in particular not when a device is
+ * destroyed, since gathering the statistics is collective and the registry is
+ * shared by all the devices of the process. The application calls print(),
+ * write_json(), or gather() on every processor of the communicator when it
+ * wants a report.
+ *
+ * The hardware performance counters (cycles, instructions, and misses of the
+ * last-level cache) can also be read when entering and leaving the sections,
+ * see enable_hardware_counters(). Reading them costs a few system calls per
+ * section so they are disabled by default.
+ *
+ * There is one registry per process, which is returned by instance(). The
+ * registry is thread safe. Each thread has its own stack of running sections,
+ * so the sections of a thread are nested in the sections of the same thread
+ * only, and the sections with the same path in different threads are
+ * accumulated. The hardware counters of a section only count the thread that
+ * enters it.
+ */
+class TimerRegistry
+{
+public:
+  /**
+   * Return the registry of the process.
+   */
+  static TimerRegistry &instance();
+
+  /**
+   * Start the section @p name nested in the current section.
+   */
+  void enter(std::string const &name);
+
+  /**
+   * Stop the current section and return the wall-clock time in seconds spent
+   * in it since the matching call to enter().
+   */
+  double leave();
+
+  /**
+   * Remove all the sections. This function cannot be called while a section
+   * of the calling thread is running.
+   */
+  void reset();
+
+  /**
+   * Read the hardware counters in the sections entered from now on. Return
+   * false if none of the counters is available, e.g. in a container that
+   * forbids perf_event_open. The sections are still timed in that case. This
+   * function cannot be called while a section of the calling thread is
+   * running.
+   */
+  bool enable_hardware_counters();
+
+  /**
+   * Stop reading the hardware counters in all the threads. The counters of
+   * the other threads are closed the next time they have no running section.
+   * This function cannot be called while a section of the calling thread is
+   * running.
+   */
+  void disable_hardware_counters();
+
+  /**
+   * Return true if the hardware counters are read.
+   */
+  bool hardware_counters_enabled() const;
+
+  /**
+   * Return the paths of the sections recorded by this processor.
+   */
+  std::vector<std::string> get_paths() const;
+
+  /**
+   * Return the number of calls of the section @p path on this processor.
+   */
+  unsigned int get_n_calls(std::string const &path) const;
+
+  /**
+   * Return the wall-clock time in seconds spent in the section @p path on this
+   * processor.
+   */
+  double get_wall_time(std::string const &path) const;
+
+  /**
+   * Return the CPU time in seconds spent by the threads that ran the section
+   * @p path on this processor.
+   */
+  double get_cpu_time(std::string const &path) const;
+
+  /**
+   * Return the value of the hardware counter @p counter in the section @p path
+   * on this processor. The value is NaN if the counter is not available or if
+   * it was not read during every call of the section.
+   */
+  double get_counter(std::string const &path,
+                     HardwareCounters::Counter counter) const;
+
+  /**
+   * Return the statistics of all the sections recorded by at least one of the
+   * processors of @p communicator. A processor that did not record a section
+   * contributes zero. This function is collective.
+   */
+  std::map<std::string, TimerStatistics>
+  gather(boost::mpi::communicator const &communicator) const;
+
+  /**
+   * Output a table with the statistics of all the sections on the rank 0
+   * process. When the hardware counters were read, the table also shows the
+   * total number of cycles, of instructions, and of misses of the last-level
+   * cache, the instructions per cycle, and the memory bandwidth in GB/s
+   * estimated from the cache misses. This function is collective.
+   */
+  void print(std::ostream &os,
+             boost::mpi::communicator const &communicator) const;
+
+  /**
+   * Output the statistics of all the sections in JSON format on the rank 0
+   * process. This function is collective.
+   */
+  void write_json(std::ostream &os,
+                  boost::mpi::communicator const &communicator) const;
+
+private:
+  TimerRegistry();
+
+  struct Section
+  {
+    unsigned int n_calls;
+    double wall_time;
+    double cpu_time;
+    HardwareCounters::Values counters;
+  };
+
+  Section get_section(std::string const &path) const;
+
+  std::map<std::string, Section> _sections;
+  /**
+   * The running sections are stored per thread in timer_registry.cc.
+   */
+  std::atomic<bool> _hardware_counters;
+  /**
+   * Incremented by enable_hardware_counters() and
+   * disable_hardware_counters() so that the threads reopen or close their
+   * counters.
+   */
+  std::atomic<unsigned int> _hardware_counters_generation;
+  mutable std::mutex _mutex;
+};
+
+/**
+ * Time the section @p name of the TimerRegistry from the construction of the
+ * object until stop() is called or the object is destroyed.
+ */
+class ScopedTimer
+{
+public:
+  ScopedTimer(std::string const &name);
+
+  ~ScopedTimer();
+
+  ScopedTimer(ScopedTimer const &) = delete;
+
+  ScopedTimer &operator=(ScopedTimer const &) = delete;
+
+  /**
+   * Stop the section before the end of the scope and return the wall-clock
+   * time in seconds spent in it. Return zero if the section has already been
+   * stopped.
+   */
+  double stop();
+
+private:
+  bool _running;
+};
+}
+
+#endif
@@ -0,0 +1,118 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#include <cap/trace.h>
+#include <boost/format.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#include <sstream>
+#include <string>
+
+namespace cap
+{
+namespace
+{
+// The threads are numbered in the order in which they record their first
+// event.
+unsigned int get_thread_index()
+{
+  static std::atomic<unsigned int> n_threads(0);
+  thread_local unsigned int const thread_index = n_threads++;
+  return thread_index;
+}
+}
+
+TraceRecorder &TraceRecorder::instance()
+{
+  static TraceRecorder recorder;
+  return recorder;
+}
+
+TraceRecorder::TraceRecorder()
+    : _recording(false), _origin(std::chrono::steady_clock::now())
+{
+}
+
+void TraceRecorder::start(boost::mpi::communicator const &communicator)
+{
+  communicator.barrier();
+  std::lock_guard<std::mutex> lock(_mutex);
+  _events.clear();
+  _origin = std::chrono::steady_clock::now();
+  _recording = true;
+}
+
+void TraceRecorder::stop() { _recording = false; }
+
+bool TraceRecorder::is_recording() const { return _recording; }
+
+unsigned int TraceRecorder::get_n_events() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _events.size();
+}
+
+void TraceRecorder::record(char const *name,
+                           std::chrono::steady_clock::time_point const &begin,
+                           std::chrono::steady_clock::time_point const &end)
+{
+  unsigned int const thread = get_thread_index();
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (!_recording)
+    return;
+  // The times of the trace event format are in microseconds.
+  _events.push_back(
+      Event{name, thread,
+            std::chrono::duration<double, std::micro>(begin - _origin).count(),
+            std::chrono::duration<double, std::micro>(end - begin).count()});
+}
+
+void TraceRecorder::write(std::ostream &os,
+                          boost::mpi::communicator const &communicator) const
+{
+  int const rank = communicator.rank();
+  std::ostringstream local_events;
+  local_events << boost::format("    {\"name\": \"process_name\", \"ph\": "
+                                "\"M\", \"pid\": %d, \"args\": {\"name\": "
+                                "\"rank %d\"}}") %
+                      rank % rank;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto const &event : _events)
+      local_events << boost::format(",\n    {\"name\": \"%s\", \"cat\": "
+                                    "\"cap\", \"ph\": \"X\", \"ts\": %.3f, "
+                                    "\"dur\": %.3f, \"pid\": %d, \"tid\": "
+                                    "%d}") %
+                          event.name % event.begin % event.duration % rank %
+                          event.thread;
+  }
+
+  std::vector<std::string> all_events;
+  boost::mpi::gather(communicator, local_events.str(), all_events, 0);
+  if (rank != 0)
+    return;
+
+  os << "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [\n";
+  for (unsigned int i = 0; i < all_events.size(); ++i)
+    os << (i == 0 ? "" : ",\n") << all_events[i];
+  os << "\n  ]\n}\n";
+}
+
+TraceScope::TraceScope(char const *name)
+    : _name(name), _recording(TraceRecorder::instance().is_recording())
+{
+  if (_recording)
+    _begin = std::chrono::steady_clock::now();
+}
+
+TraceScope::~TraceScope()
+{
+  if (_recording)
+    TraceRecorder::instance().record(_name, _begin,
+                                     std::chrono::steady_clock::now());
+}
+}
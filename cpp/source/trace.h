@@ -0,0 +1,128 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#ifndef CAP_TRACE_H
+#define CAP_TRACE_H
+
+#include <boost/mpi.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace cap
+{
+/**
+ * This class records the beginning and the duration of the scopes annotated
+ * with CAP_TRACE_SCOPE and writes them in the Chrome trace event format. The
+ * trace can be opened with chrome://tracing or https://ui.perfetto.dev. Each
+ * processor is shown as a process and each thread of a processor as a thread
+ * of this process. The time spent waiting in MPI calls is part of the
+ * enclosing scope.
+ *
+ * There is one recorder per process, which is returned by instance(). Nothing
+ * is recorded until start() is called. The annotations compile to nothing
+ * unless Cap is configured with ENABLE_TRACING=ON. Otherwise, the trace only
+ * contains the events of the TraceScope objects created explicitly.
+ */
+class TraceRecorder
+{
+public:
+  /**
+   * Return the recorder of the process.
+   */
+  static TraceRecorder &instance();
+
+  /**
+   * Remove the events recorded so far and start recording. The origin of the
+   * time is synchronized over the processors of @p communicator. This
+   * function is collective.
+   */
+  void start(boost::mpi::communicator const &communicator);
+
+  /**
+   * Stop recording. The events recorded so far are kept.
+   */
+  void stop();
+
+  bool is_recording() const;
+
+  /**
+   * Return the number of events recorded by this processor.
+   */
+  unsigned int get_n_events() const;
+
+  /**
+   * Record the event @p name of the calling thread. @p name must outlive the
+   * recorder, e.g. it can be a string literal.
+   */
+  void record(char const *name,
+              std::chrono::steady_clock::time_point const &begin,
+              std::chrono::steady_clock::time_point const &end);
+
+  /**
+   * Output the events of all the processors of @p communicator in JSON format
+   * on the rank 0 process. This function is collective.
+   */
+  void write(std::ostream &os,
+             boost::mpi::communicator const &communicator) const;
+
+private:
+  TraceRecorder();
+
+  struct Event
+  {
+    char const *name;
+    unsigned int thread;
+    double begin;
+    double duration;
+  };
+
+  std::atomic<bool> _recording;
+  std::chrono::steady_clock::time_point _origin;
+  std::vector<Event> _events;
+  mutable std::mutex _mutex;
+};
+
+/**
+ * Record the event @p name in the TraceRecorder from the construction of the
+ * object until its destruction. Use the macro CAP_TRACE_SCOPE instead of
+ * creating the object directly.
+ */
+class TraceScope
+{
+public:
+  TraceScope(char const *name);
+
+  ~TraceScope();
+
+  TraceScope(TraceScope const &) = delete;
+
+  TraceScope &operator=(TraceScope const &) = delete;
+
+private:
+  char const *_name;
+  bool _recording;
+  std::chrono::steady_clock::time_point _begin;
+};
+}
+
+#ifdef WITH_TRACING
+#define CAP_TRACE_CONCATENATE_IMPL(a, b) a##b
+#define CAP_TRACE_CONCATENATE(a, b) CAP_TRACE_CONCATENATE_IMPL(a, b)
+/**
+ * Record the enclosing scope under the name @p name, which must be a string
+ * literal.
+ */
+#define CAP_TRACE_SCOPE(name)                                                  \
+  ::cap::TraceScope CAP_TRACE_CONCATENATE(cap_trace_scope_, __LINE__)(name)
+#else
+#define CAP_TRACE_SCOPE(name) static_cast<void>(0)
+#endif
+
+#endif
@@ -5,9 +5,12 @@
  * for the text and further information on this license.
  */
 
-#define BOOST_TEST_MODULE ExactTransientSolution
-#define BOOST_TEST_MAIN
+#define BOOST_TEST_MODULE ConvergenceDischarge
+
+#include "main.cc"
+
 #include <cap/energy_storage_device.h>
+#include <cap/geometry.h>
 #include <cap/mp_values.h>
 #include <deal.II/base/types.h>
 #include <deal.II/grid/grid_generator.h>
@@ -19,7 +22,9 @@
 #include <boost/property_tree/info_parser.hpp>
 #include <boost/math/tools/roots.hpp>
 #include <boost/math/distributions/beta.hpp>
+#include <algorithm>
 #include <cmath>
+#include <complex>
 #include <iostream>
 #include <fstream>
 #include <numeric>
@@ -49,8 +54,12 @@ void compute_parameters(
   std::shared_ptr<boost::property_tree::ptree> geometry_database =
       std::make_shared<boost::property_tree::ptree>(
           input_database->get_child("geometry"));
-  mp_values_params.geometry =
-      std::make_shared<cap::DummyGeometry<2>>(geometry_database);
+  // The geometry is only used to look up the material ids.
+  std::shared_ptr<cap::Geometry<2>> geometry =
+      std::make_shared<cap::Geometry<2>>(
+          geometry_database,
+          boost::mpi::communicator(MPI_COMM_SELF, boost::mpi::comm_attach));
+  mp_values_params.geometry = geometry;
   std::shared_ptr<cap::MPValues<2>> mp_values =
       std::shared_ptr<cap::MPValues<2>>(new cap::MPValues<2>(mp_values_params));
   // build dummy cell itertor and set its material id
@@ -59,8 +68,7 @@ void compute_parameters(
   dealii::DoFHandler<2> dof_handler(triangulation);
   dealii::DoFHandler<2>::active_cell_iterator cell = dof_handler.begin_active();
   // electrode
-  cell->set_material_id(input_database->get<dealii::types::material_id>(
-      "geometry.anode_electrode_material_id"));
+  cell->set_material_id(geometry->get_materials()->at("anode")[0]);
   std::vector<double> electrode_solid_electrical_conductivity_values(1);
   std::vector<double> electrode_liquid_electrical_conductivity_values(1);
   std::vector<double> electrode_specific_capacitance_values(1);
@@ -108,8 +116,7 @@ void compute_parameters(
        electrode_liquid_electrical_conductivity_values[0]);
 
   // separator
-  cell->set_material_id(input_database->get<dealii::types::material_id>(
-      "geometry.separator_material_id"));
+  cell->set_material_id(geometry->get_materials()->at("separator")[0]);
   std::vector<double> separator_liquid_electrical_conductivity_values(1);
   mp_values->get_values("liquid_electrical_conductivity", cell,
                         separator_liquid_electrical_conductivity_values);
@@ -123,7 +130,9 @@ void compute_parameters(
   output_database->put("cross_sectional_area", cross_sectional_area);
 }
 
-void verification_problem(
+// Return the maximum relative error on the voltage during the discharge in
+// percent.
+double verification_problem(
     std::shared_ptr<cap::EnergyStorageDevice> dev,
     std::shared_ptr<boost::property_tree::ptree const> database,
     std::ostream &os = std::cout)
@@ -344,6 +353,7 @@ void verification_problem(
 
   double computed_voltage;
   double exact_voltage;
+  double max_percent_error = 0.0;
   for (double time = 0.0; time <= discharge_time + epsilon; time += time_step)
   {
     double const dimensionless_time =
@@ -353,6 +363,10 @@ void verification_problem(
     exact_voltage = initial_voltage * dimensionless_cell_voltage;
     dev->evolve_one_time_step_constant_current(time_step, -discharge_current);
     dev->get_voltage(computed_voltage);
+    max_percent_error =
+        std::max(max_percent_error, 100.0 * std::abs(computed_voltage -
+                                                     exact_voltage) /
+                                        std::abs(exact_voltage));
     if ((std::abs(time + time_step - 1e-3) < 1e-7) ||
         (std::abs(time + time_step - 2e-3) < 1e-7) ||
         (std::abs(time + time_step - 3e-3) < 1e-7) ||
@@ -366,7 +380,6 @@ void verification_problem(
       os << boost::format("  %22.15e  %22.15e  %22.15e  \n") %
                 (time + time_step) % exact_voltage % computed_voltage;
   }
-  double const percent_tolerance = database->get<double>("percent_tolerance");
 
   // impedance spectroscopy
   std::fstream fout;
@@ -447,6 +460,8 @@ void verification_problem(
            2.0 * std::pow(I_star, 2) *
                std::accumulate(&(coefficients[1]), &(coefficients[infty]), 0.0);
   };
+
+  return max_percent_error;
 }
 
 } // end namespace cap
@@ -469,8 +484,8 @@ BOOST_AUTO_TEST_CASE(test_exact_transient_solution)
       std::make_shared<boost::property_tree::ptree>(
           input_database->get_child("device"));
   std::shared_ptr<cap::EnergyStorageDevice> device =
-      cap::EnergyStorageDevice::build(boost::mpi::communicator(),
-                                      *device_database);
+      cap::EnergyStorageDevice::build(*device_database,
+                                      boost::mpi::communicator());
 
   // measure discharge curve
   std::fstream fout;
@@ -482,7 +497,10 @@ BOOST_AUTO_TEST_CASE(test_exact_transient_solution)
 
   cap::compute_parameters(device_database, verification_problem_database);
 
-  cap::verification_problem(device, verification_problem_database, fout);
+  double const max_percent_error =
+      cap::verification_problem(device, verification_problem_database, fout);
+  BOOST_TEST(max_percent_error <=
+             verification_problem_database->get<double>("percent_tolerance"));
 
   fout.close();
 }
@@ -62,3 +62,22 @@ BOOST_AUTO_TEST_CASE(test_distributed_energy_storage)
 
   cap::distributed_problem(device);
 }
+
+BOOST_AUTO_TEST_CASE(test_distributed_energy_storage_pipelined_cg)
+{
+  // Same problem solved with the pipelined conjugate gradient
+  boost::property_tree::ptree device_database;
+  boost::property_tree::info_parser::read_info("super_capacitor.info",
+                                               device_database);
+  boost::property_tree::ptree geometry_database;
+  boost::property_tree::info_parser::read_info("generate_mesh.info",
+                                               geometry_database);
+  device_database.put_child("geometry", geometry_database);
+  device_database.put("solver.type", "pipelined_cg");
+
+  std::shared_ptr<cap::EnergyStorageDevice> device =
+      cap::EnergyStorageDevice::build(device_database,
+                                      boost::mpi::communicator());
+
+  cap::distributed_problem(device);
+}
@@ -9,6 +9,7 @@
 
 #include "main.cc"
 
+#include "verification_problem_subramanian.h"
 #include <cap/energy_storage_device.h>
 #include <cap/mp_values.h>
 #include <deal.II/base/types.h>
@@ -19,7 +20,9 @@
 #include <boost/format.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/info_parser.hpp>
+#include <algorithm>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <fstream>
 #include <numeric>
@@ -93,3 +96,62 @@ BOOST_AUTO_TEST_CASE(test_exact_transient_solution)
 
   cap::verification_problem(device);
 }
+
+BOOST_AUTO_TEST_CASE(test_exact_transient_solution_p_study)
+{
+  boost::property_tree::ptree input_database;
+  boost::property_tree::info_parser::read_info("verification_problems.info",
+                                               input_database);
+  std::shared_ptr<boost::property_tree::ptree> verification_problem_database =
+      std::make_shared<boost::property_tree::ptree>(
+          input_database.get_child("verification_problem_subramanian"));
+  cap::compute_parameters(std::make_shared<boost::property_tree::ptree>(
+                              input_database.get_child("device")),
+                          verification_problem_database);
+  std::function<double(double)> const compute_exact_voltage =
+      cap::get_exact_voltage(*verification_problem_database);
+  double const charge_current =
+      verification_problem_database->get<double>("charge_current");
+  double const charge_time =
+      verification_problem_database->get<double>("charge_time");
+  double const time_step =
+      verification_problem_database->get<double>("time_step");
+  double const percent_tolerance =
+      verification_problem_database->get<double>("percent_tolerance");
+  unsigned int const n_time_steps =
+      static_cast<unsigned int>(std::round(charge_time / time_step));
+
+  // The potentials are smooth through the thickness of the electrodes so
+  // increasing the polynomial degree on the default mesh reduces the error on
+  // the voltage during the charge at constant current.
+  std::vector<double> max_percent_errors;
+  for (unsigned int degree = 1; degree <= 3; ++degree)
+  {
+    boost::property_tree::ptree device_database =
+        input_database.get_child("device");
+    device_database.put("solver.polynomial_degree", degree);
+    std::shared_ptr<cap::EnergyStorageDevice> device =
+        cap::EnergyStorageDevice::build(device_database,
+                                        boost::mpi::communicator());
+    double max_percent_error = 0.;
+    for (unsigned int n = 1; n <= n_time_steps; ++n)
+    {
+      double computed_voltage;
+      device->evolve_one_time_step_constant_current(time_step, charge_current);
+      device->get_voltage(computed_voltage);
+      double const exact_voltage = compute_exact_voltage(n * time_step);
+      max_percent_error =
+          std::max(max_percent_error,
+                   100. * std::abs(computed_voltage - exact_voltage) /
+                       std::abs(exact_voltage));
+    }
+    BOOST_TEST_MESSAGE("Q" << degree << " max error " << max_percent_error
+                           << " %");
+    max_percent_errors.push_back(max_percent_error);
+  }
+  for (unsigned int i = 1; i < max_percent_errors.size(); ++i)
+  {
+    BOOST_TEST(max_percent_errors[i] <= percent_tolerance);
+    BOOST_TEST(max_percent_errors[i] <= max_percent_errors[0]);
+  }
+}
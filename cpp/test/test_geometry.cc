@@ -17,12 +17,16 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/info_parser.hpp>
 #include <boost/test/unit_test.hpp>
+#include <cstdio>
 #include <fstream>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 // - Check that a mesh can be loaded, that the areas are computed correctly, and
 // check that a mesh can be written.
 // - Check that we can build a 3D geometry.
+// - Check that the components can be graded and refined through the thickness.
 
 template <int dim>
 void write_mesh(std::string const &mesh_file,
@@ -152,3 +156,188 @@ BOOST_AUTO_TEST_CASE(test_3d_geometry)
   const unsigned int n_cells = 6912;
   BOOST_CHECK(n_cells == triangulation->n_active_cells());
 }
+
+BOOST_AUTO_TEST_CASE(test_graded_geometry)
+{
+  std::shared_ptr<boost::property_tree::ptree> params =
+      std::make_shared<boost::property_tree::ptree>();
+  boost::property_tree::info_parser::read_info("generate_mesh.info", *params);
+  params->put("anode.grading", 1.5);
+  params->put("separator.grading", 1.2);
+  params->put("cathode.grading", 1.5);
+  params->put("thickness_refinements", 1);
+  params->put("n_refinements", 0);
+
+  cap::Geometry<2> geo(params, boost::mpi::communicator());
+  std::shared_ptr<dealii::distributed::Triangulation<2> const> triangulation =
+      geo.get_triangulation();
+  write_mesh("output_test_geometry_graded.vtu", triangulation);
+
+  // Only the through-thickness divisions are doubled: 2 collectors with 6x3
+  // cells, 2 electrodes with 10x2 cells, and 1 separator with 8x2 cells.
+  unsigned int const n_cells = 2 * 18 + 2 * 20 + 16;
+  BOOST_CHECK_EQUAL(triangulation->n_active_cells(), n_cells);
+
+  // The grading does not change the volume of the components.
+  double volume = 0.;
+  for (auto cell : triangulation->active_cell_iterators())
+    volume += cell->measure();
+  // In 2D, the geometric area is used as the height of the electrodes.
+  double const cm_to_m = 0.01;
+  double const cm2_to_m2 = 0.0001;
+  double const height = 25.0e-2 * cm2_to_m2;
+  double const tab_height = 5.0e-4 * cm_to_m;
+  double const electrodes_and_separator =
+      (50.0e-4 + 25.0e-4 + 50.0e-4) * cm_to_m * height;
+  double const collectors = 2. * 5.0e-4 * cm_to_m * (height + tab_height);
+  BOOST_CHECK_CLOSE(volume, electrodes_and_separator + collectors, 1e-8);
+
+  // The divisions of the components must match at the interfaces.
+  params->put("separator.divisions", "4,3");
+  BOOST_CHECK_THROW(
+      cap::Geometry<2> bad_geo(params, boost::mpi::communicator()),
+      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_stacked_geometry)
+{
+  std::shared_ptr<boost::property_tree::ptree> params =
+      std::make_shared<boost::property_tree::ptree>();
+  boost::property_tree::info_parser::read_info("generate_mesh.info", *params);
+  params->put("n_repetitions", 3);
+  params->put("n_refinements", 0);
+
+  cap::Geometry<2> geo(params, boost::mpi::communicator());
+  std::shared_ptr<dealii::distributed::Triangulation<2> const> triangulation =
+      geo.get_triangulation();
+  write_mesh("output_test_geometry_stacked.vtu", triangulation);
+
+  // Four units share five collectors with 3x3 cells. Each unit has two
+  // electrodes with 5x2 cells and a separator with 4x2 cells.
+  unsigned int const n_cells = 5 * 9 + 4 * (2 * 10 + 8);
+  BOOST_CHECK_EQUAL(triangulation->n_active_cells(), n_cells);
+
+  // The layers share their vertices so the only boundary faces are on the
+  // outside of the stack: the top and the bottom of each column of cells, the
+  // two ends of the stack, and the sides of the tabs.
+  unsigned int n_boundary_faces = 0;
+  for (auto cell : triangulation->active_cell_iterators())
+    for (unsigned int f = 0; f < dealii::GeometryInfo<2>::faces_per_cell; ++f)
+      if (cell->face(f)->at_boundary())
+        ++n_boundary_faces;
+  unsigned int const n_columns = 5 * 3 + 4 * (2 * 5 + 4);
+  unsigned int const n_tab_sides = 2 * 5 - 2;
+  BOOST_CHECK_EQUAL(n_boundary_faces, 2 * n_columns + 2 * 3 + n_tab_sides);
+
+  double volume = 0.;
+  for (auto cell : triangulation->active_cell_iterators())
+    volume += cell->measure();
+  double const cm_to_m = 0.01;
+  double const cm2_to_m2 = 0.0001;
+  double const height = 25.0e-2 * cm2_to_m2;
+  double const tab_height = 5.0e-4 * cm_to_m;
+  double const units = 4. * (50.0e-4 + 25.0e-4 + 50.0e-4) * cm_to_m * height;
+  double const collectors = 5. * 5.0e-4 * cm_to_m * (height + tab_height);
+  BOOST_CHECK_CLOSE(volume, units + collectors, 1e-8);
+
+  // The fully distributed coarse mesh is not supported by deal.II 8.4.
+  params->put("fully_distributed", true);
+  BOOST_CHECK_THROW(
+      cap::Geometry<2> distributed_geo(params, boost::mpi::communicator()),
+      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_geometry_cache)
+{
+  std::shared_ptr<boost::property_tree::ptree> params =
+      std::make_shared<boost::property_tree::ptree>();
+  boost::property_tree::info_parser::read_info("generate_mesh.info", *params);
+  params->put("cache_directory", ".");
+  boost::mpi::communicator world;
+
+  // The first geometry fills the cache and the second one is loaded from it.
+  cap::Geometry<2> geo(std::make_shared<boost::property_tree::ptree>(*params),
+                       world);
+  BOOST_TEST(!geo.is_loaded_from_cache());
+  std::string const cache_file = geo.get_cache_file();
+  BOOST_TEST(std::ifstream(cache_file).good());
+  cap::Geometry<2> cached_geo(
+      std::make_shared<boost::property_tree::ptree>(*params), world);
+  BOOST_TEST(cached_geo.is_loaded_from_cache());
+  BOOST_TEST(cached_geo.get_cache_file() == cache_file);
+  std::shared_ptr<dealii::distributed::Triangulation<2> const> triangulation =
+      geo.get_triangulation();
+  std::shared_ptr<dealii::distributed::Triangulation<2> const>
+      cached_triangulation = cached_geo.get_triangulation();
+  BOOST_CHECK_EQUAL(cached_triangulation->n_global_active_cells(),
+                    triangulation->n_global_active_cells());
+  BOOST_CHECK_EQUAL(cached_triangulation->n_locally_owned_active_cells(),
+                    triangulation->n_locally_owned_active_cells());
+
+  // The material ids and the boundary ids are restored.
+  auto cell = triangulation->begin_active();
+  auto cached_cell = cached_triangulation->begin_active();
+  for (; cell != triangulation->end(); ++cell, ++cached_cell)
+  {
+    BOOST_CHECK_EQUAL(cached_cell->material_id(), cell->material_id());
+    for (unsigned int f = 0; f < dealii::GeometryInfo<2>::faces_per_cell; ++f)
+      if (cell->face(f)->at_boundary())
+        BOOST_CHECK_EQUAL(cached_cell->face(f)->boundary_id(),
+                          cell->face(f)->boundary_id());
+  }
+
+  // Changing the database changes the key of the cache.
+  params->put("n_refinements", 1);
+  cap::Geometry<2> coarse_geo(params, world);
+  BOOST_TEST(!coarse_geo.is_loaded_from_cache());
+  BOOST_TEST(coarse_geo.get_cache_file() != cache_file);
+  BOOST_CHECK_LT(coarse_geo.get_triangulation()->n_global_active_cells(),
+                 triangulation->n_global_active_cells());
+
+  // Meshes read from a file cannot be cached.
+  std::shared_ptr<boost::property_tree::ptree> file_params =
+      std::make_shared<boost::property_tree::ptree>();
+  boost::property_tree::info_parser::read_info("read_mesh.info",
+                                               *file_params);
+  file_params->put("cache_directory", ".");
+  BOOST_CHECK_THROW(cap::Geometry<2> file_geo(file_params, world),
+                    std::runtime_error);
+
+  // Remove the cache.
+  world.barrier();
+  if (world.rank() == 0)
+    for (std::string const &file : {cache_file, coarse_geo.get_cache_file()})
+      for (std::string const suffix :
+           {"", ".info", "_fixed.data", "_variable.data"})
+        std::remove((file + suffix).c_str());
+  world.barrier();
+  BOOST_TEST(!std::ifstream(cache_file).good());
+}
+
+BOOST_AUTO_TEST_CASE(test_cell_weights)
+{
+  std::shared_ptr<boost::property_tree::ptree> params =
+      std::make_shared<boost::property_tree::ptree>();
+  boost::property_tree::info_parser::read_info("generate_mesh.info", *params);
+  params->put("anode.weight", 500);
+  params->put("collector.weight", 100);
+  boost::mpi::communicator world;
+  cap::Geometry<2> geo(params, world);
+
+  // The weights are indexed by the material id: anode, separator, cathode,
+  // and the two collectors.
+  std::vector<unsigned int> const reference_weights = {500, 0, 0, 100, 100};
+  std::vector<unsigned int> const &cell_weights = geo.get_cell_weights();
+  BOOST_CHECK_EQUAL_COLLECTIONS(cell_weights.begin(), cell_weights.end(),
+                                reference_weights.begin(),
+                                reference_weights.end());
+
+  // New weights are used when the mesh is repartitioned and the mesh is not
+  // modified.
+  unsigned int const n_cells =
+      geo.get_triangulation()->n_global_active_cells();
+  geo.set_cell_weights({1000, 0, 1000, 0, 0});
+  geo.get_mutable_triangulation()->repartition();
+  BOOST_CHECK_EQUAL(geo.get_triangulation()->n_global_active_cells(),
+                    n_cells);
+}
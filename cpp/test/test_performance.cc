@@ -0,0 +1,146 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE TestPerformance
+
+#include "main.cc"
+
+#include <cap/resistor_capacitor.h>
+#include <boost/property_tree/info_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <vector>
+
+// The measurements of each workload are compared to the baselines of
+// performance_baselines.info. The counts (iterations of the nonlinear
+// solvers) must have a baseline and must not increase by more than the count
+// tolerance. The times are divided by the time
+// of a reference kernel but they still depend too much on the machine and on
+// its load to be checked, so they are only reported. All the measurements are
+// written in performance_results.info, which can be used to update the
+// baselines after an intended change.
+
+namespace
+{
+double wall_time(std::chrono::steady_clock::time_point const &start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Return the time in seconds of a memory-bound kernel, the best of five runs.
+double get_reference_time()
+{
+  static double reference_time = 0.;
+  if (reference_time > 0.)
+    return reference_time;
+  std::size_t const n = 1 << 20;
+  std::vector<double> x(n, 1.);
+  std::vector<double> y(n, 0.);
+  reference_time = std::numeric_limits<double>::max();
+  for (unsigned int trial = 0; trial < 5; ++trial)
+  {
+    auto const start = std::chrono::steady_clock::now();
+    for (unsigned int k = 0; k < 10; ++k)
+      for (std::size_t i = 0; i < n; ++i)
+        y[i] += 1.0e-3 * x[i];
+    reference_time = std::min(reference_time, wall_time(start));
+  }
+  BOOST_TEST_REQUIRE(y[n - 1] > 0.);
+  return reference_time;
+}
+
+boost::property_tree::ptree &get_results()
+{
+  static boost::property_tree::ptree results;
+  return results;
+}
+
+void check_against_baseline(std::string const &workload,
+                            boost::property_tree::ptree const &measurements)
+{
+  boost::property_tree::ptree baselines;
+  boost::property_tree::info_parser::read_info("performance_baselines.info",
+                                               baselines);
+  double const count_tolerance =
+      baselines.get<double>("tolerances.count", 0.);
+
+  get_results().put_child(workload, measurements);
+  boost::property_tree::write_info("performance_results.info", get_results());
+
+  for (auto const &measurement : measurements)
+  {
+    std::string const &key = measurement.first;
+    double const value = measurement.second.get_value<double>();
+    if (key == "normalized_time")
+    {
+      BOOST_TEST_MESSAGE(workload + "." + key + " = " + std::to_string(value));
+      continue;
+    }
+    boost::optional<double> const baseline =
+        baselines.get_optional<double>(workload + "." + key);
+    BOOST_TEST(static_cast<bool>(baseline),
+               "no baseline for " << workload << "." << key << ", measured "
+                                  << value);
+    if (!baseline)
+      continue;
+    BOOST_TEST(value <= *baseline * (1. + count_tolerance),
+               workload << "." << key << " = " << value
+                        << " exceeds the baseline " << *baseline);
+    if (value < *baseline)
+      BOOST_TEST_MESSAGE(workload + "." + key + " improved to " +
+                         std::to_string(value) + ", update the baseline");
+  }
+}
+
+// Cycle between 1.5 and 2.1 volts at constant power and count the Newton
+// iterations.
+template <typename RC>
+void run_rc_constant_power(std::string const &workload,
+                           std::string const &filename)
+{
+  boost::property_tree::ptree ptree;
+  boost::property_tree::info_parser::read_info(filename, ptree);
+  ptree.put("initial_voltage", 2.1);
+  RC rc(ptree, boost::mpi::communicator());
+
+  std::size_t n_iterations = 0;
+  auto const start = std::chrono::steady_clock::now();
+  for (unsigned int cycle = 0; cycle < 100; ++cycle)
+  {
+    while (rc.U > 1.5)
+      n_iterations +=
+          rc.evolve_one_time_step_constant_power(0.01, -1., "NEWTON");
+    while (rc.U < 2.1)
+      n_iterations +=
+          rc.evolve_one_time_step_constant_power(0.01, 1., "NEWTON");
+  }
+  double const time = wall_time(start);
+
+  boost::property_tree::ptree measurements;
+  measurements.put("n_iterations", n_iterations);
+  measurements.put("normalized_time", time / get_reference_time());
+  check_against_baseline(workload, measurements);
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_performance_series_rc)
+{
+  run_rc_constant_power<cap::SeriesRC>("series_rc_constant_power",
+                                       "series_rc.info");
+}
+
+BOOST_AUTO_TEST_CASE(test_performance_parallel_rc)
+{
+  run_rc_constant_power<cap::ParallelRC>("parallel_rc_constant_power",
+                                         "parallel_rc.info");
+}
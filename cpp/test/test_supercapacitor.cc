@@ -9,12 +9,19 @@
 
 #include "main.cc"
 
+#include <cap/default_inspector.h>
 #include <cap/energy_storage_device.h>
+#include <cap/supercapacitor.h>
+#include <cap/solver_statistics.h>
+#include <cap/memory_footprint.h>
 #include <boost/test/unit_test.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/info_parser.hpp>
 #include <boost/format.hpp>
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <string>
 #include <iostream>
 #include <fstream>
 
@@ -63,6 +70,33 @@ void check_sanity(std::shared_ptr<cap::EnergyStorageDevice> dev)
   // }
 }
 
+// Check that two devices give the same voltage and current.
+void check_same_response(std::shared_ptr<cap::EnergyStorageDevice> reference,
+                         std::shared_ptr<cap::EnergyStorageDevice> dev)
+{
+  double const percent_tolerance = 1e-4;
+  double reference_voltage;
+  double reference_current;
+  double voltage;
+  double current;
+  for (auto imposed_current : {10e-3, 5e-3, 2e-3})
+  {
+    reference->evolve_one_time_step_constant_current(2.0, imposed_current);
+    dev->evolve_one_time_step_constant_current(2.0, imposed_current);
+    reference->get_voltage(reference_voltage);
+    dev->get_voltage(voltage);
+    BOOST_CHECK_CLOSE(voltage, reference_voltage, percent_tolerance);
+  }
+  for (auto imposed_voltage : {1.4, 1.8, 2.2})
+  {
+    reference->evolve_one_time_step_constant_voltage(2.0, imposed_voltage);
+    dev->evolve_one_time_step_constant_voltage(2.0, imposed_voltage);
+    reference->get_current(reference_current);
+    dev->get_current(current);
+    BOOST_CHECK_CLOSE(current, reference_current, percent_tolerance);
+  }
+}
+
 } // end namespace cap
 
 double constexpr relative_tolerance = 1.0e-2;
@@ -80,3 +114,291 @@ BOOST_AUTO_TEST_CASE(test_supercapacitor,
   // check sanity
   cap::check_sanity(supercap);
 }
+
+BOOST_AUTO_TEST_CASE(test_supercapacitor_mixed_precision)
+{
+  // build two devices that only differ by the solve path
+  boost::property_tree::ptree ptree;
+  boost::property_tree::info_parser::read_info("super_capacitor.info", ptree);
+  boost::mpi::communicator world;
+  std::shared_ptr<cap::EnergyStorageDevice> reference =
+      cap::EnergyStorageDevice::build(ptree, world);
+  ptree.put("solver.mixed_precision", true);
+  std::shared_ptr<cap::EnergyStorageDevice> supercap =
+      cap::EnergyStorageDevice::build(ptree, world);
+
+  // the voltage and the current computed with iterative refinement match the
+  // ones computed with the double-precision solve
+  cap::check_same_response(reference, supercap);
+}
+
+BOOST_AUTO_TEST_CASE(test_supercapacitor_eliminate_inactive_dofs)
+{
+  boost::property_tree::ptree ptree;
+  boost::property_tree::info_parser::read_info("super_capacitor.info", ptree);
+  boost::mpi::communicator world;
+  std::shared_ptr<cap::EnergyStorageDevice> reference =
+      cap::EnergyStorageDevice::build(ptree, world);
+  ptree.put("solver.eliminate_inactive_dofs", true);
+  std::shared_ptr<cap::EnergyStorageDevice> supercap =
+      cap::EnergyStorageDevice::build(ptree, world);
+
+  // the degrees of freedom that are removed do not change the response
+  cap::check_same_response(reference, supercap);
+}
+
+BOOST_AUTO_TEST_CASE(test_supercapacitor_renumbering)
+{
+  boost::property_tree::ptree ptree;
+  boost::property_tree::info_parser::read_info("super_capacitor.info", ptree);
+  boost::mpi::communicator world;
+
+  // the ordering of the degrees of freedom does not change the response
+  for (std::string const renumbering : {"none", "cuthill_mckee", "downstream"})
+    for (bool const interleave_components : {false, true})
+    {
+      std::shared_ptr<cap::EnergyStorageDevice> reference =
+          cap::EnergyStorageDevice::build(ptree, world);
+      boost::property_tree::ptree renumbering_ptree = ptree;
+      renumbering_ptree.put("solver.renumbering", renumbering);
+      renumbering_ptree.put("solver.interleave_components",
+                            interleave_components);
+      std::shared_ptr<cap::EnergyStorageDevice> supercap =
+          cap::EnergyStorageDevice::build(renumbering_ptree, world);
+      cap::check_same_response(reference, supercap);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_supercapacitor_matrix_free)
+{
+  boost::property_tree::ptree ptree;
+  boost::property_tree::info_parser::read_info("super_capacitor.info", ptree);
+  boost::mpi::communicator world;
+  std::shared_ptr<cap::EnergyStorageDevice> reference =
+      cap::EnergyStorageDevice::build(ptree, world);
+  ptree.put("solver.backend", "matrix_free");
+  // The Chebyshev preconditioner is weaker than AMG
+  ptree.put("solver.max_iter", 10000);
+  std::shared_ptr<cap::EnergyStorageDevice> supercap =
+      cap::EnergyStorageDevice::build(ptree, world);
+
+  // the matrix-free operator gives the same response as the assembled matrices
+  cap::check_same_response(reference, supercap);
+}
+
+BOOST_AUTO_TEST_CASE(test_supercapacitor_adaptive_refinement,
+                     *boost::unit_test::tolerance(relative_tolerance))
+{
+  // adapt the mesh after each time step
+  boost::property_tree::ptree ptree;
+  boost::property_tree::info_parser::read_info("super_capacitor.info", ptree);
+  ptree.put("adaptive_refinement.interval", 1);
+  boost::mpi::communicator world;
+  std::shared_ptr<cap::EnergyStorageDevice> supercap =
+      cap::EnergyStorageDevice::build(ptree, world);
+  cap::DefaultInspector inspector;
+  supercap->inspect(&inspector);
+  unsigned int const initial_n_dofs = inspector.get_data()["n_dofs"];
+
+  // the physics and the post-processor are rebuilt on the new meshes
+  cap::check_sanity(supercap);
+
+  // the mesh has actually been adapted
+  supercap->inspect(&inspector);
+  unsigned int const n_dofs = inspector.get_data()["n_dofs"];
+  BOOST_TEST_MESSAGE("Number of degrees of freedom: " << initial_n_dofs
+                                                      << " -> " << n_dofs);
+  BOOST_TEST(n_dofs != initial_n_dofs);
+}
+
+BOOST_AUTO_TEST_CASE(test_supercapacitor_exploit_symmetry)
+{
+  // mesh a stack of two units
+  boost::property_tree::ptree ptree;
+  boost::property_tree::info_parser::read_info("super_capacitor.info", ptree);
+  boost::property_tree::ptree geometry_database;
+  boost::property_tree::info_parser::read_info("generate_mesh.info",
+                                               geometry_database);
+  geometry_database.put("n_repetitions", 1);
+  geometry_database.put("n_refinements", 1);
+  // the midplane of the shared collector is a vertex plane of the stack so
+  // that the half collector of the symmetric mesh has the same cells
+  geometry_database.put("collector.divisions", "2,3");
+  ptree.put_child("geometry", geometry_database);
+  boost::mpi::communicator world;
+  std::shared_ptr<cap::EnergyStorageDevice> reference =
+      cap::EnergyStorageDevice::build(ptree, world);
+  // mesh only one unit and scale the results
+  ptree.put("geometry.exploit_symmetry", true);
+  std::shared_ptr<cap::EnergyStorageDevice> supercap =
+      cap::EnergyStorageDevice::build(ptree, world);
+
+  cap::check_same_response(reference, supercap);
+
+  // the volume and the mass account for the collector shared by the units
+  double const percent_tolerance = 1e-8;
+  for (std::string const key : {"volume", "mass"})
+  {
+    double reference_value;
+    std::dynamic_pointer_cast<cap::SuperCapacitor<2>>(reference)
+        ->get_post_processor()
+        ->get(key, reference_value);
+    double value;
+    std::dynamic_pointer_cast<cap::SuperCapacitor<2>>(supercap)
+        ->get_post_processor()
+        ->get(key, value);
+    BOOST_CHECK_CLOSE(value, reference_value, percent_tolerance);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_supercapacitor_load_balancing_calibration)
+{
+  boost::property_tree::ptree ptree;
+  boost::property_tree::info_parser::read_info("super_capacitor.info", ptree);
+  boost::mpi::communicator world;
+  std::shared_ptr<cap::EnergyStorageDevice> reference =
+      cap::EnergyStorageDevice::build(ptree, world);
+  // measure the cost of the materials during two time steps and repartition
+  ptree.put("load_balancing.calibration_steps", 2);
+  std::shared_ptr<cap::EnergyStorageDevice> supercap =
+      cap::EnergyStorageDevice::build(ptree, world);
+
+  // the partition does not change the response
+  cap::check_same_response(reference, supercap);
+
+  // the cheapest cells keep the default weight and the cells of the
+  // electrodes, which have more active degrees of freedom than the cells of
+  // the collectors, are heavier
+  std::vector<unsigned int> const &cell_weights =
+      std::dynamic_pointer_cast<cap::SuperCapacitor<2>>(supercap)
+          ->get_geometry()
+          ->get_cell_weights();
+  std::vector<unsigned int> const &default_cell_weights =
+      std::dynamic_pointer_cast<cap::SuperCapacitor<2>>(reference)
+          ->get_geometry()
+          ->get_cell_weights();
+  BOOST_TEST(!cell_weights.empty());
+  BOOST_TEST(*std::min_element(cell_weights.begin(), cell_weights.end()) == 0);
+  BOOST_TEST(*std::max_element(cell_weights.begin(), cell_weights.end()) > 0);
+  BOOST_TEST(cell_weights != default_cell_weights);
+
+  // the calibration needs the assembled matrices
+  ptree.put("solver.backend", "matrix_free");
+  BOOST_CHECK_THROW(cap::EnergyStorageDevice::build(ptree, world),
+                    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_supercapacitor_solver_statistics)
+{
+  boost::property_tree::ptree ptree;
+  boost::property_tree::info_parser::read_info("super_capacitor.info", ptree);
+  ptree.put("solver.statistics_capacity", 2);
+  boost::mpi::communicator world;
+  std::shared_ptr<cap::EnergyStorageDevice> supercap =
+      cap::EnergyStorageDevice::build(ptree, world);
+  cap::SolverStatisticsInspector inspector;
+  supercap->inspect(&inspector);
+  BOOST_TEST(inspector.get_statistics().empty());
+
+  for (unsigned int i = 0; i < 3; ++i)
+    supercap->evolve_one_time_step_constant_current(0.1, 1e-3);
+  supercap->inspect(&inspector);
+  // only the last two solves are kept
+  std::vector<cap::SolverStatistics> const &statistics =
+      inspector.get_statistics();
+  BOOST_TEST(statistics.size() == 2);
+  BOOST_TEST(statistics[0].step == 2);
+  BOOST_TEST(statistics[1].step == 3);
+  for (auto const &s : statistics)
+  {
+    // neither the current nor the time step changed
+    BOOST_TEST(!s.rebuilt_operator);
+    BOOST_TEST(!s.rebuilt_preconditioner);
+    BOOST_TEST(s.assembly_time == 0.);
+    BOOST_TEST(s.n_iterations > 0);
+    BOOST_TEST(s.final_residual <= s.initial_residual);
+    BOOST_TEST(s.solve_time >= 0.);
+    BOOST_TEST(s.postprocess_time >= 0.);
+  }
+
+  // a new current rebuilds the operator and the preconditioner
+  supercap->evolve_one_time_step_constant_current(0.1, 2e-3);
+  supercap->inspect(&inspector);
+  BOOST_TEST(inspector.get_statistics().back().step == 4);
+  BOOST_TEST(inspector.get_statistics().back().rebuilt_operator);
+  BOOST_TEST(inspector.get_statistics().back().rebuilt_preconditioner);
+}
+
+BOOST_AUTO_TEST_CASE(test_supercapacitor_memory_footprint)
+{
+  boost::property_tree::ptree ptree;
+  boost::property_tree::info_parser::read_info("super_capacitor.info", ptree);
+  boost::mpi::communicator world;
+  std::map<std::string, cap::MemoryStatistics> const estimate =
+      cap::estimate_memory_footprint(ptree, world);
+  std::shared_ptr<cap::EnergyStorageDevice> supercap =
+      cap::EnergyStorageDevice::build(ptree, world);
+  cap::MemoryFootprintInspector inspector;
+  supercap->inspect(&inspector);
+  // the system is built during the first time step
+  BOOST_TEST(inspector.get_footprint().at("system_matrix").max == 0);
+  supercap->evolve_one_time_step_constant_current(0.1, 1e-3);
+  supercap->inspect(&inspector);
+  std::map<std::string, cap::MemoryStatistics> const &footprint =
+      inspector.get_footprint();
+
+  for (std::string const &key :
+       {"triangulation", "dof_handler", "constraints", "sparsity_pattern",
+        "system_matrix", "mass_matrix", "preconditioner", "solution",
+        "system_rhs", "postprocessor", "total", "peak_resident_set_size"})
+  {
+    cap::MemoryStatistics const &component = footprint.at(key);
+    BOOST_TEST(component.min <= component.max);
+    BOOST_TEST(component.max <= component.total);
+  }
+  for (std::string const &key :
+       {"triangulation", "dof_handler", "system_matrix", "preconditioner",
+        "solution", "total", "peak_resident_set_size"})
+    BOOST_TEST(footprint.at(key).min > 0);
+  BOOST_TEST(footprint.at("total").max >= footprint.at("system_matrix").max);
+  BOOST_TEST(footprint.at("peak_resident_set_size").max >=
+             footprint.at("total").max);
+
+  // the mesh and the degrees of freedom are built for the estimate, the
+  // system is extrapolated
+  BOOST_TEST(estimate.count("peak_resident_set_size") == 0);
+  BOOST_TEST(estimate.at("triangulation").total ==
+             footprint.at("triangulation").total);
+  BOOST_TEST(estimate.at("dof_handler").total ==
+             footprint.at("dof_handler").total);
+  BOOST_TEST(estimate.at("system_matrix").total <
+             2 * footprint.at("system_matrix").total);
+  BOOST_TEST(2 * estimate.at("system_matrix").total >
+             footprint.at("system_matrix").total);
+  BOOST_TEST(estimate.at("preconditioner").total ==
+             footprint.at("preconditioner").total);
+
+  // the inactive degrees of freedom are removed from the matrices
+  ptree.put("solver.eliminate_inactive_dofs", true);
+  BOOST_TEST(cap::estimate_memory_footprint(ptree, world)
+                 .at("system_matrix")
+                 .total < estimate.at("system_matrix").total);
+
+  // the matrix-free backend only stores the inverse of the diagonal
+  ptree.put("solver.eliminate_inactive_dofs", false);
+  ptree.put("solver.backend", "matrix_free");
+  ptree.put("solver.max_iter", 10000);
+  std::map<std::string, cap::MemoryStatistics> const matrix_free_estimate =
+      cap::estimate_memory_footprint(ptree, world);
+  std::shared_ptr<cap::EnergyStorageDevice> matrix_free_supercap =
+      cap::EnergyStorageDevice::build(ptree, world);
+  matrix_free_supercap->evolve_one_time_step_constant_current(0.1, 1e-3);
+  matrix_free_supercap->inspect(&inspector);
+  std::map<std::string, cap::MemoryStatistics> const &matrix_free_footprint =
+      inspector.get_footprint();
+  BOOST_TEST(matrix_free_estimate.at("system_matrix").total == 0);
+  BOOST_TEST(matrix_free_estimate.at("preconditioner").total <
+             2 * matrix_free_footprint.at("preconditioner").total);
+  BOOST_TEST(2 * matrix_free_estimate.at("preconditioner").total >
+             matrix_free_footprint.at("preconditioner").total);
+}
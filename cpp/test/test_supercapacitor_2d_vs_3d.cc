@@ -15,6 +15,7 @@
 #include <boost/mpi/communicator.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/info_parser.hpp>
+#include <cmath>
 
 BOOST_AUTO_TEST_CASE(test_3d_charge)
 {
@@ -94,3 +95,58 @@ BOOST_AUTO_TEST_CASE(test_3d_charge)
   double const percent_tolerance = 1e-2;
   BOOST_CHECK_CLOSE(voltage_2d, voltage_3d, percent_tolerance);
 }
+
+BOOST_AUTO_TEST_CASE(test_1d_charge)
+{
+  // Do a charge on a 2D device and then compare the result with a charge using
+  // the pseudo-1D device built from the same database.
+  boost::property_tree::ptree device_database;
+  boost::property_tree::info_parser::read_info("super_capacitor.info",
+                                               device_database);
+  boost::property_tree::ptree geometry_database;
+  boost::property_tree::info_parser::read_info("generate_mesh.info",
+                                               geometry_database);
+  geometry_database.put("collector.divisions", "1,3");
+  geometry_database.put("anode.divisions", "1,2");
+  geometry_database.put("separator.divisions", "1,2");
+  geometry_database.put("cathode.divisions", "1,2");
+  geometry_database.put("n_refinements", 2);
+  device_database.put_child("geometry", geometry_database);
+
+  std::shared_ptr<cap::EnergyStorageDevice> device =
+      cap::EnergyStorageDevice::build(device_database,
+                                      boost::mpi::communicator());
+  double const charge_current = 5e-3;
+  double const time_step = 1e-2;
+  double voltage_2d;
+  for (unsigned int i = 0; i < 5; ++i)
+    device->evolve_one_time_step_constant_current(time_step, charge_current);
+  device->get_voltage(voltage_2d);
+
+  device_database.put("dim", 1);
+  device = cap::EnergyStorageDevice::build(device_database,
+                                           boost::mpi::communicator());
+  double voltage_1d;
+  for (unsigned int i = 0; i < 5; ++i)
+    device->evolve_one_time_step_constant_current(time_step, charge_current);
+  device->get_voltage(voltage_1d);
+  double current_1d;
+  device->get_current(current_1d);
+
+  double const percent_tolerance = 1e-2;
+  BOOST_CHECK_CLOSE(voltage_2d, voltage_1d, percent_tolerance);
+  BOOST_CHECK_EQUAL(current_1d, charge_current);
+
+  // Hold the voltage and check that the current decays.
+  double current;
+  device->evolve_one_time_step_constant_voltage(time_step, voltage_1d);
+  device->get_current(current);
+  double const initial_current = current;
+  for (unsigned int i = 0; i < 5; ++i)
+    device->evolve_one_time_step_constant_voltage(time_step, voltage_1d);
+  device->get_current(current);
+  BOOST_CHECK_LT(std::abs(current), std::abs(initial_current));
+  double voltage;
+  device->get_voltage(voltage);
+  BOOST_CHECK_EQUAL(voltage, voltage_1d);
+}
@@ -0,0 +1,68 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE SuperCapacitorMultipleRHS
+
+#include "main.cc"
+
+#include <cap/supercapacitor.h>
+#include <boost/test/unit_test.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/info_parser.hpp>
+#include <memory>
+#include <vector>
+
+// Check that advancing several states together with the batched solver gives
+// the same voltages as advancing independent devices.
+
+BOOST_AUTO_TEST_CASE(test_supercapacitor_multiple_rhs)
+{
+  boost::mpi::communicator comm;
+  boost::property_tree::ptree device_database;
+  boost::property_tree::info_parser::read_info("super_capacitor.info",
+                                               device_database);
+
+  std::vector<double> const currents = {5e-3, 2e-3, -1e-3, 0.};
+  unsigned int const n_states = currents.size();
+  unsigned int const n_time_steps = 3;
+  double const time_step = 1e-2;
+
+  // Advance the states together
+  std::shared_ptr<cap::EnergyStorageDevice> device =
+      cap::EnergyStorageDevice::build(device_database, comm);
+  std::shared_ptr<cap::SuperCapacitor<2>> supercapacitor =
+      std::dynamic_pointer_cast<cap::SuperCapacitor<2>>(device);
+  BOOST_TEST_REQUIRE(supercapacitor != nullptr);
+  std::vector<dealii::Trilinos::MPI::Vector> states(
+      n_states, supercapacitor->get_state());
+  std::vector<double> batched_voltages;
+  for (unsigned int i = 0; i < n_time_steps; ++i)
+    supercapacitor->evolve_one_time_step_constant_current(
+        time_step, currents, states, batched_voltages);
+  BOOST_TEST(batched_voltages.size() == n_states);
+
+  // The state of the device has not been modified
+  double voltage;
+  supercapacitor->get_voltage(voltage);
+  BOOST_TEST(voltage == 0.);
+
+  // Advance independent devices
+  double const percent_tolerance = 1e-4;
+  for (unsigned int j = 0; j < n_states; ++j)
+  {
+    std::shared_ptr<cap::EnergyStorageDevice> reference_device =
+        cap::EnergyStorageDevice::build(device_database, comm);
+    for (unsigned int i = 0; i < n_time_steps; ++i)
+      reference_device->evolve_one_time_step_constant_current(time_step,
+                                                              currents[j]);
+    reference_device->get_voltage(voltage);
+    if (currents[j] == 0.)
+      BOOST_TEST(std::abs(batched_voltages[j]) < 1e-12);
+    else
+      BOOST_CHECK_CLOSE(batched_voltages[j], voltage, percent_tolerance);
+  }
+}
@@ -10,10 +10,17 @@
 #include "main.cc"
 
 #include <cap/timer.h>
+#include <cap/timer_registry.h>
+#include <cap/trace.h>
 #include <boost/test/unit_test.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <fstream>
+#include <sstream>
 #include <thread>
+#include <vector>
 
 namespace cap
 {
@@ -46,4 +53,249 @@ BOOST_AUTO_TEST_CASE(test_timer)
   ms = boost::chrono::duration_cast<boost::chrono::milliseconds>(duration);
   BOOST_TEST(std::abs(ms.count() - 200) < tolerance);
 }
+
+BOOST_AUTO_TEST_CASE(test_timer_registry)
+{
+  double const tolerance = 15e-3;
+  TimerRegistry &registry = TimerRegistry::instance();
+  registry.reset();
+
+  // Time two nested sections. The inner section is called twice.
+  {
+    ScopedTimer outer("outer");
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+      ScopedTimer inner("inner");
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    ScopedTimer stopped("stopped");
+    stopped.stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  std::vector<std::string> const paths = {"outer", "outer/inner",
+                                          "outer/stopped"};
+  std::vector<std::string> const registered_paths = registry.get_paths();
+  BOOST_CHECK_EQUAL_COLLECTIONS(registered_paths.begin(),
+                                registered_paths.end(), paths.begin(),
+                                paths.end());
+  BOOST_TEST(registry.get_n_calls("outer") == 1);
+  BOOST_TEST(registry.get_n_calls("outer/inner") == 2);
+  BOOST_TEST(std::abs(registry.get_wall_time("outer") - 0.3) < 3 * tolerance);
+  BOOST_TEST(std::abs(registry.get_wall_time("outer/inner") - 0.2) <
+             2 * tolerance);
+  BOOST_TEST(registry.get_wall_time("outer/stopped") < tolerance);
+  // Sleeping does not use the CPU.
+  BOOST_TEST(registry.get_cpu_time("outer") < registry.get_wall_time("outer"));
+  BOOST_CHECK_THROW(registry.get_wall_time("inner"), std::runtime_error);
+
+  // Every processor went through the same sections.
+  boost::mpi::communicator world;
+  std::map<std::string, TimerStatistics> const statistics =
+      registry.gather(world);
+  BOOST_TEST(statistics.size() == paths.size());
+  TimerStatistics const &inner = statistics.at("outer/inner");
+  BOOST_TEST(inner.n_calls == 2);
+  BOOST_TEST(inner.min_wall_time <= inner.mean_wall_time);
+  BOOST_TEST(inner.mean_wall_time <= inner.max_wall_time);
+  BOOST_TEST(std::abs(inner.mean_wall_time - 0.2) < 2 * tolerance);
+
+  // The summary is only output by the rank 0 process.
+  std::stringstream table;
+  registry.print(table, world);
+  std::stringstream json;
+  registry.write_json(json, world);
+  if (world.rank() == 0)
+  {
+    BOOST_TEST(table.str().find("  inner") != std::string::npos);
+    BOOST_TEST(json.str().find("\"outer/inner\": {\"calls\": 2") !=
+               std::string::npos);
+  }
+  else
+  {
+    BOOST_TEST(table.str().empty());
+    BOOST_TEST(json.str().empty());
+  }
+
+  registry.reset();
+  BOOST_TEST(registry.get_paths().empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_timer_registry_threads)
+{
+  TimerRegistry &registry = TimerRegistry::instance();
+  registry.reset();
+
+  // Each thread has its own stack of sections. The sections of the workers
+  // are not nested in the section of the main thread and they are
+  // accumulated.
+  {
+    ScopedTimer main("main");
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < 4; ++i)
+      workers.emplace_back([]()
+                           {
+                             for (unsigned int j = 0; j < 100; ++j)
+                             {
+                               ScopedTimer outer("worker");
+                               ScopedTimer inner("inner");
+                             }
+                           });
+    for (auto &worker : workers)
+      worker.join();
+  }
+  std::vector<std::string> const paths = {"main", "worker", "worker/inner"};
+  std::vector<std::string> const registered_paths = registry.get_paths();
+  BOOST_CHECK_EQUAL_COLLECTIONS(registered_paths.begin(),
+                                registered_paths.end(), paths.begin(),
+                                paths.end());
+  BOOST_TEST(registry.get_n_calls("main") == 1);
+  BOOST_TEST(registry.get_n_calls("worker") == 400);
+  BOOST_TEST(registry.get_n_calls("worker/inner") == 400);
+
+  // The CPU time of a section only counts the thread that runs it.
+  registry.reset();
+  {
+    ScopedTimer sleeping("sleeping");
+    std::atomic<bool> done(false);
+    std::thread busy([&done]()
+                     {
+                       while (!done)
+                         ;
+                     });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    done = true;
+    busy.join();
+  }
+  BOOST_TEST(registry.get_cpu_time("sleeping") <
+             0.5 * registry.get_wall_time("sleeping"));
+
+  registry.reset();
+}
+
+BOOST_AUTO_TEST_CASE(test_hardware_counters)
+{
+  TimerRegistry &registry = TimerRegistry::instance();
+  registry.reset();
+
+  // The counters are NaN if they are not read.
+  {
+    ScopedTimer not_counted("not_counted");
+  }
+  BOOST_TEST(std::isnan(
+      registry.get_counter("not_counted", HardwareCounters::cycles)));
+
+  // The counters may not be available, e.g. in a container. The sections must
+  // still be timed.
+  bool const available = registry.enable_hardware_counters();
+  BOOST_TEST(registry.hardware_counters_enabled() == available);
+  std::vector<double> x(1 << 20, 1.);
+  {
+    ScopedTimer counted("counted");
+    for (unsigned int k = 0; k < 10; ++k)
+      for (auto &value : x)
+        value *= 1.0001;
+  }
+  BOOST_TEST(x[0] > 1.);
+  BOOST_TEST(registry.get_n_calls("counted") == 1);
+  if (available)
+  {
+    for (unsigned int i = 0; i < HardwareCounters::n_counters; ++i)
+    {
+      HardwareCounters::Counter const counter =
+          static_cast<HardwareCounters::Counter>(i);
+      double const value = registry.get_counter("counted", counter);
+      if (std::isfinite(value))
+        BOOST_TEST(value >= 0.);
+      BOOST_TEST_MESSAGE(HardwareCounters::get_name(counter) << ": "
+                                                             << value);
+    }
+  }
+  else
+    BOOST_TEST_MESSAGE("The hardware counters are not available");
+
+  boost::mpi::communicator world;
+  std::stringstream table;
+  registry.print(table, world);
+  std::stringstream json;
+  registry.write_json(json, world);
+  if ((world.rank() == 0) && available)
+  {
+    BOOST_TEST(table.str().find("IPC") != std::string::npos);
+    boost::property_tree::ptree timers;
+    boost::property_tree::read_json(json, timers);
+    BOOST_TEST(timers.count("counted") == 1);
+  }
+
+  registry.disable_hardware_counters();
+  BOOST_TEST(!registry.hardware_counters_enabled());
+  registry.reset();
+}
+
+BOOST_AUTO_TEST_CASE(test_trace)
+{
+  boost::mpi::communicator world;
+  TraceRecorder &recorder = TraceRecorder::instance();
+  {
+    TraceScope not_recorded("not_recorded");
+  }
+  BOOST_TEST(!recorder.is_recording());
+
+  recorder.start(world);
+  BOOST_TEST(recorder.get_n_events() == 0);
+  {
+    TraceScope outer("outer");
+    {
+      TraceScope inner("inner");
+    }
+    std::thread worker([]()
+                       {
+                         TraceScope worker_scope("worker");
+                       });
+    worker.join();
+    CAP_TRACE_SCOPE("annotation");
+  }
+  recorder.stop();
+  {
+    TraceScope not_recorded("not_recorded");
+  }
+#ifdef WITH_TRACING
+  unsigned int const n_events = 4;
+#else
+  unsigned int const n_events = 3;
+#endif
+  BOOST_TEST(recorder.get_n_events() == n_events);
+
+  // The events of all the processors are output by the rank 0 process. Each
+  // processor also has a metadata event with its name.
+  std::stringstream json;
+  recorder.write(json, world);
+  unsigned int const n_processes = world.size();
+  if (world.rank() == 0)
+  {
+    boost::property_tree::ptree trace;
+    boost::property_tree::read_json(json, trace);
+    BOOST_TEST(trace.get_child("traceEvents").size() ==
+               (n_events + 1) * n_processes);
+    std::vector<unsigned int> outer_threads;
+    std::vector<unsigned int> worker_threads;
+    for (auto const &event : trace.get_child("traceEvents"))
+    {
+      std::string const name = event.second.get<std::string>("name");
+      BOOST_TEST(name != "not_recorded");
+      if (name == "outer")
+        outer_threads.push_back(event.second.get<unsigned int>("tid"));
+      else if (name == "worker")
+        worker_threads.push_back(event.second.get<unsigned int>("tid"));
+      if (name != "process_name")
+        BOOST_TEST(event.second.get<double>("dur") >= 0.);
+    }
+    BOOST_TEST(outer_threads.size() == n_processes);
+    BOOST_TEST(worker_threads.size() == n_processes);
+    BOOST_TEST(outer_threads[0] != worker_threads[0]);
+  }
+  else
+  {
+    BOOST_TEST(json.str().empty());
+  }
+}
 }
@@ -0,0 +1,249 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license.
+ */
+
+#define BOOST_TEST_MODULE WorkPrecision
+
+#include "main.cc"
+
+#include "verification_problem_subramanian.h"
+#include <cap/default_inspector.h>
+#include <cap/energy_storage_device.h>
+#include <cap/utils.h>
+#include <boost/format.hpp>
+#include <boost/mpi/collectives.hpp>
+#include <boost/property_tree/info_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Work-precision study of the charge at constant current of
+// verification_problems.info. The work_precision block gives the lists of
+// mesh refinements, polynomial degrees, time steps, and time schemes to sweep.
+// For each combination, the device is run twice:
+//   - at constant current, and the error on the voltage is measured,
+//   - following the exact voltage, and the error on the current is measured.
+// The errors are the maximum relative errors in percent over the time steps.
+// The wall time only includes the time stepping: the setup of the device and
+// the evaluation of the exact solution are excluded. The results are written
+// as csv, one line per combination, and the cheapest combination that meets
+// percent_tolerance is reported. The finest combination must meet
+// percent_tolerance.
+
+namespace
+{
+struct Discretization
+{
+  unsigned int n_refinements;
+  unsigned int polynomial_degree;
+  double time_step;
+  std::string time_scheme;
+};
+
+struct Measurement
+{
+  double n_dofs;
+  double voltage_error;
+  double voltage_wall_time;
+  double current_error;
+  double current_wall_time;
+};
+
+// Return the maximum over the processors of the wall time since @p start.
+double wall_time(std::chrono::steady_clock::time_point const &start,
+                 boost::mpi::communicator const &comm)
+{
+  double const time =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  return boost::mpi::all_reduce(comm, time, boost::mpi::maximum<double>());
+}
+
+Measurement run(boost::property_tree::ptree const &device_database,
+                boost::property_tree::ptree const &problem_database,
+                Discretization const &discretization,
+                boost::mpi::communicator const &comm)
+{
+  // The SuperCapacitor only implements the backward Euler scheme.
+  if (discretization.time_scheme != "backward_euler")
+    throw std::runtime_error("Invalid time scheme " +
+                             discretization.time_scheme);
+
+  boost::property_tree::ptree database = device_database;
+  database.put("geometry.n_refinements", discretization.n_refinements);
+  database.put("solver.polynomial_degree", discretization.polynomial_degree);
+
+  double const charge_current = problem_database.get<double>("charge_current");
+  double const charge_time = problem_database.get<double>("charge_time");
+  double const time_step = discretization.time_step;
+  unsigned int const n_time_steps =
+      static_cast<unsigned int>(std::round(charge_time / time_step));
+  std::function<double(double)> const compute_exact_voltage =
+      cap::get_exact_voltage(problem_database);
+  std::vector<double> exact_voltage(n_time_steps);
+  for (unsigned int n = 0; n < n_time_steps; ++n)
+    exact_voltage[n] = compute_exact_voltage((n + 1) * time_step);
+
+  Measurement measurement;
+
+  // Impose the current and compare the voltage.
+  {
+    std::shared_ptr<cap::EnergyStorageDevice> device =
+        cap::EnergyStorageDevice::build(database, comm);
+    std::vector<double> computed_voltage(n_time_steps);
+    auto const start = std::chrono::steady_clock::now();
+    for (unsigned int n = 0; n < n_time_steps; ++n)
+    {
+      device->evolve_one_time_step_constant_current(time_step, charge_current);
+      device->get_voltage(computed_voltage[n]);
+    }
+    measurement.voltage_wall_time = wall_time(start, comm);
+    measurement.voltage_error = 0.;
+    for (unsigned int n = 0; n < n_time_steps; ++n)
+      measurement.voltage_error = std::max(
+          measurement.voltage_error,
+          100. * std::abs(computed_voltage[n] - exact_voltage[n]) /
+              std::abs(exact_voltage[n]));
+
+    cap::DefaultInspector inspector;
+    inspector.inspect(device.get());
+    measurement.n_dofs = inspector.get_data()["n_dofs"];
+  }
+
+  // Impose the exact voltage and compare the current.
+  {
+    std::shared_ptr<cap::EnergyStorageDevice> device =
+        cap::EnergyStorageDevice::build(database, comm);
+    std::vector<double> computed_current(n_time_steps);
+    auto const start = std::chrono::steady_clock::now();
+    for (unsigned int n = 0; n < n_time_steps; ++n)
+    {
+      device->evolve_one_time_step_constant_voltage(time_step,
+                                                    exact_voltage[n]);
+      device->get_current(computed_current[n]);
+    }
+    measurement.current_wall_time = wall_time(start, comm);
+    measurement.current_error = 0.;
+    for (unsigned int n = 0; n < n_time_steps; ++n)
+      measurement.current_error =
+          std::max(measurement.current_error,
+                   100. * std::abs(computed_current[n] - charge_current) /
+                       std::abs(charge_current));
+  }
+
+  return measurement;
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_work_precision)
+{
+  boost::mpi::communicator comm;
+
+  boost::property_tree::ptree input_database;
+  boost::property_tree::info_parser::read_info("verification_problems.info",
+                                               input_database);
+  std::shared_ptr<boost::property_tree::ptree> device_database =
+      std::make_shared<boost::property_tree::ptree>(
+          input_database.get_child("device"));
+  std::shared_ptr<boost::property_tree::ptree> problem_database =
+      std::make_shared<boost::property_tree::ptree>(
+          input_database.get_child("verification_problem_subramanian"));
+  cap::compute_parameters(device_database, problem_database);
+
+  boost::property_tree::ptree const study_database =
+      input_database.get_child("work_precision");
+  std::vector<unsigned int> const n_refinements =
+      cap::to_vector<unsigned int>(
+          study_database.get<std::string>("n_refinements"));
+  std::vector<unsigned int> const polynomial_degrees =
+      cap::to_vector<unsigned int>(
+          study_database.get<std::string>("polynomial_degree"));
+  std::vector<double> const time_steps =
+      cap::to_vector<double>(study_database.get<std::string>("time_step"));
+  std::vector<std::string> const time_schemes =
+      cap::to_vector<std::string>(
+          study_database.get<std::string>("time_scheme", "backward_euler"));
+  double const percent_tolerance =
+      study_database.get<double>("percent_tolerance");
+
+  std::ofstream fout;
+  if (comm.rank() == 0)
+  {
+    fout.open(study_database.get<std::string>("output", "work_precision.csv"));
+    fout << "n_refinements,polynomial_degree,time_step,time_scheme,n_dofs,"
+            "voltage_error,voltage_wall_time,current_error,"
+            "current_wall_time\n";
+  }
+
+  // The finest discretization must meet the tolerance.
+  unsigned int const finest_n_refinements =
+      *std::max_element(n_refinements.begin(), n_refinements.end());
+  unsigned int const finest_polynomial_degree =
+      *std::max_element(polynomial_degrees.begin(), polynomial_degrees.end());
+  double const finest_time_step =
+      *std::min_element(time_steps.begin(), time_steps.end());
+
+  Discretization cheapest = {0, 0, 0., ""};
+  double cheapest_wall_time = std::numeric_limits<double>::max();
+  for (unsigned int const n_ref : n_refinements)
+    for (unsigned int const degree : polynomial_degrees)
+      for (double const time_step : time_steps)
+        for (std::string const &time_scheme : time_schemes)
+        {
+          Discretization const discretization = {n_ref, degree, time_step,
+                                                 time_scheme};
+          Measurement const measurement =
+              run(*device_database, *problem_database, discretization, comm);
+          BOOST_TEST(std::isfinite(measurement.voltage_error));
+          BOOST_TEST(std::isfinite(measurement.current_error));
+          if ((n_ref == finest_n_refinements) &&
+              (degree == finest_polynomial_degree) &&
+              (time_step == finest_time_step))
+          {
+            BOOST_TEST(measurement.voltage_error <= percent_tolerance);
+            BOOST_TEST(measurement.current_error <= percent_tolerance);
+          }
+
+          if (comm.rank() == 0)
+            fout << boost::format("%d,%d,%.6e,%s,%.0f,%.6e,%.6e,%.6e,%.6e\n") %
+                        n_ref % degree % time_step % time_scheme %
+                        measurement.n_dofs % measurement.voltage_error %
+                        measurement.voltage_wall_time %
+                        measurement.current_error %
+                        measurement.current_wall_time;
+
+          double const total_wall_time =
+              measurement.voltage_wall_time + measurement.current_wall_time;
+          if ((measurement.voltage_error <= percent_tolerance) &&
+              (measurement.current_error <= percent_tolerance) &&
+              (total_wall_time < cheapest_wall_time))
+          {
+            cheapest = discretization;
+            cheapest_wall_time = total_wall_time;
+          }
+        }
+
+  if (cheapest.polynomial_degree == 0)
+    BOOST_TEST_MESSAGE("No discretization meets the tolerance of " +
+                       std::to_string(percent_tolerance) + " %");
+  else
+    BOOST_TEST_MESSAGE(
+        boost::format("Cheapest discretization within %g %%: n_refinements "
+                      "%d, polynomial_degree %d, time_step %g, time_scheme "
+                      "%s, %.3f s") %
+        percent_tolerance % cheapest.n_refinements %
+        cheapest.polynomial_degree % cheapest.time_step %
+        cheapest.time_scheme % cheapest_wall_time);
+}
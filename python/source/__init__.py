@@ -15,6 +15,7 @@ from .ragone_plot import *
 from .impedance_spectroscopy import *
 from .observer_pattern import *
 from mpi4py import MPI
+from numpy import array, dtype
 
 __all__ = ['PyCap', 'data_helpers', 'time_evolution', 'end_criterion',
            'stage', 'charge_discharge', 'voltammetry', 'ragone_plot',
@@ -41,3 +42,121 @@ def build(self, ptree, comm=MPI.COMM_SELF):
     return EnergyStorageDevice.build(self, ptree, comm)
 
 EnergyStorageDevice.__init__ = build
+
+_get_timers = get_timers
+
+
+# Override get_timers(...) to add a default value to the ``comm`` parameter.
+def get_timers(comm=MPI.COMM_SELF):
+    """
+    Gather the statistics of the timed sections over the processors.
+
+    Parameters
+    ----------
+    comm : mpi4py.MPI.Comm
+        Communicator (the default value is mpi4py.MPI.COMM_SELF).
+
+    Returns
+    -------
+    dict
+        For each path of a section, e.g. 'time_step/solve', the maximum
+        number of 'calls' and the 'min', 'mean', and 'max' of the
+        'wall_time' and of the 'cpu_time' in seconds. The 'cpu_time' only
+        counts the thread that ran the section. The 'counters' are the sums
+        of the 'cycles', of the 'instructions', and of the 'llc_misses' (nan
+        if they were not read).
+    """
+    return _get_timers(comm)
+
+_estimate_memory_footprint = estimate_memory_footprint
+
+
+# Override estimate_memory_footprint(...) to add a default value to the
+# ``comm`` parameter.
+def estimate_memory_footprint(ptree, comm=MPI.COMM_SELF):
+    """
+    Estimate the memory used by the components of a supercapacitor without
+    building it.
+
+    Parameters
+    ----------
+    ptree : pycap.PropertyTree
+        Property tree used to build the device.
+    comm : mpi4py.MPI.Comm
+        Communicator (the default value is mpi4py.MPI.COMM_SELF).
+
+    Returns
+    -------
+    dict
+        For each component, e.g. 'system_matrix' or 'total', the 'min',
+        'max', and 'total' over the processors in bytes.
+    """
+    return _estimate_memory_footprint(ptree, comm)
+
+_start_tracing = start_tracing
+_write_trace = write_trace
+
+
+# Override start_tracing(...) and write_trace(...) to add a default value to
+# the ``comm`` parameter.
+def start_tracing(comm=MPI.COMM_SELF):
+    """
+    Remove the events recorded so far and start recording the annotated
+    scopes of the code. Nothing is recorded unless cap was configured with
+    ENABLE_TRACING=ON.
+
+    Parameters
+    ----------
+    comm : mpi4py.MPI.Comm
+        Communicator (the default value is mpi4py.MPI.COMM_SELF).
+    """
+    _start_tracing(comm)
+
+
+def write_trace(filename, comm=MPI.COMM_SELF):
+    """
+    Write the events of all the processors in the Chrome trace event format.
+    The file can be opened with chrome://tracing or https://ui.perfetto.dev.
+
+    Parameters
+    ----------
+    filename : str
+        Name of the JSON file written by the rank 0 process.
+    comm : mpi4py.MPI.Comm
+        Communicator (the default value is mpi4py.MPI.COMM_SELF).
+    """
+    _write_trace(filename, comm)
+
+
+_solver_statistics_dtype = dtype([('step', 'u4'),
+                                  ('n_iterations', 'u4'),
+                                  ('initial_residual', 'f8'),
+                                  ('final_residual', 'f8'),
+                                  ('rebuilt_operator', '?'),
+                                  ('rebuilt_preconditioner', '?'),
+                                  ('assembly_time', 'f8'),
+                                  ('solve_time', 'f8'),
+                                  ('postprocess_time', 'f8')])
+
+
+def get_solver_statistics(self):
+    """
+    Return the statistics of the last solves of the linear system, from the
+    oldest to the most recent. Only SuperCapacitor devices in 2D and 3D
+    record statistics; the number of solves kept is given by
+    solver.statistics_capacity in the device database.
+
+    Returns
+    -------
+    numpy.ndarray
+        Structured array with the fields 'step', 'n_iterations',
+        'initial_residual', 'final_residual', 'rebuilt_operator',
+        'rebuilt_preconditioner', 'assembly_time', 'solve_time', and
+        'postprocess_time'. The times are in seconds.
+    """
+    data = self._get_solver_statistics()
+    names = _solver_statistics_dtype.names
+    return array(list(zip(*[data[name] for name in names])),
+                 dtype=_solver_statistics_dtype)
+
+EnergyStorageDevice.get_solver_statistics = get_solver_statistics
@@ -7,6 +7,9 @@
 
 #include <pycap/energy_storage_device_wrappers.h>
 #include <cap/default_inspector.h>
+#include <cap/solver_statistics.h>
+#include <cap/memory_footprint.h>
+#include <boost/python/list.hpp>
 #include <mpi4py/mpi4py.h>
 
 namespace pycap {
@@ -28,24 +31,110 @@ double get_voltage(cap::EnergyStorageDevice const & dev)
 boost::python::dict inspect(cap::EnergyStorageDevice & dev)
 {
     cap::DefaultInspector inspector;
-    dev.inspect(&inspector);
+    {
+        ScopedGILRelease gil_release;
+        dev.inspect(&inspector);
+    }
     boost::python::dict data;
     for (auto x : inspector.get_data())
         data[x.first] = x.second;
     return data;
 }
 
+boost::python::dict get_solver_statistics(cap::EnergyStorageDevice & dev)
+{
+    cap::SolverStatisticsInspector inspector;
+    {
+        ScopedGILRelease gil_release;
+        dev.inspect(&inspector);
+    }
+    // One list per field; the structured array is built on the python side.
+    boost::python::list step, n_iterations, initial_residual, final_residual,
+        rebuilt_operator, rebuilt_preconditioner, assembly_time, solve_time,
+        postprocess_time;
+    for (auto const & s : inspector.get_statistics())
+    {
+        step.append(s.step);
+        n_iterations.append(s.n_iterations);
+        initial_residual.append(s.initial_residual);
+        final_residual.append(s.final_residual);
+        rebuilt_operator.append(s.rebuilt_operator);
+        rebuilt_preconditioner.append(s.rebuilt_preconditioner);
+        assembly_time.append(s.assembly_time);
+        solve_time.append(s.solve_time);
+        postprocess_time.append(s.postprocess_time);
+    }
+    boost::python::dict data;
+    data["step"] = step;
+    data["n_iterations"] = n_iterations;
+    data["initial_residual"] = initial_residual;
+    data["final_residual"] = final_residual;
+    data["rebuilt_operator"] = rebuilt_operator;
+    data["rebuilt_preconditioner"] = rebuilt_preconditioner;
+    data["assembly_time"] = assembly_time;
+    data["solve_time"] = solve_time;
+    data["postprocess_time"] = postprocess_time;
+    return data;
+}
+
+boost::python::dict
+convert_memory_footprint(
+    std::map<std::string, cap::MemoryStatistics> const & footprint)
+{
+    boost::python::dict data;
+    for (auto const & x : footprint)
+    {
+        boost::python::dict component;
+        component["min"] = x.second.min;
+        component["max"] = x.second.max;
+        component["total"] = x.second.total;
+        data[x.first] = component;
+    }
+    return data;
+}
+
+boost::python::dict get_memory_footprint(cap::EnergyStorageDevice & dev)
+{
+    cap::MemoryFootprintInspector inspector;
+    {
+        ScopedGILRelease gil_release;
+        dev.inspect(&inspector);
+    }
+    return convert_memory_footprint(inspector.get_footprint());
+}
+
+boost::python::dict estimate_memory_footprint(boost::python::object & py_ptree,
+                                              boost::python::object & py_comm)
+{
+    if (import_mpi4py() < 0) throw std::runtime_error("Failed to import mpi4py");
+    boost::property_tree::ptree const ptree =
+        boost::python::extract<boost::property_tree::ptree const &>(py_ptree);
+    PyObject* py_obj = py_comm.ptr();
+    MPI_Comm *comm_p = PyMPIComm_Get(py_obj);
+    if (comm_p == nullptr) boost::python::throw_error_already_set();
+    boost::mpi::communicator comm(*comm_p, boost::mpi::comm_attach);
+    std::map<std::string, cap::MemoryStatistics> footprint;
+    {
+        ScopedGILRelease gil_release;
+        footprint = cap::estimate_memory_footprint(ptree, comm);
+    }
+    return convert_memory_footprint(footprint);
+}
+
 std::shared_ptr<cap::EnergyStorageDevice>
 build_energy_storage_device(boost::python::object & py_ptree,
                             boost::python::object & py_comm)
 {
     if (import_mpi4py() < 0) throw std::runtime_error("Failed to import mpi4py");
-    boost::property_tree::ptree const & ptree =
+    // Copy the property tree because another thread may modify it while the
+    // GIL is released.
+    boost::property_tree::ptree const ptree =
         boost::python::extract<boost::property_tree::ptree const &>(py_ptree);
     PyObject* py_obj = py_comm.ptr();
     MPI_Comm *comm_p = PyMPIComm_Get(py_obj);
     if (comm_p == nullptr) boost::python::throw_error_already_set();
     boost::mpi::communicator comm(*comm_p, boost::mpi::comm_attach);
+    ScopedGILRelease gil_release;
     return cap::EnergyStorageDevice::build(ptree, comm);
 }
 
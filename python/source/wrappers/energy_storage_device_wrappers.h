@@ -8,10 +8,37 @@
 
 namespace pycap {
 
+// Release the global interpreter lock of Python until the end of the scope so
+// that other Python threads can run during long C++ calls. The Python API
+// cannot be used in the scope.
+class ScopedGILRelease
+{
+public:
+    ScopedGILRelease() : _state(PyEval_SaveThread()) {}
+    ~ScopedGILRelease() { PyEval_RestoreThread(_state); }
+    ScopedGILRelease(ScopedGILRelease const &) = delete;
+    ScopedGILRelease & operator=(ScopedGILRelease const &) = delete;
+private:
+    PyThreadState * _state;
+};
+
+// Evolve the device with the GIL released.
+template <void (cap::EnergyStorageDevice::*evolve)(double, double)>
+void evolve_one_time_step(cap::EnergyStorageDevice & device,
+                          double const time_step, double const value)
+{
+    ScopedGILRelease gil_release;
+    (device.*evolve)(time_step, value);
+}
+
 double get_current(cap::EnergyStorageDevice const & device);
 double get_voltage(cap::EnergyStorageDevice const & device);
 // TODO: may want const reference here
 boost::python::dict inspect(cap::EnergyStorageDevice & device);
+boost::python::dict get_solver_statistics(cap::EnergyStorageDevice & device);
+boost::python::dict get_memory_footprint(cap::EnergyStorageDevice & device);
+boost::python::dict estimate_memory_footprint(boost::python::object & py_ptree,
+                                              boost::python::object & py_comm);
 
 std::shared_ptr<cap::EnergyStorageDevice>
 build_energy_storage_device(boost::python::object & py_ptree,
@@ -22,6 +22,12 @@ char const energy_storage_device_docstring[] =
   ">>> device.evolve_one_time_step_constant_voltage(dt, U)                  \n"
   ">>> I = device.get_current() # <- electric current in amperes            \n"
   "                                                                         \n"
+  "The construction, the evolve_one_time_step_* methods, and inspect release\n"
+  "the global interpreter lock. Other Python threads can run while a device \n"
+  "evolves, and different devices can be evolved concurrently by different  \n"
+  "threads. A device must not be used by two threads at the same time.      \n"
+  "Devices that communicate need a different communicator per thread.       \n"
+  "                                                                         \n"
   ;
 
 char const get_voltage_docstring[] =
@@ -50,6 +56,49 @@ char const inspect_docstring[] =
   "dict                                                                     \n"
   ;
 
+char const get_solver_statistics_docstring[] =
+  "Copy the statistics of the last solves of the linear system. Use         \n"
+  "EnergyStorageDevice.get_solver_statistics() instead.                     \n"
+  "                                                                         \n"
+  "Returns                                                                  \n"
+  "-------                                                                  \n"
+  "dict                                                                     \n"
+  "    A list of values for each field of the statistics.                   \n"
+  ;
+
+char const get_memory_footprint_docstring[] =
+  "Measure the memory used by the components of the device on each          \n"
+  "processor. Only the supercapacitor in 2D and 3D reports its components.  \n"
+  "This function is collective.                                             \n"
+  "                                                                         \n"
+  "Returns                                                                  \n"
+  "-------                                                                  \n"
+  "dict                                                                     \n"
+  "    For each component, e.g. 'system_matrix', 'total', or                \n"
+  "    'peak_resident_set_size', the 'min', 'max', and 'total' over the     \n"
+  "    processors in bytes.                                                 \n"
+  ;
+
+char const estimate_memory_footprint_docstring[] =
+  "Estimate the memory used by the components of a supercapacitor without   \n"
+  "building it. The mesh and the degrees of freedom are built, the system   \n"
+  "is extrapolated from the number of degrees of freedom. The cache of the  \n"
+  "mesh is not used. This function is collective.                           \n"
+  "                                                                         \n"
+  "Parameters                                                               \n"
+  "----------                                                               \n"
+  "ptree : pycap.PropertyTree                                               \n"
+  "    The property tree used to build the device.                          \n"
+  "comm : mpi4py.MPI.Comm                                                   \n"
+  "    The MPI communicator.                                                \n"
+  "                                                                         \n"
+  "Returns                                                                  \n"
+  "-------                                                                  \n"
+  "dict                                                                     \n"
+  "    For each component, the 'min', 'max', and 'total' over the           \n"
+  "    processors in bytes.                                                 \n"
+  ;
+
 char const evolve_one_time_step_constant_current_docstring[] =
   "Impose the electrical current and evolve in time.                        \n"
   "                                                                         \n"
@@ -122,36 +171,53 @@ void export_energy_storage_device()
          boost::python::args("self") )
     .def("inspect", &inspect, inspect_docstring,
          boost::python::args("self") )
+    .def("_get_solver_statistics", &get_solver_statistics,
+         get_solver_statistics_docstring,
+         boost::python::args("self") )
+    .def("get_memory_footprint", &get_memory_footprint,
+         get_memory_footprint_docstring,
+         boost::python::args("self") )
     .def("evolve_one_time_step_constant_current",
-         &cap::EnergyStorageDevice::evolve_one_time_step_constant_current,
+         &evolve_one_time_step<
+             &cap::EnergyStorageDevice::evolve_one_time_step_constant_current>,
          evolve_one_time_step_constant_current_docstring,
          boost::python::args("self", "time_step", "current") )
     .def("evolve_one_time_step_constant_voltage",
-         &cap::EnergyStorageDevice::evolve_one_time_step_constant_voltage,
+         &evolve_one_time_step<
+             &cap::EnergyStorageDevice::evolve_one_time_step_constant_voltage>,
          evolve_one_time_step_constant_voltage_docstring,
          boost::python::args("self", "time_step", "voltage") )
     .def("evolve_one_time_step_constant_power",
-         &cap::EnergyStorageDevice::evolve_one_time_step_constant_power,
+         &evolve_one_time_step<
+             &cap::EnergyStorageDevice::evolve_one_time_step_constant_power>,
          evolve_one_time_step_constant_power_docstring,
          boost::python::args("self", "time_step", "power") )
     .def("evolve_one_time_step_constant_load",
-         &cap::EnergyStorageDevice::evolve_one_time_step_constant_load,
+         &evolve_one_time_step<
+             &cap::EnergyStorageDevice::evolve_one_time_step_constant_load>,
          evolve_one_time_step_constant_load_docstring,
          boost::python::args("self", "time_step", "load") )
     .def("evolve_one_time_step_linear_current",
-         &cap::EnergyStorageDevice::evolve_one_time_step_linear_current,
+         &evolve_one_time_step<
+             &cap::EnergyStorageDevice::evolve_one_time_step_linear_current>,
          boost::python::args("self", "time_step", "current") )
     .def("evolve_one_time_step_linear_voltage",
-         &cap::EnergyStorageDevice::evolve_one_time_step_linear_voltage,
+         &evolve_one_time_step<
+             &cap::EnergyStorageDevice::evolve_one_time_step_linear_voltage>,
          boost::python::args("self", "time_step", "voltage") )
     .def("evolve_one_time_step_linear_power",
-         &cap::EnergyStorageDevice::evolve_one_time_step_linear_power,
+         &evolve_one_time_step<
+             &cap::EnergyStorageDevice::evolve_one_time_step_linear_power>,
          boost::python::args("self", "time_step", "power") )
     .def("evolve_one_time_step_linear_load",
-         &cap::EnergyStorageDevice::evolve_one_time_step_linear_load,
+         &evolve_one_time_step<
+             &cap::EnergyStorageDevice::evolve_one_time_step_linear_load>,
          boost::python::args("self", "time_step", "load") )
 //        .def_pickle(pycap::serializable_class_pickle_support<cap::EnergyStorageDevice>())
         ;
+  boost::python::def("estimate_memory_footprint", &estimate_memory_footprint,
+                     estimate_memory_footprint_docstring,
+                     boost::python::args("ptree", "comm"));
 }
 
 } // end namespace pycap
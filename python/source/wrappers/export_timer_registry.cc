@@ -0,0 +1,61 @@
+#include <pycap/timer_registry_wrappers.h>
+#include <boost/python.hpp>
+
+namespace pycap
+{
+
+char const get_timers_docstring[] =
+  "Gather the statistics of the timed sections over the processors.        \n"
+  "                                                                         \n"
+  "The sections are nested: the path of a section is made of the names of  \n"
+  "the enclosing sections and of its own name separated by '/', e.g.       \n"
+  "'time_step/solve'. A processor that did not go through a section         \n"
+  "contributes zero to its statistics. This function is collective.         \n"
+  "                                                                         \n"
+  "Parameters                                                               \n"
+  "----------                                                               \n"
+  "comm : mpi4py.MPI.Comm                                                   \n"
+  "    The MPI communicator.                                                \n"
+  "                                                                         \n"
+  "Returns                                                                  \n"
+  "-------                                                                  \n"
+  "dict                                                                     \n"
+  "    For each path, a dictionary with the maximum number of 'calls' over  \n"
+  "    the processors and the 'min', 'mean', and 'max' over the processors  \n"
+  "    of the 'wall_time' and of the 'cpu_time' in seconds. The             \n"
+  "    'counters' are the sums over the processors of the 'cycles', of the  \n"
+  "    'instructions', and of the 'llc_misses'. They are nan if they were   \n"
+  "    not read.                                                            \n"
+  ;
+
+char const reset_timers_docstring[] =
+  "Remove all the timed sections of this processor.                         \n"
+  ;
+
+char const enable_hardware_counters_docstring[] =
+  "Read the hardware performance counters in the sections entered from now  \n"
+  "on.                                                                      \n"
+  "                                                                         \n"
+  "Returns                                                                  \n"
+  "-------                                                                  \n"
+  "bool                                                                     \n"
+  "    False if none of the counters is available, e.g. in a container. The \n"
+  "    sections are still timed.                                            \n"
+  ;
+
+char const disable_hardware_counters_docstring[] =
+  "Stop reading the hardware performance counters.                          \n"
+  ;
+
+void export_timer_registry()
+{
+  boost::python::def("get_timers", &get_timers, get_timers_docstring,
+                     boost::python::args("comm"));
+  boost::python::def("reset_timers", &reset_timers, reset_timers_docstring);
+  boost::python::def("enable_hardware_counters", &enable_hardware_counters,
+                     enable_hardware_counters_docstring);
+  boost::python::def("disable_hardware_counters", &disable_hardware_counters,
+                     disable_hardware_counters_docstring);
+}
+
+} // end namespace pycap
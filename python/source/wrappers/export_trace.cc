@@ -0,0 +1,45 @@
+#include <pycap/trace_wrappers.h>
+#include <boost/python.hpp>
+
+namespace pycap
+{
+
+char const start_tracing_docstring[] =
+  "Remove the events recorded so far and start recording the annotated      \n"
+  "scopes of the code. The origin of the time is synchronized over the      \n"
+  "processors. Nothing is recorded unless cap was configured with           \n"
+  "ENABLE_TRACING=ON. This function is collective.                          \n"
+  "                                                                         \n"
+  "Parameters                                                               \n"
+  "----------                                                               \n"
+  "comm : mpi4py.MPI.Comm                                                   \n"
+  "    The MPI communicator.                                                \n"
+  ;
+
+char const stop_tracing_docstring[] =
+  "Stop recording the annotated scopes on this processor.                   \n"
+  ;
+
+char const write_trace_docstring[] =
+  "Write the events of all the processors in the Chrome trace event format. \n"
+  "The file can be opened with chrome://tracing or https://ui.perfetto.dev. \n"
+  "Each processor is shown as a process. This function is collective.       \n"
+  "                                                                         \n"
+  "Parameters                                                               \n"
+  "----------                                                               \n"
+  "filename : str                                                           \n"
+  "    The name of the JSON file written by the rank 0 process.             \n"
+  "comm : mpi4py.MPI.Comm                                                   \n"
+  "    The MPI communicator.                                                \n"
+  ;
+
+void export_trace()
+{
+  boost::python::def("start_tracing", &start_tracing, start_tracing_docstring,
+                     boost::python::args("comm"));
+  boost::python::def("stop_tracing", &stop_tracing, stop_tracing_docstring);
+  boost::python::def("write_trace", &write_trace, write_trace_docstring,
+                     boost::python::args("filename", "comm"));
+}
+
+} // end namespace pycap
@@ -12,6 +12,8 @@ namespace pycap
 {
 void export_property_tree();
 void export_energy_storage_device();
+void export_timer_registry();
+void export_trace();
 }
 
 char const * pycap_docstring =
@@ -67,6 +69,25 @@ char const * pycap_docstring =
   "RagoneAnalysis                                                           \n"
   "    Complete a series of discharges at various rate to produce a ragone  \n"
   "    plot.                                                                \n"
+  "                                                                         \n"
+  "Profiling                                                                \n"
+  "---------                                                                \n"
+  "get_timers                                                               \n"
+  "    Statistics over the processors of the timed sections of the code.    \n"
+  "reset_timers                                                             \n"
+  "    Remove all the timed sections.                                       \n"
+  "enable_hardware_counters                                                 \n"
+  "    Read the hardware performance counters in the timed sections.        \n"
+  "disable_hardware_counters                                                \n"
+  "    Stop reading the hardware performance counters.                      \n"
+  "start_tracing                                                            \n"
+  "    Start recording the annotated scopes of the code.                    \n"
+  "stop_tracing                                                             \n"
+  "    Stop recording the annotated scopes.                                 \n"
+  "write_trace                                                              \n"
+  "    Write the recorded scopes in the Chrome trace event format.          \n"
+  "estimate_memory_footprint                                                \n"
+  "    Estimate the memory used by a supercapacitor before building it.     \n"
   ;
 
 BOOST_PYTHON_MODULE(PyCap)
@@ -85,5 +106,9 @@ BOOST_PYTHON_MODULE(PyCap)
   pycap::export_energy_storage_device();
 
   pycap::export_property_tree();
+
+  pycap::export_timer_registry();
+
+  pycap::export_trace();
 }
 
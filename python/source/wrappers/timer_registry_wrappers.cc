@@ -0,0 +1,62 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license. 
+ */
+
+#include <pycap/timer_registry_wrappers.h>
+#include <mpi4py/mpi4py.h>
+
+namespace pycap {
+
+boost::python::dict get_timers(boost::python::object & py_comm)
+{
+    if (import_mpi4py() < 0) throw std::runtime_error("Failed to import mpi4py");
+    PyObject* py_obj = py_comm.ptr();
+    MPI_Comm *comm_p = PyMPIComm_Get(py_obj);
+    if (comm_p == nullptr) boost::python::throw_error_already_set();
+    boost::mpi::communicator comm(*comm_p, boost::mpi::comm_attach);
+    boost::python::dict timers;
+    for (auto const & x : cap::TimerRegistry::instance().gather(comm))
+    {
+        cap::TimerStatistics const & s = x.second;
+        boost::python::dict wall_time;
+        wall_time["min"] = s.min_wall_time;
+        wall_time["mean"] = s.mean_wall_time;
+        wall_time["max"] = s.max_wall_time;
+        boost::python::dict cpu_time;
+        cpu_time["min"] = s.min_cpu_time;
+        cpu_time["mean"] = s.mean_cpu_time;
+        cpu_time["max"] = s.max_cpu_time;
+        boost::python::dict counters;
+        for (unsigned int i = 0; i < cap::HardwareCounters::n_counters; ++i)
+            counters[cap::HardwareCounters::get_name(
+                static_cast<cap::HardwareCounters::Counter>(i))] =
+                s.counters[i];
+        boost::python::dict section;
+        section["calls"] = s.n_calls;
+        section["wall_time"] = wall_time;
+        section["cpu_time"] = cpu_time;
+        section["counters"] = counters;
+        timers[x.first] = section;
+    }
+    return timers;
+}
+
+void reset_timers()
+{
+    cap::TimerRegistry::instance().reset();
+}
+
+bool enable_hardware_counters()
+{
+    return cap::TimerRegistry::instance().enable_hardware_counters();
+}
+
+void disable_hardware_counters()
+{
+    cap::TimerRegistry::instance().disable_hardware_counters();
+}
+
+} // end namespace pycap
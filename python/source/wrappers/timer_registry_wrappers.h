@@ -0,0 +1,17 @@
+#ifndef TIMER_REGISTRY_WRAPPERS_H
+#define TIMER_REGISTRY_WRAPPERS_H
+
+#include <cap/timer_registry.h>
+#include <boost/python/dict.hpp>
+#include <boost/python/object.hpp>
+
+namespace pycap {
+
+boost::python::dict get_timers(boost::python::object & py_comm);
+void reset_timers();
+bool enable_hardware_counters();
+void disable_hardware_counters();
+
+} // end namespace pycap
+
+#endif
@@ -0,0 +1,56 @@
+/* Copyright (c) 2016, the Cap authors.
+ *
+ * This file is subject to the Modified BSD License and may not be distributed
+ * without copyright and license information. Please refer to the file LICENSE
+ * for the text and further information on this license. 
+ */
+
+#include <pycap/trace_wrappers.h>
+#include <mpi4py/mpi4py.h>
+#include <fstream>
+#include <sstream>
+
+namespace pycap {
+
+namespace {
+
+boost::mpi::communicator get_communicator(boost::python::object & py_comm)
+{
+    if (import_mpi4py() < 0) throw std::runtime_error("Failed to import mpi4py");
+    PyObject* py_obj = py_comm.ptr();
+    MPI_Comm *comm_p = PyMPIComm_Get(py_obj);
+    if (comm_p == nullptr) boost::python::throw_error_already_set();
+    return boost::mpi::communicator(*comm_p, boost::mpi::comm_attach);
+}
+
+} // end anonymous namespace
+
+void start_tracing(boost::python::object & py_comm)
+{
+    cap::TraceRecorder::instance().start(get_communicator(py_comm));
+}
+
+void stop_tracing()
+{
+    cap::TraceRecorder::instance().stop();
+}
+
+void write_trace(std::string const & filename, boost::python::object & py_comm)
+{
+    boost::mpi::communicator comm = get_communicator(py_comm);
+    // Only the rank 0 process writes the trace.
+    if (comm.rank() == 0)
+    {
+        std::ofstream fout(filename);
+        if (!fout)
+            throw std::runtime_error("Cannot open " + filename);
+        cap::TraceRecorder::instance().write(fout, comm);
+    }
+    else
+    {
+        std::ostringstream dummy;
+        cap::TraceRecorder::instance().write(dummy, comm);
+    }
+}
+
+} // end namespace pycap
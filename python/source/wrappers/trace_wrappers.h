@@ -0,0 +1,16 @@
+#ifndef TRACE_WRAPPERS_H
+#define TRACE_WRAPPERS_H
+
+#include <cap/trace.h>
+#include <boost/python/object.hpp>
+#include <string>
+
+namespace pycap {
+
+void start_tracing(boost::python::object & py_comm);
+void stop_tracing();
+void write_trace(std::string const & filename, boost::python::object & py_comm);
+
+} // end namespace pycap
+
+#endif
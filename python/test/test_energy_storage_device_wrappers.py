@@ -5,8 +5,13 @@
 # for the text and further information on this license.
 
 from pycap import PropertyTree, EnergyStorageDevice
+from pycap import get_timers, reset_timers
+from pycap import start_tracing, stop_tracing, write_trace
+from pycap import estimate_memory_footprint
 from mpi4py import MPI
 import unittest
+import json
+import threading
 
 valid_device_input = [
     "series_rc.info",
@@ -74,5 +79,149 @@ class capEnergyStorageDeviceWrappersTestCase(unittest.TestCase):
             device.evolve_one_time_step_constant_voltage(dt, U)
             self.assertAlmostEqual(device.get_voltage(), U)
 
+    def test_threads(self):
+        # the evolve methods release the GIL so that independent devices can
+        # be evolved by different threads
+        def charge(filename, current, voltages):
+            ptree = PropertyTree()
+            ptree.parse_info(filename)
+            device = EnergyStorageDevice(ptree)
+            for i in range(1000):
+                device.evolve_one_time_step_constant_current(0.1, current)
+            voltages.append(device.get_voltage())
+        currents = [1e-3, 2e-3, 3e-3, 4e-3]
+        for filename in ['series_rc.info', 'parallel_rc.info']:
+            expected = []
+            for current in currents:
+                voltages = []
+                charge(filename, current, voltages)
+                expected.append(voltages[0])
+            results = [[] for current in currents]
+            threads = [threading.Thread(target=charge,
+                                        args=(filename, current, voltages))
+                       for current, voltages in zip(currents, results)]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+            for voltages, voltage in zip(results, expected):
+                self.assertEqual(voltages, [voltage])
+
+    @unittest.skipIf(MPI.Query_thread() < MPI.THREAD_MULTIPLE,
+                     'MPI is not initialized with MPI_THREAD_MULTIPLE')
+    def test_threads_supercapacitor(self):
+        # the construction and the evolve methods of a SuperCapacitor also
+        # release the GIL. Each device needs its own communicator.
+        def charge(comm, current, voltages):
+            ptree = PropertyTree()
+            ptree.parse_info('super_capacitor.info')
+            device = EnergyStorageDevice(ptree, comm=comm)
+            for i in range(5):
+                device.evolve_one_time_step_constant_current(0.1, current)
+            voltages.append(device.get_voltage())
+        currents = [1e-3, 2e-3]
+        expected = []
+        for current in currents:
+            voltages = []
+            charge(MPI.COMM_SELF, current, voltages)
+            expected.append(voltages[0])
+        comms = [MPI.COMM_SELF.Dup() for current in currents]
+        results = [[] for current in currents]
+        threads = [threading.Thread(target=charge,
+                                    args=(comm, current, voltages))
+                   for comm, current, voltages in zip(comms, currents,
+                                                      results)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        for comm in comms:
+            comm.Free()
+        for voltages, voltage in zip(results, expected):
+            self.assertEqual(len(voltages), 1)
+            self.assertAlmostEqual(voltages[0], voltage, delta=1e-10)
+
+    def test_timers(self):
+        reset_timers()
+        ptree = PropertyTree()
+        ptree.parse_info('super_capacitor.info')
+        device = EnergyStorageDevice(ptree, comm=MPI.COMM_WORLD)
+        device.evolve_one_time_step_constant_current(0.1, 1e-3)
+        # the sections are nested and their statistics are gathered over the
+        # processors
+        timers = get_timers(MPI.COMM_WORLD)
+        for path in ['setup', 'setup/geometry', 'time_step/solve']:
+            self.assertTrue(path in timers)
+        solve = timers['time_step/solve']
+        self.assertEqual(solve['calls'], 1)
+        for key in ['wall_time', 'cpu_time']:
+            self.assertLessEqual(solve[key]['min'], solve[key]['mean'])
+            self.assertLessEqual(solve[key]['mean'], solve[key]['max'])
+        for counter in ['cycles', 'instructions', 'llc_misses']:
+            self.assertTrue(counter in solve['counters'])
+        self.assertLessEqual(timers['time_step/solve']['wall_time']['max'],
+                             timers['time_step']['wall_time']['max'])
+        reset_timers()
+        self.assertEqual(get_timers(), {})
+
+    def test_trace(self):
+        ptree = PropertyTree()
+        ptree.parse_info('super_capacitor.info')
+        device = EnergyStorageDevice(ptree, comm=MPI.COMM_WORLD)
+        start_tracing(MPI.COMM_WORLD)
+        device.evolve_one_time_step_constant_current(0.1, 1e-3)
+        stop_tracing()
+        write_trace('trace.json', MPI.COMM_WORLD)
+        # the annotations are only recorded when cap is configured with
+        # ENABLE_TRACING=ON but each processor is always named
+        if MPI.COMM_WORLD.Get_rank() == 0:
+            with open('trace.json') as fin:
+                trace = json.load(fin)
+            processes = [event['pid'] for event in trace['traceEvents']
+                         if event['name'] == 'process_name']
+            self.assertEqual(sorted(processes),
+                             list(range(MPI.COMM_WORLD.Get_size())))
+
+    def test_memory_footprint(self):
+        ptree = PropertyTree()
+        ptree.parse_info('super_capacitor.info')
+        estimate = estimate_memory_footprint(ptree, MPI.COMM_WORLD)
+        device = EnergyStorageDevice(ptree, comm=MPI.COMM_WORLD)
+        device.evolve_one_time_step_constant_current(0.1, 1e-3)
+        footprint = device.get_memory_footprint()
+        for component in ['triangulation', 'system_matrix', 'total']:
+            for memory in [estimate[component], footprint[component]]:
+                self.assertGreater(memory['min'], 0)
+                self.assertLessEqual(memory['min'], memory['max'])
+                self.assertLessEqual(memory['max'], memory['total'])
+        self.assertEqual(estimate['triangulation'],
+                         footprint['triangulation'])
+        self.assertTrue('peak_resident_set_size' in footprint)
+
+    def test_solver_statistics(self):
+        ptree = PropertyTree()
+        ptree.parse_info('super_capacitor.info')
+        device = EnergyStorageDevice(ptree)
+        statistics = device.get_solver_statistics()
+        self.assertEqual(len(statistics), 0)
+        for i in range(3):
+            device.evolve_one_time_step_constant_current(0.1, 1e-3)
+        # one record per time step, the operator is only built once
+        statistics = device.get_solver_statistics()
+        self.assertEqual(len(statistics), 3)
+        self.assertEqual(list(statistics['step']), [1, 2, 3])
+        self.assertEqual(list(statistics['rebuilt_operator']),
+                         [True, False, False])
+        for record in statistics:
+            self.assertGreater(record['n_iterations'], 0)
+            self.assertLessEqual(record['final_residual'],
+                                 record['initial_residual'])
+            self.assertGreaterEqual(record['solve_time'], 0.)
+        # the other devices do not record statistics
+        ptree.parse_info('series_rc.info')
+        device = EnergyStorageDevice(ptree)
+        device.evolve_one_time_step_constant_current(0.1, 1e-3)
+        self.assertEqual(len(device.get_solver_statistics()), 0)
+
 if __name__ == '__main__':
     unittest.main()